@@ -0,0 +1,268 @@
+#include "AllocationProfiler.h"
+#include "Typedef.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+
+namespace {
+
+const char* phaseName(AllocPhase phase) {
+    switch (phase) {
+    case AllocPhase::None: return "other";
+    case AllocPhase::Load: return "load";
+    case AllocPhase::Parse: return "parse";
+    case AllocPhase::Exec: return "exec";
+    case AllocPhase::Render: return "render";
+    default: return "?";
+    }
+}
+
+const int phaseCount = static_cast<int>(AllocPhase::Count);
+
+struct PhaseCounters {
+    std::atomic<long long> allocations;
+    std::atomic<long long> frees;
+    std::atomic<long long> bytes;
+    std::atomic<long long> liveBytes;
+    std::atomic<long long> peakLiveBytes;
+};
+
+// 静态零初始化，不依赖构造顺序（operator new 可能在任何静态构造之前被调用）
+PhaseCounters counters[phaseCount];
+std::atomic<long long> statementsExecuted;
+
+// 按行号统计分配次数的固定大小开放寻址表，钩子中不能再分配内存
+const int lineSlots = 1024;
+const int emptyLine = -2147483647 - 1;
+std::atomic<int> lineKeys[lineSlots];
+std::atomic<long long> lineExecs[lineSlots];
+std::atomic<long long> lineAllocs[lineSlots];
+std::atomic<bool> lineTableReady;
+
+thread_local AllocPhase threadPhase = AllocPhase::None;
+thread_local int threadLine = emptyLine;
+
+void prepareLineTable() {
+    if (lineTableReady.load(std::memory_order_acquire)) return;
+    for (int i = 0; i < lineSlots; ++i) {
+        lineKeys[i].store(emptyLine, std::memory_order_relaxed);
+    }
+    lineTableReady.store(true, std::memory_order_release);
+}
+
+int lineSlot(int line) {
+    prepareLineTable();
+    unsigned h = static_cast<unsigned>(line) * 2654435761u;
+    for (int probe = 0; probe < lineSlots; ++probe) {
+        int idx = static_cast<int>((h + probe) % lineSlots);
+        int key = lineKeys[idx].load(std::memory_order_relaxed);
+        if (key == line) return idx;
+        if (key == emptyLine) {
+            int expected = emptyLine;
+            if (lineKeys[idx].compare_exchange_strong(expected, line)) return idx;
+            if (expected == line) return idx;
+        }
+    }
+    return -1; // 表满了，不再按行统计
+}
+
+void raisePeak(std::atomic<long long>& peak, long long value) {
+    long long old = peak.load(std::memory_order_relaxed);
+    while (value > old && !peak.compare_exchange_weak(old, value, std::memory_order_relaxed)) {}
+}
+
+} // namespace
+
+bool AllocationProfiler::isCompiledIn() {
+#ifdef QBASIC_ALLOC_PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AllocationProfiler::reset() {
+    for (int i = 0; i < phaseCount; ++i) {
+        counters[i].allocations = 0;
+        counters[i].frees = 0;
+        counters[i].bytes = 0;
+        // 存活字节不清零：之前分配的内存仍会在之后被释放
+        counters[i].peakLiveBytes = counters[i].liveBytes.load();
+    }
+    statementsExecuted = 0;
+    lineTableReady = false;
+    prepareLineTable();
+    for (int i = 0; i < lineSlots; ++i) {
+        lineExecs[i] = 0;
+        lineAllocs[i] = 0;
+    }
+}
+
+AllocPhase AllocationProfiler::currentPhase() {
+    return threadPhase;
+}
+
+void AllocationProfiler::setPhase(AllocPhase phase) {
+    threadPhase = phase;
+}
+
+void AllocationProfiler::statementExecuted(int lineNumber) {
+    statementsExecuted.fetch_add(1, std::memory_order_relaxed);
+    threadLine = lineNumber;
+    int idx = lineSlot(lineNumber);
+    if (idx >= 0) lineExecs[idx].fetch_add(1, std::memory_order_relaxed);
+}
+
+void AllocationProfiler::addExecutions(int lineNumber, long long count) {
+    if (count <= 0) return;
+    statementsExecuted.fetch_add(count, std::memory_order_relaxed);
+    int idx = lineSlot(lineNumber);
+    if (idx >= 0) lineExecs[idx].fetch_add(count, std::memory_order_relaxed);
+}
+
+void AllocationProfiler::setLine(int lineNumber) {
+    threadLine = lineNumber;
+}
+
+void AllocationProfiler::recordAlloc(std::size_t size, AllocPhase phase) {
+    PhaseCounters& c = counters[static_cast<int>(phase)];
+    c.allocations.fetch_add(1, std::memory_order_relaxed);
+    c.bytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+    long long live = c.liveBytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed) + static_cast<long long>(size);
+    raisePeak(c.peakLiveBytes, live);
+    if ((phase == AllocPhase::Exec || phase == AllocPhase::Parse) && threadLine != emptyLine) {
+        int idx = lineSlot(threadLine);
+        if (idx >= 0) lineAllocs[idx].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void AllocationProfiler::recordFree(std::size_t size, AllocPhase phase) {
+    PhaseCounters& c = counters[static_cast<int>(phase)];
+    c.frees.fetch_add(1, std::memory_order_relaxed);
+    c.liveBytes.fetch_sub(static_cast<long long>(size), std::memory_order_relaxed);
+}
+
+AllocPhaseStats AllocationProfiler::phaseStats(AllocPhase phase) {
+    const PhaseCounters& c = counters[static_cast<int>(phase)];
+    AllocPhaseStats stats = {c.allocations.load(), c.frees.load(), c.bytes.load(), c.liveBytes.load(), c.peakLiveBytes.load()};
+    return stats;
+}
+
+long long AllocationProfiler::executedStatements() {
+    return statementsExecuted.load();
+}
+
+double AllocationProfiler::execAllocationsPerStatement() {
+    long long n = statementsExecuted.load();
+    if (n == 0) return 0.0;
+    return static_cast<double>(counters[static_cast<int>(AllocPhase::Exec)].allocations.load()) / n;
+}
+
+bool AllocationProfiler::withinBudget(double maxAllocationsPerStatement) {
+    return execAllocationsPerStatement() <= maxAllocationsPerStatement;
+}
+
+std::string AllocationProfiler::report() {
+    if (!isCompiledIn()) {
+        return "Allocation profiling is disabled (build with CONFIG += alloc_profile).\n";
+    }
+    // 报告本身也会分配内存，先把数据拷出来再格式化
+    AllocPhaseStats stats[phaseCount];
+    for (int i = 0; i < phaseCount; ++i) {
+        stats[i] = phaseStats(static_cast<AllocPhase>(i));
+    }
+    long long executed = executedStatements();
+    double perStatement = execAllocationsPerStatement();
+
+    struct LineEntry { int line; long long execs; long long allocs; };
+    std::vector<LineEntry> lines;
+    if (lineTableReady) {
+        for (int i = 0; i < lineSlots; ++i) {
+            int key = lineKeys[i].load();
+            if (key != emptyLine && lineExecs[i].load() > 0) {
+                LineEntry e = {key, lineExecs[i].load(), lineAllocs[i].load()};
+                lines.push_back(e);
+            }
+        }
+    }
+    std::sort(lines.begin(), lines.end(), [](const LineEntry& a, const LineEntry& b) { return a.line < b.line; });
+
+    std::ostringstream ss;
+    ss << "Allocation profile\n";
+    ss << std::left << std::setw(8) << "phase" << std::right
+       << std::setw(14) << "allocs" << std::setw(14) << "frees"
+       << std::setw(16) << "bytes" << std::setw(16) << "peak live" << "\n";
+    for (int i = 0; i < phaseCount; ++i) {
+        ss << std::left << std::setw(8) << phaseName(static_cast<AllocPhase>(i)) << std::right
+           << std::setw(14) << stats[i].allocations << std::setw(14) << stats[i].frees
+           << std::setw(16) << stats[i].bytes << std::setw(16) << stats[i].peakLiveBytes << "\n";
+    }
+    ss << "executed statements: " << executed << "\n";
+    ss << "exec allocations per statement: " << std::fixed << std::setprecision(2) << perStatement << "\n";
+    if (!lines.empty()) {
+        ss << "per line (allocations / executions):\n";
+        for (const LineEntry& e : lines) {
+            ss << retract << e.line << ": " << e.allocs << " / " << e.execs
+               << " = " << static_cast<double>(e.allocs) / e.execs << "\n";
+        }
+    }
+    return ss.str();
+}
+
+#ifdef QBASIC_ALLOC_PROFILE
+
+// 每块内存前加 16 字节头记录大小和分配阶段，保持 16 字节对齐
+namespace {
+
+struct AllocHeader {
+    std::size_t size;
+    std::size_t phase;
+};
+
+static_assert(sizeof(AllocHeader) == 16, "allocation header must keep 16-byte alignment");
+
+void* trackedAlloc(std::size_t size) {
+    AllocHeader* header = static_cast<AllocHeader*>(std::malloc(size + sizeof(AllocHeader)));
+    if (!header) return nullptr;
+    AllocPhase phase = threadPhase;
+    header->size = size;
+    header->phase = static_cast<std::size_t>(phase);
+    AllocationProfiler::recordAlloc(size, phase);
+    return header + 1;
+}
+
+void trackedFree(void* ptr) {
+    if (!ptr) return;
+    AllocHeader* header = static_cast<AllocHeader*>(ptr) - 1;
+    AllocationProfiler::recordFree(header->size, static_cast<AllocPhase>(header->phase));
+    std::free(header);
+}
+
+void* throwingAlloc(std::size_t size) {
+    for (;;) {
+        void* ptr = trackedAlloc(size);
+        if (ptr) return ptr;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+} // namespace
+
+void* operator new(std::size_t size) { return throwingAlloc(size); }
+void* operator new[](std::size_t size) { return throwingAlloc(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return trackedAlloc(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return trackedAlloc(size); }
+void operator delete(void* ptr) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { trackedFree(ptr); }
+
+#endif // QBASIC_ALLOC_PROFILE
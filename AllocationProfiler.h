@@ -0,0 +1,84 @@
+#pragma once
+#ifndef ALLOCATIONPROFILER_H
+#define ALLOCATIONPROFILER_H
+#include <cstddef>
+#include <string>
+
+// 分配统计的阶段标签
+enum class AllocPhase {
+    None,   // 未标记的分配（GUI、静态初始化等）
+    Load,   // LoadContent / saveLine 构造语句对象
+    Parse,  // 运行之前的解析（ProgramImage::build）构造表达式树
+    Exec,   // 运行循环里的一条语句，包括第一次执行时的懒解析
+    Render, // display / getSyntaxTree 渲染字符串
+    Count
+};
+
+struct AllocPhaseStats {
+    long long allocations; // 分配次数
+    long long frees;       // 释放次数
+    long long bytes;       // 累计分配字节数
+    long long liveBytes;   // 当前存活字节数
+    long long peakLiveBytes; // 存活字节数峰值
+};
+
+// AllocationProfiler 通过替换全局 operator new/delete 统计堆分配。
+// 只有在定义 QBASIC_ALLOC_PROFILE（qmake: CONFIG += alloc_profile）时才会安装钩子，
+// 否则所有接口都是空操作，report() 只返回提示信息。
+class AllocationProfiler {
+public:
+    static bool isCompiledIn();
+    static void reset();
+
+    static AllocPhase currentPhase();
+    static void setPhase(AllocPhase phase);
+
+    // 运行循环每执行一条语句调用一次，用于计算“每条语句的分配次数”
+    static void statementExecuted(int lineNumber);
+    // 优化层一次执行了 lineNumber 行 count 次，只计数，不改变之后的分配记在哪一行
+    static void addExecutions(int lineNumber, long long count);
+    // 之后的 Exec / Parse 阶段分配记在 lineNumber 行上，不计执行次数
+    static void setLine(int lineNumber);
+
+    static AllocPhaseStats phaseStats(AllocPhase phase);
+    static long long executedStatements();
+    // Exec 阶段的分配次数 / 执行语句数，用于设定回归预算
+    static double execAllocationsPerStatement();
+    static bool withinBudget(double maxAllocationsPerStatement);
+
+    static std::string report();
+
+    // 以下由 operator new/delete 钩子调用
+    static void recordAlloc(std::size_t size, AllocPhase phase);
+    static void recordFree(std::size_t size, AllocPhase phase);
+};
+
+// RAII 阶段标签，析构时恢复之前的阶段
+class AllocPhaseScope {
+private:
+    AllocPhase previous;
+public:
+    explicit AllocPhaseScope(AllocPhase phase) : previous(AllocationProfiler::currentPhase()) {
+        AllocationProfiler::setPhase(phase);
+    }
+    ~AllocPhaseScope() {
+        AllocationProfiler::setPhase(previous);
+    }
+    AllocPhaseScope(const AllocPhaseScope&) = delete;
+    AllocPhaseScope& operator=(const AllocPhaseScope&) = delete;
+};
+
+// 未开启分析时这些宏展开为空，不给运行循环增加任何开销
+#ifdef QBASIC_ALLOC_PROFILE
+#define QBASIC_ALLOC_CONCAT_INNER(a, b) a##b
+#define QBASIC_ALLOC_CONCAT(a, b) QBASIC_ALLOC_CONCAT_INNER(a, b)
+#define QBASIC_ALLOC_PHASE(phase) AllocPhaseScope QBASIC_ALLOC_CONCAT(allocPhaseScope_, __LINE__)(phase)
+#define QBASIC_ALLOC_STATEMENT(line) AllocationProfiler::statementExecuted(line)
+#define QBASIC_ALLOC_LINE(line) AllocationProfiler::setLine(line)
+#else
+#define QBASIC_ALLOC_PHASE(phase) ((void)0)
+#define QBASIC_ALLOC_STATEMENT(line) ((void)0)
+#define QBASIC_ALLOC_LINE(line) ((void)0)
+#endif
+
+#endif // ALLOCATIONPROFILER_H
@@ -0,0 +1,277 @@
+#include "AotCompiler.h"
+#include "Program.h"
+#include "Statement.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// 生成器版本，修改生成代码的格式或语义时递增，使旧缓存失效
+const char *const generatorVersion = "qbasic-aot-2";
+// 编译生成代码的选项，与编译器一起计入缓存键
+const char *const compilerFlags = "-O2 -std=c++11 -w";
+
+// 生成程序的运行时；qb_input 与批量运行的 StdinInput 相同：跳过空白行，不是 int 范围内的整数时
+// 报“不是整数”，输入用完时报“没有更多输入”
+const char *const runtimePrelude =
+    "#include <cmath>\n"
+    "#include <cstdio>\n"
+    "#include <cstdlib>\n"
+    "#include <cerrno>\n"
+    "#include <climits>\n"
+    "\n"
+    "static void qb_fail(int type, const char *message, int line) {\n"
+    "    std::fflush(stdout);\n"
+    "    std::fprintf(stderr, \"Parse Error (%d) on line %d: %s\\n\", type, line, message);\n"
+    "    std::exit(1);\n"
+    "}\n"
+    "\n"
+    "static inline int qb_add(int a, int b) { return (int)((unsigned)a + (unsigned)b); }\n"
+    "static inline int qb_sub(int a, int b) { return (int)((unsigned)a - (unsigned)b); }\n"
+    "static inline int qb_mul(int a, int b) { return (int)((unsigned)a * (unsigned)b); }\n"
+    "static inline int qb_pow(int a, int b) { return std::pow(a, b); }\n"
+    "static inline int qb_mod(int a, int b) { return b < 0 ? a % b + b : a % b; }\n"
+    "\n"
+    "static int qb_input(int line) {\n"
+    "    char buffer[64];\n"
+    "    char *start;\n"
+    "    do {\n"
+    "        if (!std::fgets(buffer, sizeof(buffer), stdin)) qb_fail(%EXHAUSTED_ERROR%, \"no more input\", line);\n"
+    "        for (start = buffer; *start == ' ' || (*start >= '\\t' && *start <= '\\r'); ++start) {}\n"
+    "    } while (!*start);\n"
+    "    char *end;\n"
+    "    errno = 0;\n"
+    "    long value = std::strtol(start, &end, 10);\n"
+    "    if (end == start || errno == ERANGE || value > INT_MAX || value < INT_MIN) qb_fail(%TYPE_ERROR%, \"not a integer\", line);\n"
+    "    return (int)value;\n"
+    "}\n"
+    "\n";
+
+void replaceAll(std::string &text, const std::string &from, const std::string &to) {
+    for (std::size_t pos = text.find(from); pos != std::string::npos; pos = text.find(from, pos + to.size())) {
+        text.replace(pos, from.size(), to);
+    }
+}
+
+std::string cString(const std::string &text) {
+    std::string quoted = "\"";
+    for (char ch : text) {
+        if (ch == '"' || ch == '\\') quoted += '\\';
+        quoted += ch;
+    }
+    return quoted + "\"";
+}
+
+std::string labelName(int line) {
+    return line < 0 ? "Lm" + std::to_string(-static_cast<long long>(line)) : "L" + std::to_string(line);
+}
+
+bool fileExists(const std::string &path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0;
+}
+
+// 编译器的 --version 输出（含厂商和版本），取不到时为空，缓存键只区分编译器命令
+std::string compilerVersion(const std::string &compiler) {
+    std::string version;
+    std::FILE *pipe = popen((compiler + " --version 2>/dev/null").c_str(), "r");
+    if (!pipe) return version;
+    char buffer[256];
+    std::size_t count;
+    while ((count = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0) version.append(buffer, count);
+    pclose(pipe);
+    return version;
+}
+
+} // namespace
+
+AotCompiler::AotCompiler(Program &program) : program(program), tempCounter(0) {}
+
+std::string AotCompiler::defaultCacheDir() {
+    return cacheDirectory("qbasic-aot");
+}
+
+std::string AotCompiler::defaultCompiler() {
+    const char *cxx = std::getenv("CXX");
+    if (cxx && *cxx) return cxx;
+    return "c++";
+}
+
+std::string AotCompiler::cacheKey(const std::string &compiler) {
+    return contentHashHex(std::string(generatorVersion) + "\n" + compilerFlags + "\n" + compiler + "\n"
+                          + compilerVersion(compiler) + "\n" + program.display());
+}
+
+std::string AotCompiler::local(const std::string &name) {
+    auto it = locals.find(name);
+    if (it != locals.end()) return it->second;
+    std::string id = "v" + std::to_string(locals.size()) + "_";
+    for (char ch : name) id += std::isalnum(static_cast<unsigned char>(ch)) ? ch : '_';
+    locals[name] = id;
+    return id;
+}
+
+std::string AotCompiler::newTemp() {
+    return "t" + std::to_string(tempCounter++);
+}
+
+void AotCompiler::emitError(std::ostringstream &out, const std::string &indent, int errorType, const std::string &message, int lineNumber) {
+    out << indent << "qb_fail(" << errorType << ", " << cString(message) << ", " << lineNumber << ");\n";
+}
+
+// 每个节点求值成一个临时变量，保证求值顺序与解释器相同（除法先算除数）
+std::string AotCompiler::emitExpression(const ASTNode *node, int lineNumber, std::ostringstream &out) {
+    if (const NumberNode *numNode = dynamic_cast<const NumberNode*>(node)) {
+        return "(" + std::to_string(numNode->value) + ")";
+    }
+    if (const VariableNode *varNode = dynamic_cast<const VariableNode*>(node)) {
+        std::string var = local(varNode->name);
+        out << "    if (!" << var << "_defined) ";
+        emitError(out, "", static_cast<int>(ParseErrorType::UndefinedVariableError), "undefined variable: " + varNode->name, lineNumber);
+        return var;
+    }
+    const BinaryOpNode *binOpNode = dynamic_cast<const BinaryOpNode*>(node);
+    if (!binOpNode) {
+        throw ParseException(ParseErrorType::InvalidExpressionError, "invalid expression", lineNumber);
+    }
+    std::string result = newTemp();
+    const std::string &op = binOpNode->op;
+    if (op == "/" || op == "MOD") {
+        std::string divisor = emitExpression(binOpNode->right.get(), lineNumber, out);
+        out << "    if (" << divisor << " == 0) ";
+        emitError(out, "", static_cast<int>(ParseErrorType::DivideByZeroError), op == "/" ? "divided by zero" : "mod by zero", lineNumber);
+        std::string dividend = emitExpression(binOpNode->left.get(), lineNumber, out);
+        if (op == "/") out << "    int " << result << " = " << dividend << " / " << divisor << ";\n";
+        else out << "    int " << result << " = qb_mod(" << dividend << ", " << divisor << ");\n";
+        return result;
+    }
+    std::string left = emitExpression(binOpNode->left.get(), lineNumber, out);
+    std::string right = emitExpression(binOpNode->right.get(), lineNumber, out);
+    std::string function;
+    if (op == "+") function = "qb_add";
+    else if (op == "-") function = "qb_sub";
+    else if (op == "*") function = "qb_mul";
+    else if (op == "**") function = "qb_pow";
+    else throw ParseException(ParseErrorType::InvalidExpressionError, "invalid operator", lineNumber);
+    out << "    int " << result << " = " << function << "(" << left << ", " << right << ");\n";
+    return result;
+}
+
+std::string AotCompiler::translate() {
+    locals.clear();
+    tempCounter = 0;
+
+    // 先收集所有跳转目标，只为它们生成标签
+    std::set<int> targets;
+    for (auto &entry : program.statements) {
+        Statement *stmt = entry.second;
+        stmt->parse(program);
+        if (stmt->type == statementType::IF) targets.insert(static_cast<IFstatement*>(stmt)->toLine);
+        else if (stmt->type == statementType::GOTO) targets.insert(static_cast<GOTOstatement*>(stmt)->toLine);
+    }
+
+    std::ostringstream body;
+    for (auto it = program.statements.begin(); it != program.statements.end(); ++it) {
+        int line = it->first;
+        Statement *stmt = it->second;
+        if (targets.count(line)) body << labelName(line) << ":;\n";
+        std::string comment = trimBothEnds(stmt->getRaw().substr(0, stmt->getRaw().size() - 1));
+        replaceAll(comment, "\\", "/"); // 行尾的反斜杠会让 // 注释吞掉下一行
+        body << "    // " << comment << "\n";
+        body << "    {\n";
+        switch (stmt->type) {
+        case statementType::LET: {
+            LETstatement *let = static_cast<LETstatement*>(stmt);
+            // 与 LETstatement::exec 相同，先求右边的值，再定义左边的变量
+            std::string value = emitExpression(let->RHS.getExpressionEvaluator()->getRoot(), line, body);
+            std::string var = local(let->LHS);
+            body << "    " << var << " = " << value << ";\n";
+            body << "    " << var << "_defined = true;\n";
+            break;
+        }
+        case statementType::PRINT: {
+            PRINTstatement *print = static_cast<PRINTstatement*>(stmt);
+            std::string value = emitExpression(print->print.getExpressionEvaluator()->getRoot(), line, body);
+            body << "    std::printf(\"%d\\n\", " << value << ");\n";
+            break;
+        }
+        case statementType::INPUT: {
+            INPUTstatement *input = static_cast<INPUTstatement*>(stmt);
+            std::string var = local(input->input);
+            body << "    " << var << "_defined = true;\n";
+            body << "    " << var << " = qb_input(" << line << ");\n";
+            break;
+        }
+        case statementType::IF: {
+            IFstatement *ifStmt = static_cast<IFstatement*>(stmt);
+            std::string lhs = emitExpression(ifStmt->LHS.getExpressionEvaluator()->getRoot(), line, body);
+            std::string rhs = emitExpression(ifStmt->RHS.getExpressionEvaluator()->getRoot(), line, body);
+            std::string op = ifStmt->ifOperator == '=' ? "==" : std::string(1, ifStmt->ifOperator);
+            // 与解释器一致：跳转到本行等同于顺序执行
+            if (ifStmt->toLine != line) body << "    if (" << lhs << " " << op << " " << rhs << ") goto " << labelName(ifStmt->toLine) << ";\n";
+            break;
+        }
+        case statementType::GOTO: {
+            int toLine = static_cast<GOTOstatement*>(stmt)->toLine;
+            if (toLine != line) body << "    goto " << labelName(toLine) << ";\n";
+            break;
+        }
+        case statementType::END:
+            body << "    goto L_end;\n";
+            break;
+        default:
+            break;
+        }
+        body << "    }\n";
+    }
+
+    std::string prelude = runtimePrelude;
+    replaceAll(prelude, "%TYPE_ERROR%", std::to_string(static_cast<int>(ParseErrorType::TypeError)));
+    replaceAll(prelude, "%EXHAUSTED_ERROR%", std::to_string(static_cast<int>(ParseErrorType::InputExhaustedError)));
+
+    std::ostringstream out;
+    out << "// Generated by " << generatorVersion << " from program " << contentHashHex(program.display()) << ". Do not edit.\n";
+    out << prelude;
+    out << "int main() {\n";
+    for (const auto &entry : locals) {
+        out << "    int " << entry.second << " = 0;\n";
+        out << "    bool " << entry.second << "_defined = false;\n";
+    }
+    out << body.str();
+    out << "L_end:\n";
+    out << "    return 0;\n";
+    out << "}\n";
+    return out.str();
+}
+
+std::string AotCompiler::build(const std::string &cacheDir, const std::string &compiler) {
+    std::string key = cacheKey(compiler);
+    std::string binary = cacheDir + "/" + key;
+    if (fileExists(binary)) return binary; // 同一程序、同一编译器直接复用
+
+    std::string source = translate();
+    makeDirectories(cacheDir);
+    // 源码和可执行文件都先写到本进程的临时文件再改名，避免并发构建看到或覆盖不完整的文件
+    std::string partial = binary + ".partial." + std::to_string(getpid());
+    std::string sourcePath = partial + ".cpp";
+    {
+        std::ofstream file(sourcePath);
+        if (!file) throw std::runtime_error("cannot write " + sourcePath);
+        file << source;
+    }
+    std::string command = compiler + " " + compilerFlags + " -o '" + partial + "' '" + sourcePath + "'";
+    if (std::system(command.c_str()) != 0) {
+        std::remove(sourcePath.c_str());
+        std::remove(partial.c_str());
+        throw std::runtime_error("compiler failed: " + command);
+    }
+    std::rename(sourcePath.c_str(), (binary + ".cpp").c_str());
+    if (std::rename(partial.c_str(), binary.c_str()) != 0) {
+        throw std::runtime_error("cannot move " + partial + " to " + binary);
+    }
+    return binary;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#ifndef AOTCOMPILER_H
+#define AOTCOMPILER_H
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include "ExpressionEvaluator.h"
+
+class Program;
+
+// AotCompiler 把已加载的 BASIC 程序翻译成一个独立的 C++ 翻译单元：
+// 行号变成标签，GOTO/IF 变成 goto，变量变成局部变量，
+// 运算语义（MOD、**、除零报错）与 BinaryOpNode::calculate 一致。
+// 生成的源码交给系统编译器构建，按程序内容、编译器及其版本和编译选项的哈希缓存可执行文件。
+class AotCompiler {
+public:
+    explicit AotCompiler(Program &program);
+
+    // 解析全部语句并生成 C++ 源码；语法错误以 ParseException 抛出
+    std::string translate();
+
+    // 生成（或复用缓存中的）可执行文件，返回其路径；编译失败时抛出 std::runtime_error
+    std::string build(const std::string &cacheDir, const std::string &compiler);
+
+    // 生成器版本、编译选项、编译器命令和它的 --version 输出以及程序文本的哈希
+    std::string cacheKey(const std::string &compiler);
+
+    static std::string defaultCacheDir();
+    static std::string defaultCompiler();
+
+private:
+    Program &program;
+    std::map<std::string, std::string> locals; // BASIC 变量名 -> C++ 局部变量名
+    int tempCounter;
+
+    std::string local(const std::string &name);
+    std::string newTemp();
+    std::string emitExpression(const ASTNode *node, int lineNumber, std::ostringstream &out);
+    void emitError(std::ostringstream &out, const std::string &indent, int errorType, const std::string &message, int lineNumber);
+};
+
+#endif // AOTCOMPILER_H
@@ -0,0 +1,261 @@
+#include "BatchRunner.h"
+#include "ExecutionContext.h"
+#include "InputProvider.h"
+#include "Program.h"
+#include "ProgramImage.h"
+#include "WorkStealingPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <dirent.h>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+// 每次 step 最多执行的语句数，两次 step 之间检查内存和语句数限制
+const int sliceBudget = 4096;
+
+bool fileExists(const std::string &path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode);
+}
+
+bool readFile(const std::string &path, std::string &content) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+std::string joinPath(const std::string &directory, const std::string &name) {
+    if (directory.empty() || name.empty() || name[0] == '/') return name;
+    return directory.back() == '/' ? directory + name : directory + "/" + name;
+}
+
+// 先写临时文件再改名，进程在写的过程中被杀掉时上一个检查点仍然完整
+bool writeCheckpoint(const std::string &path, const std::string &data) {
+    std::string partial = path + ".partial." + std::to_string(getpid()) + "."
+        + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream file(partial, std::ios::binary);
+        if (!file.write(data.data(), data.size())) return false;
+    }
+    return std::rename(partial.c_str(), path.c_str()) == 0;
+}
+
+// 映像和运行状态的固定部分已经超出内存限制，不运行
+struct MemoryLimitExceeded : std::runtime_error {
+    explicit MemoryLimitExceeded(const std::string &message) : std::runtime_error(message) {}
+};
+
+void fail(BatchResult &result, const std::string &name, const std::string &message, int line) {
+    result.ok = false;
+    result.errorName = name;
+    result.errorMessage = message;
+    result.errorLine = line;
+}
+
+} // namespace
+
+BatchRunner::Options::Options() : threads(0), memoryLimit(0), maxStatements(0), timing(true), checkpointEvery(10000000) {}
+
+BatchRunner::BatchRunner(const Options &options) : options(options) {
+    if (!options.imageCacheDirectory.empty()) images = std::make_shared<ImageCache>(options.imageCacheDirectory);
+}
+
+std::vector<BatchJob> BatchRunner::scanDirectory(const std::string &directory) {
+    std::vector<std::string> names;
+    DIR *dir = opendir(directory.c_str());
+    if (!dir) throw std::runtime_error("cannot open directory " + directory);
+    while (dirent *entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".txt") == 0) names.push_back(name);
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+
+    std::vector<BatchJob> jobs;
+    for (const std::string &name : names) {
+        BatchJob job;
+        job.program = joinPath(directory, name);
+        std::string input = joinPath(directory, name.substr(0, name.size() - 4) + ".in");
+        if (fileExists(input)) job.input = input;
+        jobs.push_back(job);
+    }
+    return jobs;
+}
+
+std::vector<BatchJob> BatchRunner::readManifest(const std::string &path) {
+    std::ifstream file(path);
+    if (!file) throw std::runtime_error("cannot open manifest " + path);
+    std::size_t slash = path.rfind('/');
+    std::string base = slash == std::string::npos ? "" : path.substr(0, slash);
+
+    std::vector<BatchJob> jobs;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+        BatchJob job;
+        std::size_t tab = line.find('\t');
+        job.program = joinPath(base, line.substr(0, tab));
+        if (tab != std::string::npos) job.input = joinPath(base, line.substr(tab + 1));
+        jobs.push_back(job);
+    }
+    return jobs;
+}
+
+std::vector<BatchResult> BatchRunner::run(const std::vector<BatchJob> &jobs) {
+    if (!options.checkpointDirectory.empty()) makeDirectories(options.checkpointDirectory);
+    // 每个作业写自己的下标，结果顺序与作业顺序一致
+    std::vector<BatchResult> results(jobs.size());
+    WorkStealingPool pool(options.threads);
+    long long checkpointId = 0;
+    for (std::size_t i = 0; i < jobs.size(); ++i) {
+        long long id = jobs[i].copy ? -1 : checkpointId++;
+        pool.submit([this, &jobs, &results, i, id](int) { results[i] = runOne(jobs[i], id); });
+    }
+    pool.wait();
+    return results;
+}
+
+BatchResult BatchRunner::runOne(const BatchJob &job, long long checkpointId) const {
+    BatchResult result;
+    result.program = job.program;
+    result.input = job.input;
+    result.ok = true;
+    result.errorLine = -1;
+    result.statements = 0;
+    result.resumed = false;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::string source;
+    if (!readFile(job.program, source)) {
+        fail(result, "IOError", "cannot read " + job.program, -1);
+    }
+    else if (!job.input.empty() && !fileExists(job.input)) {
+        fail(result, "IOError", "cannot read " + job.input, -1);
+    }
+    else if (options.memoryLimit && source.size() > options.memoryLimit) {
+        fail(result, "MemoryLimitExceeded", "program larger than the memory limit", -1);
+    }
+    else try {
+        std::shared_ptr<const ProgramImage> image;
+        if (images) image = images->get(source);
+        else {
+            Program program;
+            program.LoadContent(source);
+            image = ProgramImage::build(program);
+        }
+        ExecutionContext context(image);
+        // 源码、映像和上下文的固定部分先从限制中扣除，余下的交给 LimitChecker 按变量和输出检查
+        std::size_t outputCap = 0;
+        if (options.memoryLimit) {
+            std::size_t fixed = source.size() + image->memoryBytes() + context.stateBytes();
+            if (fixed >= options.memoryLimit) throw MemoryLimitExceeded("program image larger than the memory limit");
+            RunLimits limits;
+            limits.maxMemory = outputCap = options.memoryLimit - fixed;
+            context.setLimits(limits);
+        }
+
+        // 没有输入文件时 INPUT 报“没有更多输入”，不会停下来等待
+        std::unique_ptr<InputProvider> input;
+        if (job.input.empty()) input.reset(new GeneratorInput([](int &) { return false; }));
+        else input.reset(new FileInput(job.input));
+        context.setInputProvider(input.get());
+
+        // 检查点的第一行是程序和输入内容的散列，作业顺序或输入文件变了的检查点不会被误用
+        std::string checkpoint;
+        std::string checkpointTag;
+        long long nextCheckpoint = 0;
+        if (!options.checkpointDirectory.empty() && checkpointId >= 0) {
+            checkpoint = joinPath(options.checkpointDirectory, "job-" + std::to_string(checkpointId) + ".checkpoint");
+            std::string inputText;
+            if (!job.input.empty()) readFile(job.input, inputText);
+            checkpointTag = contentHashHex(source) + contentHashHex(inputText) + "\n";
+            std::string saved;
+            if (readFile(checkpoint, saved) && saved.compare(0, checkpointTag.size(), checkpointTag) == 0) {
+                // 文件损坏时从头运行
+                try {
+                    context.restoreCheckpoint(saved.substr(checkpointTag.size()));
+                    result.resumed = true;
+                }
+                catch (const std::runtime_error&) {}
+            }
+            nextCheckpoint = context.getExecutedStatements() + std::max(1LL, options.checkpointEvery);
+        }
+
+        for (;;) {
+            int budget = sliceBudget;
+            if (options.maxStatements) {
+                long long remaining = options.maxStatements - context.getExecutedStatements();
+                if (remaining <= 0) {
+                    fail(result, "StatementLimitExceeded", "statement limit exceeded", context.getCurrentLine());
+                    break;
+                }
+                budget = static_cast<int>(std::min<long long>(budget, remaining));
+            }
+            Program::StepResult step = context.step(budget);
+            if (step == Program::StepResult::Finished) break;
+            if (step == Program::StepResult::Error) {
+                if (context.hasParseError() && context.getErrorType() == ParseErrorType::ResourceLimitError) {
+                    // 只设置了内存限制，报告用户给出的限制而不是扣除固定部分之后的余量
+                    fail(result, "MemoryLimitExceeded", "memory limit exceeded (" + std::to_string(options.memoryLimit) + " bytes)", context.getErrorLine());
+                }
+                else if (context.hasParseError()) fail(result, parseErrorName(context.getErrorType()), context.getError(), context.getErrorLine());
+                else fail(result, "RuntimeError", context.getError(), context.getCurrentLine());
+                break;
+            }
+            if (!checkpoint.empty() && context.getExecutedStatements() >= nextCheckpoint) {
+                writeCheckpoint(checkpoint, checkpointTag + context.saveCheckpoint());
+                nextCheckpoint = context.getExecutedStatements() + std::max(1LL, options.checkpointEvery);
+            }
+        }
+        // 超出语句数限制的运行保留停下时的检查点，放宽限制后可以接着运行
+        if (!checkpoint.empty()) {
+            if (result.errorName == "StatementLimitExceeded") writeCheckpoint(checkpoint, checkpointTag + context.saveCheckpoint());
+            else std::remove(checkpoint.c_str());
+        }
+        result.output = context.getOutput();
+        // 超出内存限制时结果中只保留限制以内的输出
+        if (outputCap && result.output.size() > outputCap) result.output.resize(outputCap);
+        result.statements = context.getExecutedStatements();
+    }
+    catch (const MemoryLimitExceeded &e) {
+        fail(result, "MemoryLimitExceeded", e.what(), -1);
+    }
+    catch (const ParseException &e) {
+        fail(result, parseErrorName(e.getErrorType()), e.what(), e.getLine());
+    }
+    catch (const std::exception &e) {
+        fail(result, "RuntimeError", e.what(), -1);
+    }
+
+    result.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void BatchRunner::writeResults(std::ostream &out, const std::vector<BatchResult> &results) const {
+    for (const BatchResult &result : results) {
+        out << "{\"program\":" << jsonString(result.program)
+            << ",\"input\":" << jsonString(result.input)
+            << ",\"status\":\"" << (result.ok ? "ok" : "error") << "\"";
+        if (!result.ok) {
+            out << ",\"error\":{\"type\":" << jsonString(result.errorName)
+                << ",\"line\":" << result.errorLine
+                << ",\"message\":" << jsonString(result.errorMessage) << "}";
+        }
+        out << ",\"statements\":" << result.statements;
+        if (result.resumed) out << ",\"resumed\":true";
+        out << ",\"output\":" << jsonString(result.output);
+        if (options.timing) out << ",\"wallMs\":" << std::fixed << std::setprecision(3) << result.wallMs;
+        out << "}\n";
+    }
+}
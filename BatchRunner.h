@@ -0,0 +1,73 @@
+#pragma once
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Exception.h"
+#include "ImageCache.h"
+
+// 一个要运行的程序及其 INPUT 文件（每行一个值，为空表示没有输入）
+struct BatchJob {
+    std::string program;
+    std::string input;
+    bool copy;    // --repeat 生成的副本：与原作业相同，不写检查点
+    BatchJob() : copy(false) {}
+};
+
+struct BatchResult {
+    std::string program;
+    std::string input;
+    bool ok;
+    std::string output;
+    std::string errorName;     // ParseErrorType 的名字，或 IOError / MemoryLimitExceeded / StatementLimitExceeded / RuntimeError
+    std::string errorMessage;
+    int errorLine;
+    long long statements;      // 执行完的语句条数
+    bool resumed;              // 从检查点继续运行
+    double wallMs;             // 读入、解析和运行的总耗时
+};
+
+// BatchRunner 在 WorkStealingPool 上并行地加载、运行一批程序。每个程序独立解析成
+// ProgramImage 并在自己的 ExecutionContext 中运行，结果按作业的顺序存放，
+// 与调度顺序无关；除 wallMs 外，同样的输入总是得到同样的结果文件。
+class BatchRunner {
+public:
+    struct Options {
+        int threads;              // <= 0 时使用全部核心
+        // 每个线程上一次运行可用的字节数，0 表示不限：源码、映像和运行状态的固定部分，
+        // 加上已定义的变量（按 LimitChecker::variableBytes 估计）和输出，在定义变量和 PRINT 时检查
+        std::size_t memoryLimit;
+        long long maxStatements;  // 每次运行最多执行的语句数，0 表示不限
+        bool timing;              // 结果文件中是否写 wallMs
+        // 不为空时每执行 checkpointEvery 条语句把运行状态写入该目录，作业再次运行时从检查点继续，
+        // 运行结束后删除检查点；检查点按作业序号（不计副本）命名，程序或输入内容变了的检查点被忽略
+        std::string checkpointDirectory;
+        long long checkpointEvery;
+        // 不为空时程序的解析结果存为该目录下的映像文件，同样的程序再次运行时不再解析
+        std::string imageCacheDirectory;
+        Options();
+    };
+
+    explicit BatchRunner(const Options &options);
+
+    // 目录中按文件名排序的全部 *.txt；同名的 .in 文件作为它的输入
+    static std::vector<BatchJob> scanDirectory(const std::string &directory);
+    // 清单每行一个作业：程序路径，可选地跟一个制表符和输入文件路径；相对路径相对于清单所在目录，
+    // 空行和 # 开头的行忽略。读不到清单时抛出 std::runtime_error
+    static std::vector<BatchJob> readManifest(const std::string &path);
+
+    std::vector<BatchResult> run(const std::vector<BatchJob> &jobs);
+    // checkpointId 为检查点文件的序号，小于 0 时不写检查点
+    BatchResult runOne(const BatchJob &job, long long checkpointId = -1) const;
+
+    // 每个结果一行 JSON，顺序与作业相同
+    void writeResults(std::ostream &out, const std::vector<BatchResult> &results) const;
+
+private:
+    Options options;
+    std::shared_ptr<ImageCache> images;
+};
+
+#endif // BATCHRUNNER_H
@@ -0,0 +1,208 @@
+#include "CompiledExpression.h"
+#include <cmath>
+
+int exprAdd(int a, int b) {
+    return static_cast<int>(static_cast<unsigned>(a) + static_cast<unsigned>(b));
+}
+
+int exprSub(int a, int b) {
+    return static_cast<int>(static_cast<unsigned>(a) - static_cast<unsigned>(b));
+}
+
+int exprMul(int a, int b) {
+    return static_cast<int>(static_cast<unsigned>(a) * static_cast<unsigned>(b));
+}
+
+int exprDiv(int a, int b, int lineNumber) {
+    if (b == 0) throw ParseException(ParseErrorType::DivideByZeroError, "divided by zero", lineNumber);
+    return a / b;
+}
+
+int exprMod(int a, int b, int lineNumber) {
+    if (b == 0) throw ParseException(ParseErrorType::DivideByZeroError, "mod by zero", lineNumber);
+    if (b < 0) return a % b + b;
+    return a % b;
+}
+
+int exprPow(int a, int b) {
+    return std::pow(a, b);
+}
+
+namespace {
+
+inline void checkDefined(int slot, const unsigned char* defined, const std::vector<std::string>& names, int lineNumber) {
+    if (!defined[slot]) throw ParseException(ParseErrorType::UndefinedVariableError, "undefined variable: " + names[slot], lineNumber);
+}
+
+} // namespace
+
+CompiledExpression::CompiledExpression() : line(-1), stackDepth(0) {}
+
+bool CompiledExpression::tryFold(const ASTNode* node, int& value, int lineNumber) {
+    if (const NumberNode* numNode = dynamic_cast<const NumberNode*>(node)) {
+        value = numNode->value;
+        return true;
+    }
+    const BinaryOpNode* binOpNode = dynamic_cast<const BinaryOpNode*>(node);
+    if (!binOpNode) return false;
+    int l, r;
+    if (!tryFold(binOpNode->left.get(), l, lineNumber) || !tryFold(binOpNode->right.get(), r, lineNumber)) return false;
+    const std::string& op = binOpNode->op;
+    if (op == "+") value = exprAdd(l, r);
+    else if (op == "-") value = exprSub(l, r);
+    else if (op == "*") value = exprMul(l, r);
+    else if (op == "**") value = exprPow(l, r);
+    // 除零必须留到运行时报错，不能在编译时折叠
+    else if (op == "/" && r != 0) value = exprDiv(l, r, lineNumber);
+    else if (op == "MOD" && r != 0) value = exprMod(l, r, lineNumber);
+    else return false;
+    return true;
+}
+
+bool CompiledExpression::emitNode(const ASTNode* node, const SlotResolver& resolve) {
+    int folded;
+    if (tryFold(node, folded, line)) {
+        code.push_back({ExprOp::Const, folded});
+        return true;
+    }
+    if (const VariableNode* varNode = dynamic_cast<const VariableNode*>(node)) {
+        int slot = resolve(varNode->name);
+        if (slot < 0) return false;
+        code.push_back({ExprOp::Load, slot});
+        return true;
+    }
+    const BinaryOpNode* binOpNode = dynamic_cast<const BinaryOpNode*>(node);
+    if (!binOpNode) return false;
+    const std::string& op = binOpNode->op;
+    if (op == "/" || op == "MOD") {
+        // 先算除数，再算被除数
+        if (!emitNode(binOpNode->right.get(), resolve) || !emitNode(binOpNode->left.get(), resolve)) return false;
+        code.push_back({op == "/" ? ExprOp::Div : ExprOp::Mod, 0});
+        return true;
+    }
+    if (!emitNode(binOpNode->left.get(), resolve) || !emitNode(binOpNode->right.get(), resolve)) return false;
+    if (op == "+") code.push_back({ExprOp::Add, 0});
+    else if (op == "-") code.push_back({ExprOp::Sub, 0});
+    else if (op == "*") code.push_back({ExprOp::Mul, 0});
+    else if (op == "**") code.push_back({ExprOp::Pow, 0});
+    else return false;
+    return true;
+}
+
+bool CompiledExpression::compile(const ASTNode* root, const SlotResolver& resolve, int lineNumber) {
+    code.clear();
+    line = lineNumber;
+    stackDepth = 0;
+    if (!root || !emitNode(root, resolve)) {
+        code.clear();
+        return false;
+    }
+    int depth = 0;
+    for (const ExprInstr& instr : code) {
+        if (instr.op == ExprOp::Const || instr.op == ExprOp::Load) {
+            ++depth;
+            if (depth > stackDepth) stackDepth = depth;
+        }
+        else --depth;
+    }
+    return true;
+}
+
+template <bool Checked>
+int CompiledExpression::run(VariableInfo* const* slotValues, int usageIncrement,
+                            const unsigned char* defined, const std::vector<std::string>* names) const {
+    // 单条指令的快速路径
+    if (code.size() == 1) {
+        if (code[0].op == ExprOp::Const) return code[0].operand;
+        if (Checked) checkDefined(code[0].operand, defined, *names, line);
+        VariableInfo* var = slotValues[code[0].operand];
+        var->usageCount += usageIncrement;
+        return var->value;
+    }
+    int fixedStack[16] = {0};
+    std::vector<int> heapStack;
+    int* stack = fixedStack;
+    if (stackDepth > 16) {
+        heapStack.resize(stackDepth);
+        stack = heapStack.data();
+    }
+    int top = -1;
+    for (const ExprInstr& instr : code) {
+        switch (instr.op) {
+        case ExprOp::Const:
+            stack[++top] = instr.operand;
+            break;
+        case ExprOp::Load: {
+            if (Checked) checkDefined(instr.operand, defined, *names, line);
+            VariableInfo* var = slotValues[instr.operand];
+            var->usageCount += usageIncrement;
+            stack[++top] = var->value;
+            break;
+        }
+        case ExprOp::Add:
+            stack[top - 1] = exprAdd(stack[top - 1], stack[top]);
+            --top;
+            break;
+        case ExprOp::Sub:
+            stack[top - 1] = exprSub(stack[top - 1], stack[top]);
+            --top;
+            break;
+        case ExprOp::Mul:
+            stack[top - 1] = exprMul(stack[top - 1], stack[top]);
+            --top;
+            break;
+        case ExprOp::Pow:
+            stack[top - 1] = exprPow(stack[top - 1], stack[top]);
+            --top;
+            break;
+        case ExprOp::Div:
+            stack[top - 1] = exprDiv(stack[top], stack[top - 1], line);
+            --top;
+            break;
+        case ExprOp::Mod:
+            stack[top - 1] = exprMod(stack[top], stack[top - 1], line);
+            --top;
+            break;
+        }
+    }
+    return stack[0];
+}
+
+int CompiledExpression::evaluate(VariableInfo* const* slotValues, int usageIncrement) const {
+    return run<false>(slotValues, usageIncrement, nullptr, nullptr);
+}
+
+int CompiledExpression::evaluateChecked(VariableInfo* const* slotValues, int usageIncrement,
+                                        const unsigned char* defined, const std::vector<std::string>& names) const {
+    return run<true>(slotValues, usageIncrement, defined, &names);
+}
+
+bool CompiledExpression::isConstant() const {
+    return code.size() == 1 && code[0].op == ExprOp::Const;
+}
+
+int CompiledExpression::constantValue() const {
+    return code[0].operand;
+}
+
+bool CompiledExpression::isSingleLoad() const {
+    return code.size() == 1 && code[0].op == ExprOp::Load;
+}
+
+int CompiledExpression::lineNumber() const {
+    return line;
+}
+
+const std::vector<ExprInstr>& CompiledExpression::instructions() const {
+    return code;
+}
+
+int CompiledExpression::maxStackDepth() const {
+    return stackDepth;
+}
+
+void CompiledExpression::collectLoads(std::vector<int>& slotsRead) const {
+    for (const ExprInstr& instr : code) {
+        if (instr.op == ExprOp::Load) slotsRead.push_back(instr.operand);
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+#ifndef COMPILEDEXPRESSION_H
+#define COMPILEDEXPRESSION_H
+#include <functional>
+#include <string>
+#include <vector>
+#include "Typedef.h"
+#include "ExpressionEvaluator.h"
+
+// 后缀指令，Load 的操作数是变量槽位编号，Const 的操作数是常量值
+enum class ExprOp : unsigned char {
+    Const,
+    Load,
+    Add,
+    Sub,
+    Mul,
+    Div,    // 栈顶为被除数，次栈顶为除数（与 BinaryOpNode 先求除数的顺序一致）
+    Mod,    // 同 Div
+    Pow,
+};
+
+struct ExprInstr {
+    ExprOp op;
+    int operand;
+};
+
+// 与 BinaryOpNode::calculate 完全一致的运算语义，供优化层、JIT 回退和 AOT 共用
+int exprAdd(int a, int b);
+int exprSub(int a, int b);
+int exprMul(int a, int b);
+int exprDiv(int a, int b, int lineNumber);
+int exprMod(int a, int b, int lineNumber);
+int exprPow(int a, int b);
+
+// CompiledExpression 是 ExpressionEvaluator 语法树的扁平化形式：
+// 变量在编译时解析成槽位，纯常量子树被折叠，求值时不再查 std::map。
+class CompiledExpression {
+public:
+    // 把变量名解析成槽位编号，返回 -1 表示变量尚未定义
+    typedef std::function<int(const std::string&)> SlotResolver;
+
+    CompiledExpression();
+
+    // 编译失败（变量未定义、出现未知节点）时返回 false
+    bool compile(const ASTNode* root, const SlotResolver& resolve, int lineNumber);
+
+    // usageIncrement 对应解释器中一次执行对该表达式求值的次数（IF 为 2）
+    int evaluate(VariableInfo* const* slotValues, int usageIncrement) const;
+    // 同 evaluate，但读取 defined[slot] 为 0 的槽位时抛出与 VariableNode 相同的未定义变量错误，
+    // names[slot] 为变量名；供不经过 Program::variables 的执行上下文使用
+    int evaluateChecked(VariableInfo* const* slotValues, int usageIncrement,
+                        const unsigned char* defined, const std::vector<std::string>& names) const;
+
+    bool isConstant() const;
+    int constantValue() const;
+    bool isSingleLoad() const;
+    int lineNumber() const;
+    const std::vector<ExprInstr>& instructions() const;
+    int maxStackDepth() const;
+    // 该表达式读取的每个槽位及读取次数
+    void collectLoads(std::vector<int>& slotsRead) const;
+
+private:
+    friend class ProgramImage;   // 映像文件直接读写指令
+
+    std::vector<ExprInstr> code;
+    int line;
+    int stackDepth;
+
+    bool emitNode(const ASTNode* node, const SlotResolver& resolve);
+    template <bool Checked>
+    int run(VariableInfo* const* slotValues, int usageIncrement,
+            const unsigned char* defined, const std::vector<std::string>* names) const;
+    static bool tryFold(const ASTNode* node, int& value, int lineNumber);
+};
+
+#endif // COMPILEDEXPRESSION_H
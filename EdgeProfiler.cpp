@@ -0,0 +1,148 @@
+#include "EdgeProfiler.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+const std::size_t initialCapacity = 64;
+// 行号跨度不超过这么多时位图按 line - firstLine 直接编址（最多 128 KB）
+const std::int64_t maxDirectSpan = 1 << 20;
+
+} // namespace
+
+EdgeProfiler::EdgeProfiler() : table(initialCapacity), used(0), firstLine(0), directIndex(true) {}
+
+void EdgeProfiler::reset(const std::vector<int> &lines) {
+    table.assign(initialCapacity, Slot());
+    used = 0;
+    lineNumbers = lines;
+    firstLine = lines.empty() ? 0 : lines.front();
+    std::int64_t span = lines.empty() ? 0 : static_cast<std::int64_t>(lines.back()) - lines.front() + 1;
+    directIndex = span <= maxDirectSpan;
+    std::size_t bits = directIndex ? static_cast<std::size_t>(span) : lines.size();
+    coverage.assign((bits + 63) / 64, 0);
+}
+
+int EdgeProfiler::indexOf(int line) const {
+    if (directIndex) {
+        std::int64_t offset = static_cast<std::int64_t>(line) - firstLine;
+        if (offset < 0 || offset >= static_cast<std::int64_t>(coverage.size()) * 64) return -1;
+        return static_cast<int>(offset);
+    }
+    auto it = std::lower_bound(lineNumbers.begin(), lineNumbers.end(), line);
+    if (it == lineNumbers.end() || *it != line) return -1;
+    return static_cast<int>(it - lineNumbers.begin());
+}
+
+void EdgeProfiler::add(int fromLine, int toLine, std::uint64_t times) {
+    if (times == 0) return;
+    std::uint64_t key = edgeKey(fromLine, toLine);
+    std::size_t mask = table.size() - 1;
+    for (std::size_t i = slotOf(key); ; i = (i + 1) & mask) {
+        Slot &slot = table[i];
+        if (slot.count != 0 && slot.key == key) {
+            slot.count += times;
+            return;
+        }
+        if (slot.count == 0) {
+            insert(i, key, toLine);  // 计为 1 次，可能扩容，余下的次数重新查找后加上
+            if (times > 1) add(fromLine, toLine, times - 1);
+            return;
+        }
+    }
+}
+
+void EdgeProfiler::markLine(int line) {
+    int index = indexOf(line);
+    if (index >= 0) coverage[index >> 6] |= 1ULL << (index & 63);
+}
+
+bool EdgeProfiler::covered(int line) const {
+    int index = indexOf(line);
+    return index >= 0 && (coverage[index >> 6] >> (index & 63) & 1);
+}
+
+bool EdgeProfiler::empty() const {
+    return used == 0;
+}
+
+// 新的转移第一次出现时才走到这里：占用空槽、标记目标行的覆盖位，必要时扩容
+void EdgeProfiler::insert(std::size_t index, std::uint64_t key, int toLine) {
+    table[index].key = key;
+    table[index].count = 1;
+    markLine(toLine);
+    if (++used * 2 > table.size()) grow();
+}
+
+void EdgeProfiler::grow() {
+    std::vector<Slot> old(table.size() * 2);
+    old.swap(table);
+    std::size_t mask = table.size() - 1;
+    for (const Slot &slot : old) {
+        if (slot.count == 0) continue;
+        std::size_t i = slotOf(slot.key);
+        while (table[i].count != 0) i = (i + 1) & mask;
+        table[i] = slot;
+    }
+}
+
+std::vector<EdgeProfiler::Edge> EdgeProfiler::edges() const {
+    std::vector<Edge> result;
+    for (const Slot &slot : table) {
+        if (slot.count == 0) continue;
+        Edge edge;
+        edge.from = static_cast<int>(static_cast<std::uint32_t>(slot.key >> 32));
+        edge.to = static_cast<int>(static_cast<std::uint32_t>(slot.key));
+        edge.count = slot.count;
+        result.push_back(edge);
+    }
+    std::sort(result.begin(), result.end(), [](const Edge &a, const Edge &b) {
+        if (a.count != b.count) return a.count > b.count;
+        return a.from != b.from ? a.from < b.from : a.to < b.to;
+    });
+    return result;
+}
+
+std::vector<int> EdgeProfiler::unexecutedLines() const {
+    std::vector<int> result;
+    for (int line : lineNumbers) {
+        if (!covered(line)) result.push_back(line);
+    }
+    return result;
+}
+
+std::string EdgeProfiler::report(const std::string &programKey, std::size_t topEdges) const {
+    std::vector<int> missing = unexecutedLines();
+    std::vector<Edge> hottest = edges();
+    std::size_t executed = lineNumbers.size() - missing.size();
+    std::ostringstream out;
+    out << "Edge profile for program " << programKey << "\n";
+    out << "Lines executed: " << executed << " / " << lineNumbers.size();
+    if (!lineNumbers.empty()) out << std::fixed << std::setprecision(1) << " (" << 100.0 * executed / lineNumbers.size() << "%)";
+    out << "\n";
+    out << "Unexecuted lines:";
+    if (missing.empty()) out << " none";
+    for (int line : missing) out << " " << line;
+    out << "\n";
+    out << "Hottest edges (" << hottest.size() << " distinct):\n";
+    for (std::size_t i = 0; i < hottest.size() && i < topEdges; ++i) {
+        out << "    " << hottest[i].from << " -> " << hottest[i].to << "    " << hottest[i].count << "\n";
+    }
+    return out.str();
+}
+
+std::string EdgeProfiler::reportJson(const std::string &programKey, std::size_t topEdges) const {
+    std::vector<int> missing = unexecutedLines();
+    std::vector<Edge> hottest = edges();
+    std::ostringstream out;
+    out << "{\"program\":\"" << programKey << "\",\"lines\":" << lineNumbers.size()
+        << ",\"executed\":" << lineNumbers.size() - missing.size() << ",\"unexecuted\":[";
+    for (std::size_t i = 0; i < missing.size(); ++i) out << (i ? "," : "") << missing[i];
+    out << "],\"distinctEdges\":" << hottest.size() << ",\"edges\":[";
+    for (std::size_t i = 0; i < hottest.size() && i < topEdges; ++i) {
+        out << (i ? "," : "") << "{\"from\":" << hottest[i].from << ",\"to\":" << hottest[i].to << ",\"count\":" << hottest[i].count << "}";
+    }
+    out << "]}\n";
+    return out.str();
+}
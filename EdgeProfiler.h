@@ -0,0 +1,81 @@
+#pragma once
+#ifndef EDGEPROFILER_H
+#define EDGEPROFILER_H
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Typedef.h"
+
+// EdgeProfiler 在运行循环中记录行与行之间的转移次数（from 行执行完后执行 to 行）
+// 以及每行是否执行过的覆盖位图。转移表是开放寻址的哈希表，每次记录只做一次散列和一次自增，
+// 可以在回归测试中常开。
+class EdgeProfiler {
+public:
+    struct Edge {
+        int from;
+        int to;
+        std::uint64_t count;
+    };
+
+    EdgeProfiler();
+
+    // 每次运行前调用，lines 为程序的全部行号（升序）
+    void reset(const std::vector<int> &lines);
+
+    void record(int fromLine, int toLine) {
+        std::uint64_t key = edgeKey(fromLine, toLine);
+        std::size_t mask = table.size() - 1;
+        for (std::size_t i = slotOf(key); ; i = (i + 1) & mask) {
+            Slot &slot = table[i];
+            if (slot.count != 0 && slot.key == key) {
+                ++slot.count;
+                return;
+            }
+            if (slot.count == 0) {
+                insert(i, key, toLine);
+                return;
+            }
+        }
+    }
+
+    // 一次记入 times 次转移，用于优化层按运行统计折算出的转移
+    void add(int fromLine, int toLine, std::uint64_t times);
+
+    // 程序入口、从其它执行层回来的行没有记录到的入边，单独标记覆盖
+    void markLine(int line);
+
+    bool covered(int line) const;
+    bool empty() const;
+    std::vector<Edge> edges() const;           // 按次数从高到低
+    std::vector<int> unexecutedLines() const;
+
+    // 每个程序一份报告：覆盖率、未执行的行和最热的 topEdges 条转移
+    std::string report(const std::string &programKey, std::size_t topEdges = 10) const;
+    std::string reportJson(const std::string &programKey, std::size_t topEdges = 10) const;
+
+private:
+    struct Slot {
+        std::uint64_t key;
+        std::uint64_t count;   // 0 表示空槽
+    };
+
+    std::vector<Slot> table;
+    std::size_t used;
+    std::vector<int> lineNumbers;
+    std::vector<std::uint64_t> coverage;   // 每行一位，按 indexOf 的位置编号
+    int firstLine;
+    bool directIndex;                       // 行号范围不大时直接用 line - firstLine 作位置
+
+    static std::uint64_t edgeKey(int fromLine, int toLine) {
+        return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(fromLine)) << 32) | static_cast<std::uint32_t>(toLine);
+    }
+    std::size_t slotOf(std::uint64_t key) const {
+        return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32) & (table.size() - 1);
+    }
+
+    void insert(std::size_t index, std::uint64_t key, int toLine);
+    void grow();
+    int indexOf(int line) const;
+};
+
+#endif // EDGEPROFILER_H
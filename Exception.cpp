@@ -0,0 +1,23 @@
+#include "Exception.h"
+
+const char* parseErrorName(ParseErrorType type) {
+    switch (type) {
+    case ParseErrorType::SyntaxError: return "SyntaxError";
+    case ParseErrorType::TokenError: return "TokenError";
+    case ParseErrorType::TypeError: return "TypeError";
+    case ParseErrorType::UndefinedVariableError: return "UndefinedVariableError";
+    case ParseErrorType::UndefinedLineError: return "UndefinedLineError";
+    case ParseErrorType::LabelRedefinitionError: return "LabelRedefinitionError";
+    case ParseErrorType::InvalidExpressionError: return "InvalidExpressionError";
+    case ParseErrorType::InvalidLineNumberError: return "InvalidLineNumberError";
+    case ParseErrorType::InvalidCommandError: return "InvalidCommandError";
+    case ParseErrorType::DivideByZeroError: return "DivideByZeroError";
+    case ParseErrorType::EndWithoutIfError: return "EndWithoutIfError";
+    case ParseErrorType::MissingOperandError: return "MissingOperandError";
+    case ParseErrorType::MissingOperatorError: return "MissingOperatorError";
+    case ParseErrorType::MissingEndError: return "MissingEndError";
+    case ParseErrorType::InputExhaustedError: return "InputExhaustedError";
+    case ParseErrorType::ResourceLimitError: return "ResourceLimitError";
+    }
+    return "UnknownError";
+}
@@ -22,8 +22,13 @@ enum class ParseErrorType {
     MissingOperandError, //表达式中缺少操作数时抛出。
     MissingOperatorError, //表达式中缺少操作符时抛出。
     MissingEndError, //程序没有终止
+    InputExhaustedError, //脚本化的 INPUT 来源（队列、文件、标准输入等）已经没有值
+    ResourceLimitError, //超出运行限制：语句数、变量数、内存、输出或时间
 };
 
+// 枚举值的名字（如 "DivideByZeroError"），用于批量运行结果等结构化输出
+const char* parseErrorName(ParseErrorType type);
+
 // ParseException 类用于报告 QBasic 解析过程中的所有异常
 class ParseException : public std::exception {
 private:
@@ -40,11 +45,9 @@ public:
         message = ss.str();
     }
 
-    // 返回错误消息
+    // 返回错误消息；指向本异常对象自己的 message，多个线程同时抛出、读取互不影响
     virtual const char* what() const noexcept override {
-        static std::string whatMsg;
-        whatMsg = message;
-        return whatMsg.c_str();
+        return message.c_str();
     }
 
     // 获取异常类型
@@ -0,0 +1,406 @@
+#include "ExecutionContext.h"
+#include "Exception.h"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+namespace {
+
+// 检查点中的整数一律按小端序定长写入，与主机字节序无关
+const char checkpointMagic[4] = {'Q', 'B', 'C', 'K'};
+const std::uint32_t checkpointVersion = 1;
+
+void putInteger(std::string &out, std::uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) out += static_cast<char>((value >> (8 * i)) & 0xff);
+}
+
+void putString(std::string &out, const std::string &text) {
+    putInteger(out, text.size(), 8);
+    out += text;
+}
+
+class CheckpointReader {
+public:
+    explicit CheckpointReader(const std::string &data) : data(data), offset(0) {}
+
+    std::uint64_t integer(int bytes) {
+        need(bytes);
+        std::uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i) value |= static_cast<std::uint64_t>(static_cast<unsigned char>(data[offset + i])) << (8 * i);
+        offset += bytes;
+        return value;
+    }
+    int int32() { return static_cast<int>(static_cast<std::uint32_t>(integer(4))); }
+    std::string text() {
+        std::uint64_t size = integer(8);
+        need(size);
+        std::string value = data.substr(offset, size);
+        offset += size;
+        return value;
+    }
+    bool atEnd() const { return offset == data.size(); }
+
+private:
+    const std::string &data;
+    std::size_t offset;
+
+    void need(std::uint64_t bytes) const {
+        if (bytes > data.size() - offset) throw std::runtime_error("checkpoint is truncated");
+    }
+};
+
+}
+
+
+ExecutionContext::ExecutionContext(std::shared_ptr<const ProgramImage> image)
+    : program(image), inputProvider(nullptr) {
+    reset();
+}
+
+void ExecutionContext::reset() {
+    int slotCount = program->slotCount();
+    VariableInfo zero = {0, 0};
+    values.assign(slotCount, zero);
+    slotTable.resize(slotCount);
+    for (int i = 0; i < slotCount; ++i) slotTable[i] = &values[i];
+    defined.assign(slotCount, 0);
+    Counters none = {0, 0, 0};
+    counters.assign(program->size(), none);
+    pc = 0;
+    currentLine = -1;
+    executed = 0;
+    runState = RunState::Ready;
+    output.clear();
+    outputTaken = 0;
+    outputDrained = 0;
+    definedCount = 0;
+    limiter.start(limiter.limits());
+    providerReads = 0;
+    inputProvided = false;
+    inputIsValue = false;
+    inputValue = 0;
+    inputText.clear();
+    failed = false;
+    parseError = false;
+    errorType = ParseErrorType::SyntaxError;
+    errorLine = -1;
+    errorMessage.clear();
+}
+
+Program::StepResult ExecutionContext::step(int budget) {
+    if (runState == RunState::Done) return failed ? Program::StepResult::Error : Program::StepResult::Finished;
+    if (runState == RunState::WaitingForInput) {
+        if (!inputProvider) return Program::StepResult::NeedsInput;
+        runState = RunState::Ready;
+    }
+    std::size_t sliceStart = output.size();
+    try {
+        Program::StepResult result = runSlice(budget, sliceStart);
+        if (result == Program::StepResult::Finished) runState = RunState::Done;
+        return result;
+    }
+    catch (const ParseException &e) {
+        errorMessage = e.what();
+        parseError = true;
+        errorType = e.getErrorType();
+        errorLine = e.getLine();
+    } catch (const std::invalid_argument&) {
+        errorMessage = "Error: Invalid input, not an integer.";
+    } catch (const std::exception &e) {
+        errorMessage = e.what();
+    }
+    failed = true;
+    runState = RunState::Done;
+    return Program::StepResult::Error;
+}
+
+Program::StepResult ExecutionContext::runSlice(int budget, std::size_t sliceStart) {
+    const std::vector<ProgramImage::Line> &lines = program->lines;
+    const std::vector<std::string> &names = program->names;
+    VariableInfo* const* slotValues = slotTable.data();
+    const unsigned char *isDefined = defined.data();
+    while (pc < lines.size()) {
+        if (budget-- <= 0) return output.size() > sliceStart ? Program::StepResult::OutputReady : Program::StepResult::BudgetExhausted;
+        const ProgramImage::Line &line = lines[pc];
+        Counters &count = counters[pc];
+        currentLine = line.lineNumber;
+        if (line.error) std::rethrow_exception(line.error);
+        switch (line.type) {
+        case statementType::LET:
+            // 与 LETstatement::exec 相同，先求值再定义左边的变量
+            values[line.target].value = line.rhs.evaluateChecked(slotValues, 1, isDefined, names);
+            if (!defined[line.target]) {
+                defined[line.target] = 1;
+                limiter.defined(++definedCount, output.size(), line.lineNumber);
+            }
+            ++count.runTime;
+            ++pc;
+            break;
+        case statementType::PRINT:
+            ++count.runTime;
+            output += std::to_string(line.rhs.evaluateChecked(slotValues, 1, isDefined, names)) + '\n';
+            limiter.printed(outputDrained + output.size(), output.size(), definedCount, line.lineNumber);
+            ++pc;
+            break;
+        case statementType::INPUT:
+            if (!defined[line.target]) {
+                defined[line.target] = 1;
+                limiter.defined(++definedCount, output.size(), line.lineNumber);
+            }
+            if (!inputProvided && inputProvider) {
+                InputProvider::Status status = inputProvider->next(inputValue);
+                if (status == InputProvider::Value || status == InputProvider::Invalid) ++providerReads;
+                if (status == InputProvider::Value) inputIsValue = inputProvided = true;
+                else InputProvider::fail(status, line.lineNumber);
+            }
+            if (!inputProvided) {
+                // 与 Program::step 相同：先交出本段的输出，再停在本行等输入
+                if (output.size() > sliceStart) return Program::StepResult::OutputReady;
+                runState = RunState::WaitingForInput;
+                return Program::StepResult::NeedsInput;
+            }
+            inputProvided = false;
+            if (!inputIsValue && !parseInteger(inputText.data(), inputText.size(), inputValue)) {
+                throw ParseException(ParseErrorType::TypeError, "not a integer", line.lineNumber);
+            }
+            inputIsValue = false;
+            values[line.target].value = inputValue;
+            ++count.runTime;
+            ++pc;
+            break;
+        case statementType::IF: {
+            // 解释器对两边各求值两次，使用次数按 2 计
+            int left = line.lhs.evaluateChecked(slotValues, 2, isDefined, names);
+            int right = line.rhs.evaluateChecked(slotValues, 2, isDefined, names);
+            bool taken = line.ifOperator == '=' ? left == right
+                       : line.ifOperator == '>' ? left > right
+                       : line.ifOperator == '<' && left < right;
+            if (taken) {
+                ++count.trueTime;
+                if (line.jump <= pc) limiter.backwardJump(executed, line.lineNumber);
+                pc = line.jump;
+            }
+            else {
+                ++count.falseTime;
+                ++pc;
+            }
+            break;
+        }
+        case statementType::GOTO:
+            ++count.runTime;
+            if (line.jump <= pc) limiter.backwardJump(executed, line.lineNumber);
+            pc = line.jump;
+            break;
+        case statementType::END:
+            ++count.runTime;
+            ++executed;
+            return Program::StepResult::Finished;
+        default:
+            ++count.runTime;
+            ++pc;
+            break;
+        }
+        ++executed;
+    }
+    return Program::StepResult::Finished;
+}
+
+void ExecutionContext::provideInput(const std::string &value) {
+    inputText = value;
+    inputIsValue = false;
+    inputProvided = true;
+    if (runState == RunState::WaitingForInput) runState = RunState::Ready;
+}
+
+void ExecutionContext::setInputProvider(InputProvider *provider) {
+    inputProvider = provider;
+}
+
+void ExecutionContext::setLimits(const RunLimits &limits) {
+    limiter.start(limits);
+}
+
+const std::string& ExecutionContext::getOutput() const {
+    return output;
+}
+
+std::string ExecutionContext::takeOutput() {
+    std::string fresh = output.substr(outputTaken);
+    outputTaken = output.size();
+    return fresh;
+}
+
+std::string ExecutionContext::drainOutput() {
+    std::string fresh = output.substr(outputTaken);
+    outputDrained += output.size();
+    std::string().swap(output);
+    outputTaken = 0;
+    return fresh;
+}
+
+std::string ExecutionContext::getError() const {
+    return errorMessage;
+}
+
+bool ExecutionContext::hasParseError() const {
+    return parseError;
+}
+
+ParseErrorType ExecutionContext::getErrorType() const {
+    return errorType;
+}
+
+int ExecutionContext::getErrorLine() const {
+    return errorLine;
+}
+
+int ExecutionContext::getCurrentLine() const {
+    return currentLine;
+}
+
+long long ExecutionContext::getExecutedStatements() const {
+    return executed;
+}
+
+std::string ExecutionContext::getRunCounters() const {
+    std::string text;
+    for (std::size_t i = 0; i < program->lines.size(); ++i) {
+        const ProgramImage::Line &line = program->lines[i];
+        text += std::to_string(line.lineNumber) + " " + line.text + "    ";
+        if (line.type == statementType::IF) text += std::to_string(counters[i].trueTime) + " " + std::to_string(counters[i].falseTime);
+        else text += std::to_string(counters[i].runTime);
+        text += "\n";
+    }
+    return text;
+}
+
+std::string ExecutionContext::getSyntaxTreeWithRunStatistics() const {
+    std::string tree;
+    for (std::size_t i = 0; i < program->lines.size(); ++i) {
+        const ProgramImage::Line &line = program->lines[i];
+        if (line.error) std::rethrow_exception(line.error);
+        tree += line.treeHead;
+        if (line.type == statementType::IF) tree += " " + std::to_string(counters[i].trueTime) + " " + std::to_string(counters[i].falseTime);
+        else if (line.type != statementType::REM || !line.treeBody.empty()) tree += " " + std::to_string(counters[i].runTime);
+        tree += "\n";
+        if (line.type == statementType::LET) {
+            tree += retract + program->names[line.target] + " " + std::to_string(values[line.target].usageCount) + "\n";
+        }
+        tree += line.treeBody;
+    }
+    return tree;
+}
+
+const ProgramImage& ExecutionContext::image() const {
+    return *program;
+}
+
+std::size_t ExecutionContext::stateBytes() const {
+    return sizeof(ExecutionContext) + values.capacity() * sizeof(VariableInfo) + slotTable.capacity() * sizeof(VariableInfo*)
+         + defined.capacity() + counters.capacity() * sizeof(Counters);
+}
+
+std::string ExecutionContext::saveCheckpoint() const {
+    std::string out(checkpointMagic, sizeof(checkpointMagic));
+    putInteger(out, checkpointVersion, 4);
+    putString(out, program->key());
+    putInteger(out, program->lines.size(), 4);
+    putInteger(out, values.size(), 4);
+    out.reserve(out.size() + 64 + values.size() * 9 + counters.size() * 12 + output.size() - outputTaken + inputText.size() + errorMessage.size());
+    putInteger(out, pc, 8);
+    putInteger(out, static_cast<std::uint32_t>(currentLine), 4);
+    putInteger(out, executed, 8);
+    putInteger(out, static_cast<int>(runState), 1);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        putInteger(out, static_cast<std::uint32_t>(values[i].value), 4);
+        putInteger(out, static_cast<std::uint32_t>(values[i].usageCount), 4);
+        putInteger(out, defined[i], 1);
+    }
+    for (const Counters &count : counters) {
+        putInteger(out, static_cast<std::uint32_t>(count.runTime), 4);
+        putInteger(out, static_cast<std::uint32_t>(count.trueTime), 4);
+        putInteger(out, static_cast<std::uint32_t>(count.falseTime), 4);
+    }
+    // 只保存还没有取走的输出
+    putString(out, output.substr(outputTaken));
+    putInteger(out, providerReads, 8);
+    putInteger(out, inputProvided, 1);
+    putInteger(out, inputIsValue, 1);
+    putInteger(out, static_cast<std::uint32_t>(inputValue), 4);
+    putString(out, inputText);
+    putInteger(out, failed, 1);
+    putInteger(out, parseError, 1);
+    putInteger(out, static_cast<int>(errorType), 4);
+    putInteger(out, static_cast<std::uint32_t>(errorLine), 4);
+    putString(out, errorMessage);
+    return out;
+}
+
+void ExecutionContext::restoreCheckpoint(const std::string &data) {
+    CheckpointReader in(data);
+    if (data.compare(0, sizeof(checkpointMagic), checkpointMagic, sizeof(checkpointMagic)) != 0) {
+        throw std::runtime_error("not a checkpoint");
+    }
+    in.integer(sizeof(checkpointMagic));
+    if (in.integer(4) != checkpointVersion) throw std::runtime_error("unsupported checkpoint version");
+    if (in.text() != program->key()) throw std::runtime_error("checkpoint belongs to a different program");
+    std::size_t lineCount = in.integer(4);
+    std::size_t slotCount = in.integer(4);
+    if (lineCount != program->lines.size() || slotCount != values.size()) throw std::runtime_error("checkpoint does not match the program");
+
+    // 先全部读入临时变量，出错时上下文保持不变
+    std::size_t newPc = in.integer(8);
+    int newCurrentLine = in.int32();
+    long long newExecuted = static_cast<long long>(in.integer(8));
+    std::uint64_t newRunState = in.integer(1);
+    if (newPc > lineCount || newRunState > static_cast<std::uint64_t>(RunState::Done)) throw std::runtime_error("checkpoint is corrupt");
+    std::vector<VariableInfo> newValues(slotCount);
+    std::vector<unsigned char> newDefined(slotCount);
+    for (std::size_t i = 0; i < slotCount; ++i) {
+        newValues[i].value = in.int32();
+        newValues[i].usageCount = in.int32();
+        newDefined[i] = static_cast<unsigned char>(in.integer(1));
+    }
+    std::vector<Counters> newCounters(lineCount);
+    for (Counters &count : newCounters) {
+        count.runTime = in.int32();
+        count.trueTime = in.int32();
+        count.falseTime = in.int32();
+    }
+    std::string newOutput = in.text();
+    long long newProviderReads = static_cast<long long>(in.integer(8));
+    bool newInputProvided = in.integer(1) != 0;
+    bool newInputIsValue = in.integer(1) != 0;
+    int newInputValue = in.int32();
+    std::string newInputText = in.text();
+    bool newFailed = in.integer(1) != 0;
+    bool newParseError = in.integer(1) != 0;
+    ParseErrorType newErrorType = static_cast<ParseErrorType>(in.int32());
+    int newErrorLine = in.int32();
+    std::string newErrorMessage = in.text();
+    if (!in.atEnd()) throw std::runtime_error("checkpoint is corrupt");
+
+    values.swap(newValues);
+    for (std::size_t i = 0; i < slotCount; ++i) slotTable[i] = &values[i];
+    defined.swap(newDefined);
+    definedCount = defined.size() - static_cast<std::size_t>(std::count(defined.begin(), defined.end(), 0));
+    counters.swap(newCounters);
+    pc = newPc;
+    currentLine = newCurrentLine;
+    executed = newExecuted;
+    runState = static_cast<RunState>(newRunState);
+    output.swap(newOutput);
+    outputTaken = 0;
+    outputDrained = 0;
+    providerReads = newProviderReads;
+    inputProvided = newInputProvided;
+    inputIsValue = newInputIsValue;
+    inputValue = newInputValue;
+    inputText.swap(newInputText);
+    failed = newFailed;
+    parseError = newParseError;
+    errorType = newErrorType;
+    errorLine = newErrorLine;
+    errorMessage.swap(newErrorMessage);
+    if (inputProvider && providerReads) inputProvider->skip(providerReads);
+}
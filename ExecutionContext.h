@@ -0,0 +1,99 @@
+#pragma once
+#ifndef EXECUTIONCONTEXT_H
+#define EXECUTIONCONTEXT_H
+#include <memory>
+#include <string>
+#include <vector>
+#include "Typedef.h"
+#include "Program.h"
+#include "ProgramImage.h"
+#include "InputProvider.h"
+#include "RunLimits.h"
+
+// ExecutionContext 是一次运行的全部可变状态：变量、下一条语句、输入输出和运行统计。
+// 它只读共享的 ProgramImage，一个映像可以同时被多个线程上的上下文执行；
+// 单个上下文不是线程安全的，同一时刻只能由一个线程推进。
+// 运算、计数和报错与解释器逐条执行相同，step 的约定与 Program::step 相同。
+class ExecutionContext {
+public:
+    explicit ExecutionContext(std::shared_ptr<const ProgramImage> image);
+    ExecutionContext(const ExecutionContext&) = delete;
+    ExecutionContext& operator=(const ExecutionContext&) = delete;
+
+    // 回到第一行，清空变量、输出、错误和运行统计；构造之后已经处于这个状态
+    void reset();
+    Program::StepResult step(int budget);
+    void provideInput(const std::string &value);
+    // INPUT 的来源，不转移所有权；为空时 INPUT 返回 NeedsInput
+    void setInputProvider(InputProvider *provider);
+    // 资源限制，超出时运行以 ResourceLimitError 结束；期限从调用此函数或 reset 时算起
+    void setLimits(const RunLimits &limits);
+
+    const std::string& getOutput() const;
+    std::string takeOutput();
+    // 同 takeOutput，并释放输出缓冲区，之后 getOutput 只含此后的输出；供长期驻留的上下文控制内存
+    std::string drainOutput();
+    std::string getError() const;
+    // 最近一次错误是 ParseException 时为其类型和行号，否则 hasParseError 为 false
+    bool hasParseError() const;
+    ParseErrorType getErrorType() const;
+    int getErrorLine() const;
+    int getCurrentLine() const;
+    // 已经执行完的语句条数
+    long long getExecutedStatements() const;
+    // 与 Program::getRunCounters、getSyntaxTreeWithRunStatistics 格式相同；
+    // 有解析失败的行时后者抛出该行的异常
+    std::string getRunCounters() const;
+    std::string getSyntaxTreeWithRunStatistics() const;
+    const ProgramImage& image() const;
+    // 与输出和变量个数无关的固定状态（变量表、槽位表和各行运行统计）占用的字节数
+    std::size_t stateBytes() const;
+
+    // 检查点：当前位置、变量的值和使用次数、各行运行统计、未取走的输出、输入位置和错误状态，
+    // 编码为紧凑的二进制，带程序的内容哈希。恢复时程序必须与保存时相同，否则抛出
+    // std::runtime_error 且上下文不变；已设置的 InputProvider 会跳过保存时已经读过的值
+    std::string saveCheckpoint() const;
+    void restoreCheckpoint(const std::string &data);
+
+private:
+    enum class RunState {
+        Ready,
+        WaitingForInput,
+        Done
+    };
+    struct Counters {
+        int runTime;
+        int trueTime;
+        int falseTime;
+    };
+
+    std::shared_ptr<const ProgramImage> program;
+    std::vector<VariableInfo> values;
+    std::vector<VariableInfo*> slotTable; // slotTable[i] == &values[i]，供 CompiledExpression 求值
+    std::vector<unsigned char> defined;   // 变量是否已被 LET / INPUT 定义，未定义时读取报错
+    std::vector<Counters> counters;
+    std::size_t pc;
+    int currentLine;
+    long long executed;
+    RunState runState;
+    std::string output;
+    std::size_t outputTaken;
+    std::size_t outputDrained;            // drainOutput 已经释放的输出字节数，计入输出限制
+    std::size_t definedCount;             // 已定义的变量个数
+    LimitChecker limiter;
+    InputProvider *inputProvider;
+    long long providerReads;              // 从 inputProvider 读过的值的个数
+    bool inputProvided;
+    bool inputIsValue;
+    int inputValue;
+    std::string inputText;
+    bool failed;
+    bool parseError;
+    ParseErrorType errorType;
+    int errorLine;
+    std::string errorMessage;
+
+    Program::StepResult runSlice(int budget, std::size_t sliceStart);
+};
+
+#endif // EXECUTIONCONTEXT_H
@@ -0,0 +1,350 @@
+#include "ExecutionServer.h"
+#include "ExecutionContext.h"
+#include "InputProvider.h"
+#include "ServerProtocol.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// 每次 step 最多执行的语句数；两段之间发送新增输出并检查超时和连接状态
+const int sliceBudget = 4096;
+const int maxEvents = 64;
+
+std::string errorJson(const std::string &type, int line, const std::string &message) {
+    return "{\"type\":" + jsonString(type) + ",\"line\":" + std::to_string(line) + ",\"message\":" + jsonString(message) + "}";
+}
+
+} // namespace
+
+ExecutionServer::Options::Options() : socketPath("/tmp/qbasic.sock"), threads(0), timeoutMs(10000), cacheCapacity(1024) {}
+
+ExecutionServer::ExecutionServer(const Options &options)
+    : options(options),
+      imageCache(options.imageCacheDirectory.empty() ? nullptr : new ImageCache(options.imageCacheDirectory)),
+      programCache(options.cacheCapacity, imageCache.get()), pool(options.threads),
+      listenFd(-1), epollFd(-1), wakeFd(-1), stopping(false) {}
+
+ExecutionServer::~ExecutionServer() {
+    // 正在执行的请求在下一段之前发现 stopping 并返回，之后才能关闭描述符
+    stopping.store(true);
+    pool.wait();
+    for (auto &entry : connections) ::close(entry.first);
+    if (listenFd >= 0) {
+        ::close(listenFd);
+        unlink(options.socketPath.c_str());
+    }
+    if (epollFd >= 0) ::close(epollFd);
+    if (wakeFd >= 0) ::close(wakeFd);
+}
+
+bool ExecutionServer::listen(std::string &error) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (options.socketPath.size() >= sizeof(address.sun_path)) {
+        error = "socket path too long: " + options.socketPath;
+        return false;
+    }
+    std::strcpy(address.sun_path, options.socketPath.c_str());
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        error = std::string("socket: ") + std::strerror(errno);
+        return false;
+    }
+    unlink(options.socketPath.c_str());
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(listenFd, SOMAXCONN) < 0) {
+        error = options.socketPath + ": " + std::strerror(errno);
+        return false;
+    }
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || wakeFd < 0) {
+        error = std::string("epoll: ") + std::strerror(errno);
+        return false;
+    }
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = listenFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+    event.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+    return true;
+}
+
+void ExecutionServer::run() {
+    epoll_event events[maxEvents];
+    while (!stopping.load()) {
+        int count = epoll_wait(epollFd, events, maxEvents, -1);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd) {
+                acceptConnections();
+                continue;
+            }
+            if (fd == wakeFd) {
+                eventfd_t value;
+                eventfd_read(wakeFd, &value);
+                std::vector<std::shared_ptr<Connection>> ready;
+                {
+                    std::lock_guard<std::mutex> lock(dirtyMutex);
+                    ready.swap(dirty);
+                }
+                for (const std::shared_ptr<Connection> &connection : ready) {
+                    if (!connection->closed.load()) flush(connection);
+                }
+                continue;
+            }
+            auto it = connections.find(fd);
+            if (it == connections.end()) continue;
+            std::shared_ptr<Connection> connection = it->second;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                close(connection);
+                continue;
+            }
+            if (events[i].events & EPOLLIN) readConnection(connection);
+            if ((events[i].events & EPOLLOUT) && !connection->closed.load()) flush(connection);
+        }
+    }
+}
+
+void ExecutionServer::stop() {
+    stopping.store(true);
+    if (wakeFd >= 0) eventfd_write(wakeFd, 1);
+}
+
+const ProgramCache& ExecutionServer::cache() const {
+    return programCache;
+}
+
+void ExecutionServer::acceptConnections() {
+    for (;;) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+        std::shared_ptr<Connection> connection(new Connection());
+        connection->fd = fd;
+        connection->pending.timeoutMs = options.timeoutMs;
+        connection->writing = false;
+        connection->closed.store(false);
+        connection->busy = false;
+        connections[fd] = connection;
+        epoll_event event;
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+void ExecutionServer::readConnection(const std::shared_ptr<Connection> &connection) {
+    char buffer[65536];
+    for (;;) {
+        ssize_t got = recv(connection->fd, buffer, sizeof(buffer), 0);
+        if (got > 0) {
+            connection->inbox.append(buffer, got);
+            continue;
+        }
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (got < 0 && errno == EINTR) continue;
+        close(connection);   // 对端关闭或出错
+        return;
+    }
+
+    std::size_t offset = 0;
+    char type;
+    std::string payload;
+    for (;;) {
+        ServerProtocol::ParseResult result = ServerProtocol::takeFrame(connection->inbox, offset, type, payload);
+        if (result == ServerProtocol::Incomplete) break;
+        if (result == ServerProtocol::Malformed) {
+            close(connection);
+            return;
+        }
+        handleFrame(connection, type, payload);
+    }
+    connection->inbox.erase(0, offset);
+}
+
+void ExecutionServer::handleFrame(const std::shared_ptr<Connection> &connection, char type, const std::string &payload) {
+    Request &request = connection->pending;
+    switch (type) {
+    case ServerProtocol::ProgramText:
+        request.program = payload;
+        break;
+    case ServerProtocol::InputValues:
+        request.input += payload;
+        if (!request.input.empty() && request.input.back() != '\n') request.input += '\n';
+        break;
+    case ServerProtocol::Timeout: {
+        // 客户端只能缩短服务器的超时；0、负数或更长的值都按服务器的设置
+        int timeoutMs = std::atoi(payload.c_str());
+        if (timeoutMs <= 0 || (options.timeoutMs > 0 && timeoutMs > options.timeoutMs)) timeoutMs = options.timeoutMs;
+        request.timeoutMs = timeoutMs;
+        break;
+    }
+    case ServerProtocol::Run: {
+        bool start = false;
+        {
+            std::lock_guard<std::mutex> lock(connection->mutex);
+            connection->queue.push_back(request);
+            if (!connection->busy) start = connection->busy = true;
+        }
+        request = Request();
+        request.timeoutMs = options.timeoutMs;
+        // 同一连接的请求由一个执行线程依次处理，响应不会交错
+        if (start) {
+            std::shared_ptr<Connection> target = connection;
+            pool.submit([this, target](int) { serve(target); });
+        }
+        break;
+    }
+    default: {
+        std::string frames;
+        ServerProtocol::appendFrame(frames, ServerProtocol::Error, errorJson("ProtocolError", -1, std::string("unknown frame type ") + type));
+        send(connection, frames);
+        break;
+    }
+    }
+}
+
+void ExecutionServer::flush(const std::shared_ptr<Connection> &connection) {
+    std::lock_guard<std::mutex> lock(connection->mutex);
+    std::string &outbox = connection->outbox;
+    std::size_t sent = 0;
+    while (sent < outbox.size()) {
+        ssize_t wrote = ::send(connection->fd, outbox.data() + sent, outbox.size() - sent, MSG_NOSIGNAL);
+        if (wrote > 0) {
+            sent += wrote;
+            continue;
+        }
+        if (wrote < 0 && errno == EINTR) continue;
+        if (wrote < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        // 对端已经不在，丢弃未发送的数据；连接在读到 EOF 时关闭
+        outbox.clear();
+        connection->closed.store(true);
+        return;
+    }
+    outbox.erase(0, sent);
+    // 发不完时等 EPOLLOUT 再发
+    bool wantWrite = !outbox.empty();
+    if (wantWrite != connection->writing) {
+        epoll_event event;
+        event.events = EPOLLIN | EPOLLRDHUP | (wantWrite ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+        event.data.fd = connection->fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, connection->fd, &event);
+        connection->writing = wantWrite;
+    }
+}
+
+void ExecutionServer::close(const std::shared_ptr<Connection> &connection) {
+    if (connections.erase(connection->fd) == 0) return;
+    connection->closed.store(true);
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, connection->fd, nullptr);
+    ::close(connection->fd);
+}
+
+void ExecutionServer::send(const std::shared_ptr<Connection> &connection, const std::string &frames) {
+    {
+        std::lock_guard<std::mutex> lock(connection->mutex);
+        connection->outbox += frames;
+    }
+    {
+        std::lock_guard<std::mutex> lock(dirtyMutex);
+        dirty.push_back(connection);
+    }
+    eventfd_write(wakeFd, 1);
+}
+
+void ExecutionServer::serve(const std::shared_ptr<Connection> &connection) {
+    for (;;) {
+        Request request;
+        {
+            std::lock_guard<std::mutex> lock(connection->mutex);
+            if (connection->queue.empty() || connection->closed.load() || stopping.load()) {
+                connection->queue.clear();
+                connection->busy = false;
+                return;
+            }
+            request = connection->queue.front();
+            connection->queue.pop_front();
+        }
+        execute(connection, request);
+    }
+}
+
+void ExecutionServer::execute(const std::shared_ptr<Connection> &connection, const Request &request) {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    Clock::time_point deadline = start + std::chrono::milliseconds(request.timeoutMs);
+    bool cached = false;
+    std::string status = "ok";
+    std::string frames;
+    long long statements = 0;
+
+    try {
+        ExecutionContext context(programCache.get(request.program, &cached));
+        TextInput input(request.input);
+        context.setInputProvider(&input);
+        context.setLimits(options.limits);
+        for (;;) {
+            if (connection->closed.load() || stopping.load()) return;
+            if (request.timeoutMs > 0 && Clock::now() >= deadline) {
+                status = "timeout";
+                ServerProtocol::appendFrame(frames, ServerProtocol::Error,
+                                            errorJson("Timeout", context.getCurrentLine(), "timed out after " + std::to_string(request.timeoutMs) + " ms"));
+                break;
+            }
+            Program::StepResult result = context.step(sliceBudget);
+            statements = context.getExecutedStatements();
+            // 发出的输出不再留在上下文里，内存限制只计算还没发出的部分
+            std::string output = context.drainOutput();
+            if (!output.empty()) ServerProtocol::appendFrame(frames, ServerProtocol::Output, output);
+            if (result == Program::StepResult::Finished) {
+                ServerProtocol::appendFrame(frames, ServerProtocol::SyntaxTree, context.getSyntaxTreeWithRunStatistics());
+                break;
+            }
+            if (result == Program::StepResult::Error) {
+                status = "error";
+                if (context.hasParseError()) {
+                    ServerProtocol::appendFrame(frames, ServerProtocol::Error,
+                                                errorJson(parseErrorName(context.getErrorType()), context.getErrorLine(), context.getError()));
+                }
+                else {
+                    ServerProtocol::appendFrame(frames, ServerProtocol::Error, errorJson("RuntimeError", context.getCurrentLine(), context.getError()));
+                }
+                break;
+            }
+            // 边跑边把输出交给 epoll 线程
+            if (!frames.empty()) {
+                send(connection, frames);
+                frames.clear();
+            }
+        }
+    }
+    catch (const ParseException &e) {
+        // 加载失败，或语法树中有执行时没有走到的错误行
+        status = "error";
+        ServerProtocol::appendFrame(frames, ServerProtocol::Error, errorJson(parseErrorName(e.getErrorType()), e.getLine(), e.what()));
+    }
+    catch (const std::exception &e) {
+        status = "error";
+        ServerProtocol::appendFrame(frames, ServerProtocol::Error, errorJson("RuntimeError", -1, e.what()));
+    }
+
+    long long micros = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+    ServerProtocol::appendFrame(frames, ServerProtocol::Done,
+                                "{\"status\":\"" + status + "\",\"statements\":" + std::to_string(statements)
+                                + ",\"cached\":" + (cached ? "true" : "false") + ",\"micros\":" + std::to_string(micros) + "}");
+    send(connection, frames);
+}
@@ -0,0 +1,86 @@
+#pragma once
+#ifndef EXECUTIONSERVER_H
+#define EXECUTIONSERVER_H
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ProgramCache.h"
+#include "RunLimits.h"
+#include "WorkStealingPool.h"
+
+// ExecutionServer 在 Unix 域套接字上接受 ServerProtocol 格式的请求：
+// 一个 epoll 线程负责所有连接的读写和分帧，请求交给 WorkStealingPool 执行，
+// 程序按内容哈希在 ProgramCache 中复用解析结果。执行线程每跑完一段就把新增输出
+// 放进连接的发送缓冲并通过 eventfd 唤醒 epoll 线程发送，超时在两段之间检查，
+// 其它资源限制由 ExecutionContext 在执行中检查。
+class ExecutionServer {
+public:
+    struct Options {
+        std::string socketPath;
+        int threads;              // <= 0 时使用全部核心
+        int timeoutMs;            // 每个请求的超时，0 表示不限；Timeout 帧只能把它缩短
+        std::size_t cacheCapacity;
+        std::string imageCacheDirectory;   // 不为空时解析结果同时存为磁盘上的映像，重启后不必重新解析
+        RunLimits limits;         // 每个请求的语句数、变量、内存和输出限制；时间限制用 timeoutMs
+        Options();
+    };
+
+    explicit ExecutionServer(const Options &options);
+    ~ExecutionServer();
+
+    // 创建并监听套接字（已存在的同名文件会被删除），失败时返回 false 并设置 error
+    bool listen(std::string &error);
+    // 处理连接直到 stop()，在调用线程上运行
+    void run();
+    // 可以从任意线程（包括信号处理之外的线程）调用
+    void stop();
+
+    const ProgramCache& cache() const;
+
+private:
+    struct Request {
+        std::string program;
+        std::string input;
+        int timeoutMs;
+    };
+
+    struct Connection {
+        int fd;
+        std::string inbox;             // 只由 epoll 线程访问
+        Request pending;               // 正在接收的请求，只由 epoll 线程访问
+        bool writing;                  // 已注册 EPOLLOUT，只由 epoll 线程访问
+        std::atomic<bool> closed;
+        std::mutex mutex;              // 保护以下成员
+        std::string outbox;
+        std::deque<Request> queue;
+        bool busy;                     // 有执行线程正在处理本连接的请求
+    };
+
+    Options options;
+    std::unique_ptr<ImageCache> imageCache;
+    ProgramCache programCache;
+    WorkStealingPool pool;
+    int listenFd;
+    int epollFd;
+    int wakeFd;
+    std::atomic<bool> stopping;
+    std::map<int, std::shared_ptr<Connection>> connections;   // 只由 epoll 线程访问
+    std::mutex dirtyMutex;
+    std::vector<std::shared_ptr<Connection>> dirty;           // 有待发送数据的连接
+
+    void acceptConnections();
+    void readConnection(const std::shared_ptr<Connection> &connection);
+    void handleFrame(const std::shared_ptr<Connection> &connection, char type, const std::string &payload);
+    void flush(const std::shared_ptr<Connection> &connection);
+    void close(const std::shared_ptr<Connection> &connection);
+
+    void serve(const std::shared_ptr<Connection> &connection);
+    void execute(const std::shared_ptr<Connection> &connection, const Request &request);
+    void send(const std::shared_ptr<Connection> &connection, const std::string &frames);
+};
+
+#endif // EXECUTIONSERVER_H
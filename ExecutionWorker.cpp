@@ -0,0 +1,94 @@
+#include "ExecutionWorker.h"
+#include "Program.h"
+
+namespace {
+
+// 每次 step 最多执行的语句数；停止和快照请求在语句边界上随时响应，与这个值无关
+const int sliceBudget = 4096;
+
+} // namespace
+
+ExecutionWorker::ExecutionWorker(Program &program) : program(program), finished(false) {
+    outcome.kind = RunEvent::Finished;
+    outcome.line = -1;
+}
+
+ExecutionWorker::~ExecutionWorker() {
+    stop();
+    wait();
+}
+
+bool ExecutionWorker::start() {
+    if (thread.joinable()) return false;
+    control.reset();
+    finished.store(false);
+    program.setRunControl(&control);
+    thread = std::thread(&ExecutionWorker::run, this);
+    return true;
+}
+
+void ExecutionWorker::stop() {
+    if (thread.joinable()) control.requestStop();
+}
+
+void ExecutionWorker::wait() {
+    if (!thread.joinable()) return;
+    thread.join();
+    program.setRunControl(nullptr);
+}
+
+bool ExecutionWorker::isRunning() const {
+    return thread.joinable();
+}
+
+bool ExecutionWorker::isFinished() const {
+    return finished.load(std::memory_order_acquire);
+}
+
+void ExecutionWorker::requestSnapshot() {
+    if (thread.joinable()) control.requestSnapshot();
+}
+
+bool ExecutionWorker::provideInput(const std::string &value) {
+    return control.provideInput(value);
+}
+
+bool ExecutionWorker::pollEvent(RunEvent &event) {
+    return control.pollEvent(event);
+}
+
+const RunEvent& ExecutionWorker::result() const {
+    return outcome;
+}
+
+void ExecutionWorker::run() {
+    outcome.kind = RunEvent::Finished;
+    outcome.text.clear();
+    program.preRun();
+    for (;;) {
+        Program::StepResult result = program.step(sliceBudget);
+        if (result == Program::StepResult::NeedsInput) {
+            // 先把已有输出交给界面，再等界面线程送来输入
+            program.publishProgress();
+            control.publish(RunEvent::NeedsInput, program.getCurrentLine(), std::string());
+            std::string value;
+            if (!control.waitForInput(value)) {
+                outcome.kind = RunEvent::Stopped;
+                break;
+            }
+            program.provideInput(value);
+            continue;
+        }
+        if (result == Program::StepResult::Finished) {
+            if (program.isStopped()) outcome.kind = RunEvent::Stopped;
+            break;
+        }
+        if (result == Program::StepResult::Error) {
+            outcome.kind = RunEvent::Error;
+            outcome.text = program.getError();
+            break;
+        }
+    }
+    outcome.line = outcome.kind == RunEvent::Error ? -1 : program.getCurrentLine();
+    finished.store(true, std::memory_order_release);
+}
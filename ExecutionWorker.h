@@ -0,0 +1,46 @@
+#pragma once
+#ifndef EXECUTIONWORKER_H
+#define EXECUTIONWORKER_H
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "RunControl.h"
+
+class Program;
+
+// ExecutionWorker 在独立线程上执行 RUN，界面线程通过 RunControl 交换输入、输出和运行统计。
+// 运行期间界面线程不能直接访问 Program；isFinished() 之后调用 wait()，再读取结果和 Program。
+class ExecutionWorker {
+public:
+    explicit ExecutionWorker(Program &program);
+    ~ExecutionWorker();
+
+    // 已有线程在运行时返回 false
+    bool start();
+    // 请求在下一个语句边界停止，不等待
+    void stop();
+    // 等待线程结束并解除 Program 与 RunControl 的关联
+    void wait();
+
+    bool isRunning() const;
+    bool isFinished() const;
+
+    void requestSnapshot();
+    bool provideInput(const std::string &value);
+    bool pollEvent(RunEvent &event);
+
+    // wait() 之后有效：Finished、Stopped 或 Error
+    const RunEvent& result() const;
+
+private:
+    Program &program;
+    RunControl control;
+    std::thread thread;
+    std::atomic<bool> finished;
+    RunEvent outcome;
+
+    void run();
+};
+
+#endif // EXECUTIONWORKER_H
@@ -1,5 +1,6 @@
 #include "ExpressionEvaluator.h"
 #include "Program.h"
+#include "CompiledExpression.h"
 // Parse a primary expression, which could be a number or a parenthesized expression
 // Modify the parsePrimary function
 
@@ -135,23 +136,23 @@ BinaryOpNode::BinaryOpNode(std::string operation, std::unique_ptr<ASTNode> lhs,
 
 int BinaryOpNode::calculate() const{
     std::cout << op << std::endl;
+        // 运算与 CompiledExpression 共用同一组函数：先算左边再算右边（除法先算除数），溢出按 32 位回绕
+        if (op == "/" || op == "MOD") {
+            int divisor = right->calculate();
+            if (divisor == 0) throw ParseException(ParseErrorType::DivideByZeroError, op == "/" ? "divided by zero" : "mod by zero", lineNumber);
+            int dividend = left->calculate();
+            return op == "/" ? exprDiv(dividend, divisor, lineNumber) : exprMod(dividend, divisor, lineNumber);
+        }
+        int l = left->calculate();
+        int r = right->calculate();
         if (op == "+") {
-            return left->calculate() + right->calculate();
+            return exprAdd(l, r);
         } else if (op == "-") {
-            return left->calculate() - right->calculate();
+            return exprSub(l, r);
         } else if (op == "*") {
-            return left->calculate() * right->calculate();
-        } else if (op == "/") {
-            int divisor = right->calculate();
-            if (divisor == 0) throw ParseException(ParseErrorType::DivideByZeroError, "divided by zero", lineNumber);
-            return left->calculate() / divisor;
-        } else if (op == "MOD") {
-            int divisor = right->calculate();
-            if (divisor == 0) throw ParseException(ParseErrorType::DivideByZeroError, "mod by zero", lineNumber);
-            if (divisor < 0) return left->calculate() % divisor + divisor;
-            return left->calculate() % divisor;
+            return exprMul(l, r);
         } else if (op == "**") {
-            return std::pow(left->calculate(), right->calculate());
+            return exprPow(l, r);
         } else {
             throw ParseException(ParseErrorType::InvalidExpressionError, "invalid operator", lineNumber);
         }
@@ -185,6 +186,10 @@ int ExpressionEvaluator::getValue() const {
         return root->calculate();
     }
 
+const ASTNode* ExpressionEvaluator::getRoot() const {
+        return root.get();
+    }
+
 std::string ExpressionEvaluator::syntaxTree() const {
             if (!root) {
                 std::cout << "The syntax tree is empty!" << std::endl;
@@ -354,8 +359,10 @@ std::string ExpressionEvaluator::syntaxTreeWithRunStatistics(int offset) const {
                         syntaxTree += format + std::to_string(numNode->value) + "\n";
                     } else if (const VariableNode* varNode = dynamic_cast<const VariableNode*>(current)) {
                         std::cout << offset << varNode->name << std::endl;
+                        // 还没有赋过值的变量（例如 LET 的左边在第一次执行之前）使用次数为 0
                         auto it = varNode->program->variables.find(varNode->name);
-                        syntaxTree += format + varNode->name + " " + std::to_string(it->second.usageCount) + "\n";
+                        int usage = it == varNode->program->variables.end() ? 0 : it->second.usageCount;
+                        syntaxTree += format + varNode->name + " " + std::to_string(usage) + "\n";
                     } else if (const BinaryOpNode* binOpNode = dynamic_cast<const BinaryOpNode*>(current)) {
                         std::cout << offset << binOpNode->op << std::endl;
                         syntaxTree += format + binOpNode->op + "\n";
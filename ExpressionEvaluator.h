@@ -72,6 +72,8 @@ public:
 
     int getValue() const;
 
+    const ASTNode* getRoot() const;
+
     std::string syntaxTree() const;
 
     std::string levelOrder() const;
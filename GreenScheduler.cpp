@@ -0,0 +1,157 @@
+#include "GreenScheduler.h"
+
+GreenScheduler::Task::Task(std::shared_ptr<const ProgramImage> image)
+    : id(0), context(image), state(TaskState::Ready), waiting(false), cancelled(false) {}
+
+GreenScheduler::GreenScheduler(int threads, int slice, Listener listener)
+    : slice(slice > 0 ? slice : 1), listener(listener), nextId(1), running(0), parked(0), stopping(false) {
+    if (threads <= 0) threads = static_cast<int>(std::thread::hardware_concurrency());
+    if (threads <= 0) threads = 1;
+    for (int i = 0; i < threads; ++i) workers.emplace_back(&GreenScheduler::work, this);
+}
+
+GreenScheduler::~GreenScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers) worker.join();
+}
+
+GreenScheduler::TaskId GreenScheduler::spawn(std::shared_ptr<const ProgramImage> image) {
+    std::unique_ptr<Task> task(new Task(image));
+    std::lock_guard<std::mutex> lock(mutex);
+    TaskId id = nextId++;
+    task->id = id;
+    ready.push_back(task.get());
+    tasks[id] = std::move(task);
+    wake.notify_one();
+    return id;
+}
+
+bool GreenScheduler::provideInput(TaskId id, const std::string &value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = tasks.find(id);
+    if (it == tasks.end() || it->second->cancelled) return false;
+    Task *task = it->second.get();
+    // 输入只在执行线程上交给上下文，这里只排队，上下文不会被两个线程同时访问
+    task->inputs.push_back(value);
+    if (task->state == TaskState::Parked) {
+        task->state = TaskState::Ready;
+        --parked;
+        ready.push_back(task);
+        wake.notify_one();
+    }
+    return true;
+}
+
+bool GreenScheduler::cancel(TaskId id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = tasks.find(id);
+    if (it == tasks.end() || it->second->cancelled) return false;
+    if (it->second->state == TaskState::Parked) {
+        --parked;
+        tasks.erase(it);
+    }
+    else it->second->cancelled = true;
+    return true;
+}
+
+int GreenScheduler::threadCount() const {
+    return static_cast<int>(workers.size());
+}
+
+std::size_t GreenScheduler::taskCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return tasks.size();
+}
+
+std::size_t GreenScheduler::parkedCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return parked;
+}
+
+void GreenScheduler::waitIdle() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return ready.empty() && running == 0; });
+}
+
+void GreenScheduler::work() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [this] { return stopping || !ready.empty(); });
+        if (stopping) return;
+        Task *task = ready.front();
+        ready.pop_front();
+        if (task->cancelled) {
+            tasks.erase(task->id);
+            if (ready.empty() && running == 0) idle.notify_all();
+            continue;
+        }
+        task->state = TaskState::Running;
+        ++running;
+        bool feed = task->waiting && !task->inputs.empty();
+        std::string value;
+        if (feed) {
+            value.swap(task->inputs.front());
+            task->inputs.pop_front();
+            task->waiting = false;
+        }
+        lock.unlock();
+
+        if (feed) task->context.provideInput(value);
+        Program::StepResult result = task->context.step(slice);
+        std::string output = task->context.drainOutput();
+        if (!output.empty()) report(task->id, Event::Output, task->context.getCurrentLine(), output);
+
+        lock.lock();
+        bool done = result == Program::StepResult::Finished || result == Program::StepResult::Error;
+        if (task->cancelled || done) {
+            std::unique_ptr<Task> finished = std::move(tasks[task->id]);
+            tasks.erase(task->id);
+            if (!task->cancelled) {
+                lock.unlock();
+                if (result == Program::StepResult::Finished) report(task->id, Event::Finished, task->context.getCurrentLine(), "");
+                else report(task->id, Event::Error, task->context.hasParseError() ? task->context.getErrorLine() : task->context.getCurrentLine(), task->context.getError());
+                finished.reset();
+                lock.lock();
+            }
+        }
+        else if (result == Program::StepResult::NeedsInput) {
+            task->waiting = true;
+            if (task->inputs.empty()) {
+                // 先报告再挂起：挂起后 provideInput 可能让别的线程立刻运行任务，它的事件不能抢在 NeedsInput 之前。
+                // 报告期间任务仍是 Running，这时到达的输入只排队
+                lock.unlock();
+                report(task->id, Event::NeedsInput, task->context.getCurrentLine(), "");
+                lock.lock();
+            }
+            if (task->cancelled) tasks.erase(task->id);
+            else if (task->inputs.empty()) {
+                task->state = TaskState::Parked;
+                ++parked;
+            }
+            else {
+                task->state = TaskState::Ready;
+                ready.push_back(task);
+                wake.notify_one();
+            }
+        }
+        else {
+            // 时间片用完或交出输出：排到队尾，其它任务先运行
+            task->state = TaskState::Ready;
+            ready.push_back(task);
+            wake.notify_one();
+        }
+        // 事件都报告完才算空闲，waitIdle 返回时回调已经全部执行
+        --running;
+        if (ready.empty() && running == 0) idle.notify_all();
+    }
+}
+
+void GreenScheduler::report(TaskId task, Event::Kind kind, int line, const std::string &text) {
+    if (!listener) return;
+    Event event = {task, kind, line, text};
+    listener(event);
+}
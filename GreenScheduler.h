@@ -0,0 +1,91 @@
+#pragma once
+#ifndef GREENSCHEDULER_H
+#define GREENSCHEDULER_H
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "ExecutionContext.h"
+
+// GreenScheduler 在少量系统线程上轮流推进大量互不相关的运行（轻量任务）：
+// 每个任务是一个 ExecutionContext，每次最多执行 slice 条语句后回到就绪队列尾部；
+// 执行到 INPUT 而没有输入的任务被挂起，不占线程也不在队列中，provideInput 后重新就绪。
+// 任务不需要自己的栈，挂起时只保留上下文本身（变量、各行计数和待用的输入）。
+class GreenScheduler {
+public:
+    typedef long long TaskId;
+
+    struct Event {
+        enum Kind {
+            Output,      // 本次时间片新增的输出
+            NeedsInput,  // 停在 INPUT，等待 provideInput；同一任务的后续事件都在它之后
+            Finished,
+            Error        // text 为错误信息，line 为出错行
+        };
+        TaskId task;
+        Kind kind;
+        int line;
+        std::string text;
+    };
+    // 在执行线程上、不持有调度器锁时调用；同一任务的事件按发生顺序到达，
+    // 回调中可以调用 provideInput / spawn / cancel
+    typedef std::function<void(const Event &event)> Listener;
+
+    // threads <= 0 时使用 std::thread::hardware_concurrency()；slice 为每个时间片的语句数
+    GreenScheduler(int threads, int slice, Listener listener);
+    // 丢弃所有未结束的任务
+    ~GreenScheduler();
+    GreenScheduler(const GreenScheduler&) = delete;
+    GreenScheduler& operator=(const GreenScheduler&) = delete;
+
+    TaskId spawn(std::shared_ptr<const ProgramImage> image);
+    // 任务在等待输入时立即就绪，否则留给它的下一条 INPUT；任务不存在时返回 false
+    bool provideInput(TaskId task, const std::string &value);
+    // 丢弃任务，不再产生事件（正在执行的时间片除外）；任务不存在时返回 false
+    bool cancel(TaskId task);
+
+    int threadCount() const;
+    std::size_t taskCount() const;
+    std::size_t parkedCount() const;
+    // 等到没有就绪或正在执行的任务，即所有任务都已结束或挂起
+    void waitIdle();
+
+private:
+    enum class TaskState {
+        Ready,
+        Running,
+        Parked
+    };
+    struct Task {
+        TaskId id;
+        ExecutionContext context;
+        TaskState state;
+        bool waiting;                     // 上一个时间片停在 INPUT 上
+        bool cancelled;
+        std::deque<std::string> inputs;   // 还没交给上下文的输入
+        explicit Task(std::shared_ptr<const ProgramImage> image);
+    };
+
+    int slice;
+    Listener listener;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::unordered_map<TaskId, std::unique_ptr<Task>> tasks;
+    std::deque<Task*> ready;   // 被取消的任务留在队列中，取出时再删除
+    TaskId nextId;
+    int running;
+    std::size_t parked;
+    bool stopping;
+    std::vector<std::thread> workers;
+
+    void work();
+    void report(TaskId task, Event::Kind kind, int line, const std::string &text);
+};
+
+#endif // GREENSCHEDULER_H
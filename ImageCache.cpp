@@ -0,0 +1,54 @@
+#include "ImageCache.h"
+#include "Program.h"
+#include <stdexcept>
+
+ImageCache::ImageCache(const std::string &directory)
+    : path(directory.empty() ? defaultDirectory() : directory), hitCount(0), missCount(0) {}
+
+std::shared_ptr<const ProgramImage> ImageCache::get(const std::string &source, bool *hit) {
+    std::string file = path + "/" + contentHashHex(source) + ".image";
+    try {
+        std::shared_ptr<const ProgramImage> image = ProgramImage::load(file, source);
+        ++hitCount;
+        if (hit) *hit = true;
+        return image;
+    }
+    catch (const std::runtime_error&) {
+        // 没有缓存，或文件损坏、属于别的程序：重新解析并覆盖
+    }
+    ++missCount;
+    if (hit) *hit = false;
+
+    std::shared_ptr<const ProgramImage> image;
+    {
+        Program program;
+        program.LoadContent(source);
+        image = ProgramImage::build(program);
+    }
+    if (!image->hasErrors()) {
+        try {
+            makeDirectories(path);
+            image->save(file, source);
+        }
+        catch (const std::runtime_error&) {
+            // 缓存写不进去不影响本次运行
+        }
+    }
+    return image;
+}
+
+const std::string& ImageCache::directory() const {
+    return path;
+}
+
+long long ImageCache::hits() const {
+    return hitCount.load();
+}
+
+long long ImageCache::misses() const {
+    return missCount.load();
+}
+
+std::string ImageCache::defaultDirectory() {
+    return cacheDirectory("qbasic-images");
+}
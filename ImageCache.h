@@ -0,0 +1,34 @@
+#pragma once
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+#include <atomic>
+#include <memory>
+#include <string>
+#include "ProgramImage.h"
+
+// ImageCache 是 ProgramImage 的磁盘缓存：文件为 <directory>/<源码内容哈希>.image。
+// 第一次成功加载某个程序时写入，之后同样的源码直接映射映像文件，不再逐行加载和解析。
+// 映像中存有源码全文，加载时逐字节比较，哈希碰撞的程序只是未命中，不会用错映像。
+// 多个线程和进程可以共用同一个目录：文件先写到临时名字再改名，损坏或过期的文件被重新生成。
+class ImageCache {
+public:
+    // directory 为空时使用 defaultDirectory()
+    explicit ImageCache(const std::string &directory = "");
+
+    // 返回 source 对应的映像，缓存中没有时用 LoadContent 加载、解析并写入缓存。
+    // 加载失败时抛出 ParseException；有解析失败的行的程序照常返回，但不写入缓存。hit 为是否命中
+    std::shared_ptr<const ProgramImage> get(const std::string &source, bool *hit = nullptr);
+
+    const std::string& directory() const;
+    long long hits() const;
+    long long misses() const;
+
+    static std::string defaultDirectory();
+
+private:
+    std::string path;
+    std::atomic<long long> hitCount;
+    std::atomic<long long> missCount;
+};
+
+#endif // IMAGECACHE_H
@@ -0,0 +1,114 @@
+#include "InputProvider.h"
+#include "Exception.h"
+#include <cstring>
+
+namespace {
+
+const std::size_t chunkSize = 1 << 16;
+
+bool isBlank(const char *text, std::size_t length) {
+    for (std::size_t i = 0; i < length; ++i) {
+        char ch = text[i];
+        if (ch != ' ' && (ch < '\t' || ch > '\r')) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+InputProvider::~InputProvider() {}
+
+bool InputProvider::skip(long long count) {
+    int value;
+    for (; count > 0; --count) {
+        Status status = next(value);
+        if (status == Pending || status == Exhausted) return false;
+    }
+    return true;
+}
+
+void InputProvider::fail(Status status, int lineNumber) {
+    if (status == Invalid) throw ParseException(ParseErrorType::TypeError, "not a integer", lineNumber);
+    if (status == Exhausted) throw ParseException(ParseErrorType::InputExhaustedError, "no more input", lineNumber);
+}
+
+InputProvider::Status InteractiveInput::next(int &value) {
+    (void)value;
+    return Pending;
+}
+
+void QueueInput::push(int value) {
+    values.push_back(value);
+}
+
+bool QueueInput::pushText(const std::string &text) {
+    int value;
+    if (!parseInteger(text.data(), text.size(), value)) return false;
+    values.push_back(value);
+    return true;
+}
+
+std::size_t QueueInput::size() const {
+    return values.size();
+}
+
+InputProvider::Status QueueInput::next(int &value) {
+    if (values.empty()) return Pending;
+    value = values.front();
+    values.pop_front();
+    return Value;
+}
+
+StreamInput::StreamInput(std::FILE *stream) : stream(stream), buffer(chunkSize), begin(0), end(0), eof(stream == nullptr) {}
+
+StreamInput::StreamInput(const std::string &text) : stream(nullptr), buffer(text.begin(), text.end()), begin(0), end(text.size()), eof(true) {}
+
+// 把未处理的半行移到缓冲区开头再读一块；一行比缓冲区还长时扩大缓冲区
+bool StreamInput::refill() {
+    if (eof) return false;
+    if (begin > 0) {
+        std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+        end -= begin;
+        begin = 0;
+    }
+    if (end == buffer.size()) buffer.resize(buffer.size() * 2);
+    std::size_t got = std::fread(buffer.data() + end, 1, buffer.size() - end, stream);
+    if (got == 0) eof = true;
+    end += got;
+    return got > 0;
+}
+
+InputProvider::Status StreamInput::next(int &value) {
+    for (;;) {
+        const char *start = buffer.data() + begin;
+        const char *newline = static_cast<const char*>(std::memchr(start, '\n', end - begin));
+        if (!newline && refill()) continue;
+        // 最后一行可以没有换行符
+        std::size_t length = newline ? static_cast<std::size_t>(newline - start) : end - begin;
+        if (!newline && length == 0) return Exhausted;
+        start = buffer.data() + begin;
+        begin += newline ? length + 1 : length;
+        if (isBlank(start, length)) continue;
+        return parseInteger(start, length, value) ? Value : Invalid;
+    }
+}
+
+FileInput::FileInput(const std::string &path) : StreamInput(std::fopen(path.c_str(), "rb")) {}
+
+FileInput::~FileInput() {
+    if (stream) std::fclose(stream);
+}
+
+bool FileInput::isOpen() const {
+    return stream != nullptr;
+}
+
+StdinInput::StdinInput() : StreamInput(stdin) {}
+
+TextInput::TextInput(const std::string &text) : StreamInput(text) {}
+
+GeneratorInput::GeneratorInput(Generator generator) : generator(generator) {}
+
+InputProvider::Status GeneratorInput::next(int &value) {
+    return generator(value) ? Value : Exhausted;
+}
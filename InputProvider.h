@@ -0,0 +1,100 @@
+#pragma once
+#ifndef INPUTPROVIDER_H
+#define INPUTPROVIDER_H
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+#include "Typedef.h"
+
+// InputProvider 为 INPUT 语句提供值。交互式输入返回 Pending，由 Program::step 返回
+// NeedsInput 并等调用方 provideInput；其它实现直接给出整数，INPUT 不必离开执行循环，
+// 也可以在优化层中执行。文本统一由 parseInteger 解析，不走 std::stoi 和异常。
+class InputProvider {
+public:
+    enum Status {
+        Value,      // value 中是下一个值
+        Pending,    // 暂时没有值，暂停运行等待输入
+        Exhausted,  // 输入已经用完
+        Invalid     // 下一个值不是 int 范围内的整数（该值已被取走）
+    };
+
+    virtual ~InputProvider();
+    virtual Status next(int &value) = 0;
+    // 跳过 count 个值（不合法的值也算一个），用于从检查点恢复时回到原来的输入位置；
+    // 中途遇到 Pending 或 Exhausted 时返回 false
+    virtual bool skip(long long count);
+
+    // 把 Invalid / Exhausted 转成与解释器一致的 ParseException
+    static void fail(Status status, int lineNumber);
+};
+
+// 图形界面等交互式来源：每次都要求调用方通过 provideInput 给出文本
+class InteractiveInput : public InputProvider {
+public:
+    Status next(int &value) override;
+};
+
+// 内存中的队列，取空时返回 Pending，可以补充后继续运行
+class QueueInput : public InputProvider {
+public:
+    void push(int value);
+    bool pushText(const std::string &text);   // 不是整数时返回 false，不入队
+    std::size_t size() const;
+    Status next(int &value) override;
+
+private:
+    std::deque<int> values;
+};
+
+// 按块读取的行输入，每行一个值，空白行跳过
+class StreamInput : public InputProvider {
+public:
+    Status next(int &value) override;
+
+protected:
+    explicit StreamInput(std::FILE *stream);
+    // 整段文本已在内存中，不再读取
+    explicit StreamInput(const std::string &text);
+    std::FILE *stream;
+
+private:
+    std::vector<char> buffer;
+    std::size_t begin;
+    std::size_t end;
+    bool eof;
+
+    bool refill();
+};
+
+class FileInput : public StreamInput {
+public:
+    explicit FileInput(const std::string &path);
+    ~FileInput();
+    bool isOpen() const;
+};
+
+class StdinInput : public StreamInput {
+public:
+    StdinInput();
+};
+
+// 内存中的多行文本，规则与 FileInput 相同，用完后返回 Exhausted
+class TextInput : public StreamInput {
+public:
+    explicit TextInput(const std::string &text);
+};
+
+// 每次 INPUT 调用一次生成函数，返回 false 表示输入结束
+class GeneratorInput : public InputProvider {
+public:
+    typedef std::function<bool(int &value)> Generator;
+    explicit GeneratorInput(Generator generator);
+    Status next(int &value) override;
+
+private:
+    Generator generator;
+};
+
+#endif // INPUTPROVIDER_H
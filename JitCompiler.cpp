@@ -0,0 +1,575 @@
+#include "JitCompiler.h"
+#include "TierManager.h"
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <map>
+#include <memory>
+
+#ifdef QBASIC_JIT_SUPPORTED
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef QBASIC_JIT_SUPPORTED
+
+enum Reg {
+    RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7,
+    R8 = 8, R9 = 9, R10 = 10, R11 = 11, R12 = 12, R13 = 13, R14 = 14, R15 = 15
+};
+
+enum Cond {
+    CondE = 0x4,
+    CondNE = 0x5,
+    CondNS = 0x9,
+    CondL = 0xC,
+    CondGE = 0xD,
+    CondG = 0xF
+};
+
+// 区域内不调用任何函数，所以除了临时寄存器 rax/rcx/rdx 和状态指针 rbp 之外都可以放变量
+const int variableRegisters[] = {RBX, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15};
+const int maxRegisterVariables = sizeof(variableRegisters) / sizeof(variableRegisters[0]);
+
+// 只实现区域编译需要的那一小部分 x86-64 指令
+class Emitter {
+public:
+    std::vector<unsigned char> buf;
+
+    std::size_t position() const { return buf.size(); }
+
+    void byte(unsigned char b) { buf.push_back(b); }
+
+    void imm32(std::int32_t v) {
+        unsigned char bytes[4];
+        std::memcpy(bytes, &v, 4);
+        buf.insert(buf.end(), bytes, bytes + 4);
+    }
+
+    void imm64(std::uint64_t v) {
+        unsigned char bytes[8];
+        std::memcpy(bytes, &v, 8);
+        buf.insert(buf.end(), bytes, bytes + 8);
+    }
+
+    void rex(bool wide, int reg, int rm) {
+        unsigned char prefix = 0x40 | (wide ? 0x08 : 0) | (((reg >> 3) & 1) << 2) | ((rm >> 3) & 1);
+        if (prefix != 0x40) byte(prefix);
+    }
+
+    void modrmDirect(int reg, int rm) { byte(0xC0 | ((reg & 7) << 3) | (rm & 7)); }
+
+    // 32 位寄存器间运算：add 0x01 / sub 0x29 / cmp 0x39 / mov 0x89 / test 0x85
+    void aluRegReg(unsigned char opcode, int dst, int src) {
+        rex(false, src, dst);
+        byte(opcode);
+        modrmDirect(src, dst);
+    }
+
+    // 81 /ext id：add /0、sub /5、cmp /7
+    void aluRegImm(int ext, int dst, std::int32_t v) {
+        rex(false, 0, dst);
+        byte(0x81);
+        modrmDirect(ext, dst);
+        imm32(v);
+    }
+
+    void imulRegReg(int dst, int src) {
+        rex(false, dst, src);
+        byte(0x0F);
+        byte(0xAF);
+        modrmDirect(dst, src);
+    }
+
+    void imulRegImm(int dst, int src, std::int32_t v) {
+        rex(false, dst, src);
+        byte(0x69);
+        modrmDirect(dst, src);
+        imm32(v);
+    }
+
+    void movRegReg(int dst, int src) { aluRegReg(0x89, dst, src); }
+
+    void movRegImm(int dst, std::int32_t v) {
+        rex(false, 0, dst);
+        byte(0xB8 | (dst & 7));
+        imm32(v);
+    }
+
+    void movRegImm64(int dst, std::uint64_t v) {
+        byte(0x48 | ((dst >> 3) & 1));
+        byte(0xB8 | (dst & 7));
+        imm64(v);
+    }
+
+    // mov r32, [base] / mov [base], r32，base 只用 rcx、rdx（无需 SIB 和位移）
+    void load(int dst, int base) {
+        rex(false, dst, base);
+        byte(0x8B);
+        byte(((dst & 7) << 3) | (base & 7));
+    }
+
+    void store(int base, int src) {
+        rex(false, src, base);
+        byte(0x89);
+        byte(((src & 7) << 3) | (base & 7));
+    }
+
+    void push(int r) {
+        if (r >= 8) byte(0x41);
+        byte(0x50 | (r & 7));
+    }
+
+    void pop(int r) {
+        if (r >= 8) byte(0x41);
+        byte(0x58 | (r & 7));
+    }
+
+    // inc qword [rbp + disp32]
+    void incCounter(std::int32_t disp) {
+        byte(0x48);
+        byte(0xFF);
+        byte(0x85);
+        imm32(disp);
+    }
+
+    // cmp qword [rbp + disp32], imm32 / sub qword [rbp + disp32], imm32
+    void cmpCounter(std::int32_t disp, std::int32_t v) {
+        byte(0x48);
+        byte(0x81);
+        byte(0xBD);
+        imm32(disp);
+        imm32(v);
+    }
+
+    void subCounter(std::int32_t disp, std::int32_t v) {
+        byte(0x48);
+        byte(0x81);
+        byte(0xAD);
+        imm32(disp);
+        imm32(v);
+    }
+
+    // mov [rbp + disp32], rsp / mov rsp, [rbp + disp32]
+    void saveStackPointer(std::int32_t disp) {
+        byte(0x48);
+        byte(0x89);
+        byte(0xA5);
+        imm32(disp);
+    }
+
+    void restoreStackPointer(std::int32_t disp) {
+        byte(0x48);
+        byte(0x8B);
+        byte(0xA5);
+        imm32(disp);
+    }
+
+    // cmp dword [base], 0，base 只用 rcx、rdx
+    void cmpMemZero(int base) {
+        byte(0x83);
+        byte(0x38 | (base & 7));
+        byte(0x00);
+    }
+
+    void cdq() { byte(0x99); }
+
+    void idiv(int r) {
+        rex(false, 0, r);
+        byte(0xF7);
+        modrmDirect(7, r);
+    }
+
+    std::size_t jcc(int cond) {
+        byte(0x0F);
+        byte(0x80 | cond);
+        std::size_t at = position();
+        imm32(0);
+        return at;
+    }
+
+    std::size_t jmp() {
+        byte(0xE9);
+        std::size_t at = position();
+        imm32(0);
+        return at;
+    }
+
+    void patch(std::size_t at, std::size_t target) {
+        std::int32_t rel = static_cast<std::int32_t>(static_cast<std::int64_t>(target) - static_cast<std::int64_t>(at + 4));
+        std::memcpy(&buf[at], &rel, 4);
+    }
+
+    void ret() { byte(0xC3); }
+};
+
+bool usesPow(const CompiledExpression &expr) {
+    for (const ExprInstr &instr : expr.instructions()) {
+        if (instr.op == ExprOp::Pow) return true;
+    }
+    return false;
+}
+
+#endif // QBASIC_JIT_SUPPORTED
+
+} // namespace
+
+JitRegion::JitRegion() : code(nullptr), size(0) {}
+
+JitRegion::~JitRegion() {
+#ifdef QBASIC_JIT_SUPPORTED
+    if (code) munmap(code, size);
+#endif
+}
+
+int JitRegion::entryOf(const OptimizedStatement *opt) const {
+    for (std::size_t i = 0; i < statements.size(); ++i) {
+        if (statements[i].opt == opt) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+int JitRegion::firstLine() const {
+    return statements.empty() ? TierManager::noLine : statements.front().opt->lineNumber;
+}
+
+int JitRegion::lastLine() const {
+    return statements.empty() ? TierManager::noLine : statements.back().opt->lineNumber;
+}
+
+std::size_t JitRegion::codeSize() const {
+    return size;
+}
+
+long long JitRegion::flushCounters() {
+    long long total = 0;
+    for (std::size_t i = 0; i < statements.size(); ++i) {
+        std::int64_t &first = state[2 + 2 * i];
+        std::int64_t &second = state[3 + 2 * i];
+        if (first == 0 && second == 0) continue;
+        OptimizedStatement *opt = statements[i].opt;
+        if (opt->type == statementType::IF) {
+            *opt->trueTime += static_cast<int>(first);
+            *opt->falseTime += static_cast<int>(second);
+        }
+        else *opt->runTime += static_cast<int>(first);
+        std::int64_t executed = first + second;
+        for (const auto &use : statements[i].usage) {
+            use.first->usageCount += static_cast<int>(executed * use.second);
+        }
+        total += executed;
+        first = 0;
+        second = 0;
+    }
+    return total;
+}
+
+JitExit JitRegion::run(int entry, long long fuel, long long &executed) {
+#ifdef QBASIC_JIT_SUPPORTED
+    typedef int (*JitFunction)(std::int64_t*, int);
+    JitFunction function = reinterpret_cast<JitFunction>(code);
+    // 进入时先预扣第一趟（从入口到区域末尾）的语句数，不够时不进入，由优化层逐条执行
+    std::int64_t pass = static_cast<std::int64_t>(statements.size()) - entry;
+    if (fuel < pass) {
+        executed = 0;
+        JitExit exit = {statements[entry].opt->lineNumber, statements[entry].opt};
+        return exit;
+    }
+    state[1] = fuel - pass;
+    int exitIndex = function(state.data(), entry);
+    executed = flushCounters();
+    return exits[exitIndex];
+#else
+    (void)entry;
+    (void)fuel;
+    executed = 0;
+    JitExit exit = {TierManager::noLine, nullptr};
+    return exit;
+#endif
+}
+
+void JitRegion::writePerfMap() const {
+#ifdef QBASIC_JIT_SUPPORTED
+    // perf 通过 /tmp/perf-<pid>.map 给 JIT 代码符号化
+    char path[64];
+    std::snprintf(path, sizeof(path), "/tmp/perf-%d.map", static_cast<int>(getpid()));
+    std::FILE *file = std::fopen(path, "a");
+    if (!file) return;
+    std::fprintf(file, "%lx %lx qbasic_jit_line_%d_to_%d\n",
+                 static_cast<unsigned long>(reinterpret_cast<std::uintptr_t>(code)),
+                 static_cast<unsigned long>(size), firstLine(), lastLine());
+    std::fclose(file);
+#endif
+}
+
+JitRegion* JitRegion::compile(const std::vector<OptimizedStatement*> &regionStatements,
+                              const std::vector<VariableInfo*> &slotTable,
+                              const std::atomic<int> *interrupt) {
+#ifndef QBASIC_JIT_SUPPORTED
+    (void)regionStatements;
+    (void)slotTable;
+    (void)interrupt;
+    return nullptr;
+#else
+    if (regionStatements.empty()) return nullptr;
+
+    // 给区域内用到的每个槽位分配一个寄存器
+    std::map<int, int> slotRegister;
+    for (OptimizedStatement *opt : regionStatements) {
+        std::vector<int> loads;
+        opt->lhs.collectLoads(loads);
+        opt->rhs.collectLoads(loads);
+        if (opt->type == statementType::LET) loads.push_back(opt->target);
+        for (int slot : loads) {
+            if (slotRegister.count(slot)) continue;
+            if (static_cast<int>(slotRegister.size()) >= maxRegisterVariables) return nullptr;
+            int index = static_cast<int>(slotRegister.size());
+            slotRegister[slot] = variableRegisters[index];
+        }
+    }
+
+    std::unique_ptr<JitRegion> region(new JitRegion());
+    std::map<int, int> lineIndex;
+    for (std::size_t i = 0; i < regionStatements.size(); ++i) {
+        OptimizedStatement *opt = regionStatements[i];
+        StatementInfo info;
+        info.opt = opt;
+        std::map<VariableInfo*, int> weights;
+        std::vector<int> loads;
+        opt->lhs.collectLoads(loads);
+        int increment = (opt->type == statementType::IF) ? 2 : 1;
+        for (int slot : loads) weights[slotTable[slot]] += increment;
+        loads.clear();
+        opt->rhs.collectLoads(loads);
+        for (int slot : loads) weights[slotTable[slot]] += increment;
+        for (const auto &w : weights) info.usage.push_back(w);
+        region->statements.push_back(info);
+        lineIndex[opt->lineNumber] = static_cast<int>(i);
+    }
+    region->state.assign(2 + 2 * regionStatements.size(), 0);
+
+    Emitter e;
+    std::vector<std::size_t> labels(regionStatements.size(), 0);
+    std::vector<std::pair<std::size_t, int>> labelFixups;   // (位置, 语句下标)
+    std::vector<std::size_t> commonExitFixups;
+    std::vector<std::pair<std::size_t, int>> bailFixups;    // 表达式中途退出：(位置, 出口下标)
+
+    auto exitTo = [&](int line, OptimizedStatement *opt) {
+        int index = static_cast<int>(region->exits.size());
+        JitExit exit = {line, opt};
+        region->exits.push_back(exit);
+        e.movRegImm(RAX, index);
+        commonExitFixups.push_back(e.jmp());
+    };
+    // from 为发出跳转的语句下标；回跳前预扣下一趟（从目标行到区域末尾）最多执行的语句数，
+    // 剩余不够时在目标行退出，所以执行的语句数不会超过 run 给的 fuel；再检查中断标志，置位时同样在目标行退出
+    auto jumpTo = [&](int line, OptimizedStatement *opt, std::size_t from) {
+        auto found = lineIndex.find(line);
+        if (found == lineIndex.end()) {
+            exitTo(line, opt);
+            return;
+        }
+        if (static_cast<std::size_t>(found->second) <= from) {
+            std::int32_t pass = static_cast<std::int32_t>(regionStatements.size() - found->second);
+            e.cmpCounter(8, pass);
+            std::size_t hasFuel = e.jcc(CondGE);
+            exitTo(line, opt);
+            e.patch(hasFuel, e.position());
+            e.subCounter(8, pass);
+        }
+        if (interrupt && static_cast<std::size_t>(found->second) <= from) {
+            e.movRegImm64(RDX, reinterpret_cast<std::uint64_t>(interrupt));
+            e.cmpMemZero(RDX);
+            std::size_t quiet = e.jcc(CondE);
+            exitTo(line, opt);
+            e.patch(quiet, e.position());
+        }
+        labelFixups.push_back(std::make_pair(e.jmp(), found->second));
+    };
+    auto counterDisp = [](std::size_t index, int which) {
+        return static_cast<std::int32_t>(8 * (2 + 2 * index + which));
+    };
+
+    // 表达式结果放在 eax，更深的操作数压在机器栈上
+    auto emitExpression = [&](const CompiledExpression &expr, int bailExit) {
+        const std::vector<ExprInstr> &code = expr.instructions();
+        int depth = 0;
+        for (std::size_t k = 0; k < code.size(); ++k) {
+            const ExprInstr &instr = code[k];
+            if (instr.op == ExprOp::Const || instr.op == ExprOp::Load) {
+                ExprOp following = (k + 1 < code.size()) ? code[k + 1].op : ExprOp::Const;
+                bool fused = depth > 0 && (following == ExprOp::Add || following == ExprOp::Sub || following == ExprOp::Mul);
+                if (fused) {
+                    if (instr.op == ExprOp::Const) {
+                        if (following == ExprOp::Add) e.aluRegImm(0, RAX, instr.operand);
+                        else if (following == ExprOp::Sub) e.aluRegImm(5, RAX, instr.operand);
+                        else e.imulRegImm(RAX, RAX, instr.operand);
+                    }
+                    else {
+                        int reg = slotRegister[instr.operand];
+                        if (following == ExprOp::Add) e.aluRegReg(0x01, RAX, reg);
+                        else if (following == ExprOp::Sub) e.aluRegReg(0x29, RAX, reg);
+                        else e.imulRegReg(RAX, reg);
+                    }
+                    ++k;
+                    continue;
+                }
+                if (depth > 0) e.push(RAX);
+                if (instr.op == ExprOp::Const) e.movRegImm(RAX, instr.operand);
+                else e.movRegReg(RAX, slotRegister[instr.operand]);
+                ++depth;
+                continue;
+            }
+            switch (instr.op) {
+            case ExprOp::Add:
+            case ExprOp::Sub:
+            case ExprOp::Mul:
+                e.movRegReg(RCX, RAX);
+                e.pop(RAX);
+                if (instr.op == ExprOp::Add) e.aluRegReg(0x01, RAX, RCX);
+                else if (instr.op == ExprOp::Sub) e.aluRegReg(0x29, RAX, RCX);
+                else e.imulRegReg(RAX, RCX);
+                break;
+            case ExprOp::Div:
+            case ExprOp::Mod: {
+                // eax 为被除数，栈上为除数
+                e.pop(RCX);
+                e.aluRegReg(0x85, RCX, RCX);
+                bailFixups.push_back(std::make_pair(e.jcc(CondE), bailExit));
+                e.cdq();
+                e.idiv(RCX);
+                if (instr.op == ExprOp::Mod) {
+                    e.movRegReg(RAX, RDX);
+                    e.aluRegReg(0x85, RCX, RCX);
+                    std::size_t nonNegative = e.jcc(CondNS);
+                    e.aluRegReg(0x01, RAX, RCX);
+                    e.patch(nonNegative, e.position());
+                }
+                break;
+            }
+            default:
+                break;
+            }
+            --depth;
+        }
+    };
+
+    // 序言：保存被调用者保存寄存器，rbp 指向计数器区，把变量装入寄存器
+    e.push(RBX);
+    e.push(RBP);
+    e.push(R12);
+    e.push(R13);
+    e.push(R14);
+    e.push(R15);
+    e.byte(0x48); e.byte(0x89); e.byte(0xFD); // mov rbp, rdi
+    e.movRegReg(RCX, RSI);
+    e.saveStackPointer(0);
+    for (const auto &entry : slotRegister) {
+        e.movRegImm64(RDX, reinterpret_cast<std::uint64_t>(&slotTable[entry.first]->value));
+        e.load(entry.second, RDX);
+    }
+    for (std::size_t i = 0; i < regionStatements.size(); ++i) {
+        e.aluRegImm(7, RCX, static_cast<std::int32_t>(i));
+        labelFixups.push_back(std::make_pair(e.jcc(CondE), static_cast<int>(i)));
+    }
+    exitTo(regionStatements.front()->lineNumber, regionStatements.front());
+
+    for (std::size_t i = 0; i < regionStatements.size(); ++i) {
+        OptimizedStatement *opt = regionStatements[i];
+        labels[i] = e.position();
+
+        bool bailOut = opt->type == statementType::PRINT || opt->type == statementType::INPUT
+                || usesPow(opt->lhs) || usesPow(opt->rhs);
+        if (bailOut) {
+            // 交给优化层执行本行
+            exitTo(opt->lineNumber, opt);
+            continue;
+        }
+
+        // 中途退出（除零等）时回到本行开头，由优化层重新执行并抛出异常
+        int bailExit = static_cast<int>(region->exits.size());
+        JitExit bail = {opt->lineNumber, opt};
+        region->exits.push_back(bail);
+
+        switch (opt->type) {
+        case statementType::LET:
+            emitExpression(opt->lhs, bailExit);
+            e.movRegReg(slotRegister[opt->target], RAX);
+            e.incCounter(counterDisp(i, 0));
+            break;
+        case statementType::IF: {
+            emitExpression(opt->lhs, bailExit);
+            e.push(RAX);
+            emitExpression(opt->rhs, bailExit);
+            e.movRegReg(RCX, RAX);
+            e.pop(RAX);
+            e.aluRegReg(0x39, RAX, RCX);
+            int cond = opt->ifOperator == '=' ? CondE : (opt->ifOperator == '<' ? CondL : CondG);
+            std::size_t taken = 0;
+            bool canBeTaken = opt->ifOperator == '=' || opt->ifOperator == '<' || opt->ifOperator == '>';
+            if (canBeTaken) taken = e.jcc(cond);
+            e.incCounter(counterDisp(i, 1));
+            bool fallsIntoNext = i + 1 < regionStatements.size() && regionStatements[i + 1]->lineNumber == opt->nextLine;
+            if (!fallsIntoNext) jumpTo(opt->nextLine, opt->next, i);
+            else labelFixups.push_back(std::make_pair(e.jmp(), static_cast<int>(i + 1)));
+            if (canBeTaken) {
+                e.patch(taken, e.position());
+                e.incCounter(counterDisp(i, 0));
+                jumpTo(opt->jumpLine, opt->jump, i);
+            }
+            continue;
+        }
+        case statementType::GOTO:
+            e.incCounter(counterDisp(i, 0));
+            jumpTo(opt->jumpLine, opt->jump, i);
+            continue;
+        default:
+            e.incCounter(counterDisp(i, 0));
+            break;
+        }
+        bool fallsIntoNext = i + 1 < regionStatements.size() && regionStatements[i + 1]->lineNumber == opt->nextLine;
+        if (!fallsIntoNext) jumpTo(opt->nextLine, opt->next, i);
+    }
+
+    // 表达式中途退出：恢复栈指针后走公共出口
+    for (const auto &fixup : bailFixups) {
+        e.patch(fixup.first, e.position());
+        e.restoreStackPointer(0);
+        e.movRegImm(RAX, fixup.second);
+        commonExitFixups.push_back(e.jmp());
+    }
+
+    // 公共出口：把寄存器中的变量写回，恢复寄存器并返回出口下标
+    std::size_t commonExit = e.position();
+    for (const auto &entry : slotRegister) {
+        e.movRegImm64(RCX, reinterpret_cast<std::uint64_t>(&slotTable[entry.first]->value));
+        e.store(RCX, entry.second);
+    }
+    e.pop(R15);
+    e.pop(R14);
+    e.pop(R13);
+    e.pop(R12);
+    e.pop(RBP);
+    e.pop(RBX);
+    e.ret();
+
+    for (std::size_t at : commonExitFixups) e.patch(at, commonExit);
+    for (const auto &fixup : labelFixups) e.patch(fixup.first, labels[fixup.second]);
+
+    std::size_t pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    std::size_t mapped = (e.buf.size() + pageSize - 1) / pageSize * pageSize;
+    void *memory = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return nullptr;
+    std::memcpy(memory, e.buf.data(), e.buf.size());
+    if (mprotect(memory, mapped, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, mapped);
+        return nullptr;
+    }
+    region->code = memory;
+    region->size = mapped;
+    region->writePerfMap();
+    return region.release();
+#endif
+}
@@ -0,0 +1,66 @@
+#pragma once
+#ifndef JITCOMPILER_H
+#define JITCOMPILER_H
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Typedef.h"
+
+struct OptimizedStatement;
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define QBASIC_JIT_SUPPORTED 1
+#endif
+
+// 离开 JIT 代码时的去向：在 line 行回到优化层（opt 为空则回到解释器）
+struct JitExit {
+    int line;
+    OptimizedStatement *opt;
+};
+
+// JitRegion 把优化层中一段连续的语句（一个热循环）翻译成 x86-64 机器码。
+// BASIC 变量在整个区域内驻留在寄存器中；PRINT、INPUT、** 以及除零/模零
+// 都会在语句开始前退出，交给优化层在同一行重新执行并按原语义报错。
+// 运行统计在机器码中按语句计数，退出时再一次性回写到各语句和变量上。
+// 调用方给出最多执行的语句数，进入时和每条回跳处预扣下一趟最多执行的语句数，不够时退出。
+class JitRegion {
+public:
+    ~JitRegion();
+
+    // 区域内语句必须按行号顺序给出；不支持的平台或变量过多时返回 nullptr。
+    // interrupt 不为空时每条回跳都检查它，非零则在回跳目标行退出
+    static JitRegion* compile(const std::vector<OptimizedStatement*> &statements,
+                              const std::vector<VariableInfo*> &slotTable,
+                              const std::atomic<int> *interrupt = nullptr);
+
+    // 从第 entry 条语句进入，最多执行 fuel 条语句，返回退出信息；executed 为实际执行完的语句数。
+    // fuel 不够从入口执行到区域末尾时不进入，直接在入口行退出
+    JitExit run(int entry, long long fuel, long long &executed);
+
+    int entryOf(const OptimizedStatement *opt) const;
+    int firstLine() const;
+    int lastLine() const;
+    std::size_t codeSize() const;
+
+private:
+    struct StatementInfo {
+        OptimizedStatement *opt;
+        std::vector<std::pair<VariableInfo*, int>> usage; // 每执行一次各变量增加的使用次数
+    };
+
+    JitRegion();
+
+    void *code;
+    std::size_t size;
+    std::vector<StatementInfo> statements;
+    std::vector<JitExit> exits;
+    // [0] 保存栈指针，[1] 剩余语句数，之后每条语句两个计数器（IF 为真/假，其余只用第一个）
+    std::vector<std::int64_t> state;
+
+    // 回写计数器，返回其中的语句数
+    long long flushCounters();
+    void writePerfMap() const;
+};
+
+#endif // JITCOMPILER_H
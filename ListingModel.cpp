@@ -0,0 +1,72 @@
+#include "ListingModel.h"
+#include "Program.h"
+#include <QColor>
+#include <algorithm>
+
+ListingModel::ListingModel(const Program &program, QObject *parent)
+    : QAbstractListModel(parent), program(program), rows(program.lineNumbers()) {}
+
+int ListingModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : static_cast<int>(rows.size());
+}
+
+QVariant ListingModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= static_cast<int>(rows.size())) return QVariant();
+    int lineNumber = rows[index.row()];
+    if (role == Qt::DisplayRole) return QString::fromStdString(program.lineText(lineNumber));
+    if (role != Qt::ForegroundRole && role != Qt::ToolTipRole) return QVariant();
+    auto it = diagnostics.find(lineNumber);
+    if (it == diagnostics.end()) return QVariant();
+    if (role == Qt::ForegroundRole) return QColor(Qt::red);
+    return QString::fromStdString(it->second);
+}
+
+QModelIndex ListingModel::indexOfLine(int lineNumber) const {
+    int row = lowerBound(lineNumber);
+    if (row == static_cast<int>(rows.size()) || rows[row] != lineNumber) return QModelIndex();
+    return index(row);
+}
+
+void ListingModel::setDiagnostic(int lineNumber, const std::string &message) {
+    if (message.empty()) {
+        if (!diagnostics.erase(lineNumber)) return;
+    }
+    else diagnostics[lineNumber] = message;
+    lineReplaced(lineNumber);
+}
+
+void ListingModel::lineInserted(int lineNumber) {
+    int row = lowerBound(lineNumber);
+    if (row < static_cast<int>(rows.size()) && rows[row] == lineNumber) {
+        lineReplaced(lineNumber);
+        return;
+    }
+    beginInsertRows(QModelIndex(), row, row);
+    rows.insert(rows.begin() + row, lineNumber);
+    endInsertRows();
+}
+
+void ListingModel::lineReplaced(int lineNumber) {
+    QModelIndex changed = indexOfLine(lineNumber);
+    if (changed.isValid()) emit dataChanged(changed, changed);
+}
+
+void ListingModel::lineRemoved(int lineNumber) {
+    int row = lowerBound(lineNumber);
+    if (row == static_cast<int>(rows.size()) || rows[row] != lineNumber) return;
+    beginRemoveRows(QModelIndex(), row, row);
+    rows.erase(rows.begin() + row);
+    diagnostics.erase(lineNumber);
+    endRemoveRows();
+}
+
+void ListingModel::listingReset() {
+    beginResetModel();
+    rows = program.lineNumbers();
+    diagnostics.clear();
+    endResetModel();
+}
+
+int ListingModel::lowerBound(int lineNumber) const {
+    return static_cast<int>(std::lower_bound(rows.begin(), rows.end(), lineNumber) - rows.begin());
+}
@@ -0,0 +1,41 @@
+#pragma once
+#ifndef LISTINGMODEL_H
+#define LISTINGMODEL_H
+#include <QAbstractListModel>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ListingObserver.h"
+
+class Program;
+
+// 代码区的数据模型：每条语句一行，按行号排序。模型只保存行号，文本在视图绘制这一行时
+// 才向 Program 取；编辑一行时只插入、删除或刷新这一行，配合等高行的 QListView，
+// 视图也只重新布局可见的几行，编辑的开销与程序大小无关
+class ListingModel : public QAbstractListModel, public ListingObserver {
+    Q_OBJECT
+public:
+    explicit ListingModel(const Program &program, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    // lineNumber 这一行所在的位置，该行不存在时无效
+    QModelIndex indexOfLine(int lineNumber) const;
+    // 后台检查的结果：有错的行显示为红色，错误信息作为提示；message 为空表示没有错误
+    void setDiagnostic(int lineNumber, const std::string &message);
+
+    void lineInserted(int lineNumber) override;
+    void lineReplaced(int lineNumber) override;
+    void lineRemoved(int lineNumber) override;
+    void listingReset() override;
+
+private:
+    const Program &program;
+    std::vector<int> rows;   // 各行的行号，升序
+    std::unordered_map<int, std::string> diagnostics;  // 有错的行的错误信息
+
+    // 第一个行号不小于 lineNumber 的行
+    int lowerBound(int lineNumber) const;
+};
+
+#endif // LISTINGMODEL_H
@@ -0,0 +1,21 @@
+#pragma once
+#ifndef LISTINGOBSERVER_H
+#define LISTINGOBSERVER_H
+
+// ListingObserver 接收 Program 的程序清单变化：编辑一行时只通知这一行，
+// 代码区等视图据此只更新受影响的行，而不是每次编辑都重新生成整个清单。
+// 通知在修改 Program 的线程上同步发出，此时 Program 已经是修改后的状态
+class ListingObserver {
+public:
+    virtual ~ListingObserver() {}
+    // 新增了 lineNumber 这一行
+    virtual void lineInserted(int lineNumber) = 0;
+    // lineNumber 这一行的内容被替换
+    virtual void lineReplaced(int lineNumber) = 0;
+    // lineNumber 这一行被删除
+    virtual void lineRemoved(int lineNumber) = 0;
+    // 整个清单都变了（LOAD、CLEAR），重新读取全部行
+    virtual void listingReset() = 0;
+};
+
+#endif // LISTINGOBSERVER_H
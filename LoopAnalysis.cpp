@@ -0,0 +1,99 @@
+#include "LoopAnalysis.h"
+#include "Statement.h"
+#include "CompiledExpression.h"
+#include <climits>
+#include <iterator>
+
+namespace {
+
+const VariableNode* asVariable(const ASTNode *node) {
+    return dynamic_cast<const VariableNode*>(node);
+}
+
+const NumberNode* asNumber(const ASTNode *node) {
+    return dynamic_cast<const NumberNode*>(node);
+}
+
+const ASTNode* rootOf(const Arithstatement &expr) {
+    const ExpressionEvaluator *evaluator = expr.getExpressionEvaluator();
+    return evaluator ? evaluator->getRoot() : nullptr;
+}
+
+// IF 的一边恰好是变量 name 时返回 true
+bool isVariable(const ASTNode *node, const std::string &name) {
+    const VariableNode *var = asVariable(node);
+    return var && var->name == name;
+}
+
+} // namespace
+
+bool LoopAnalysis::isIncrement(const Statement *stmt, std::string &variable, int &step) {
+    if (!stmt || stmt->type != statementType::LET) return false;
+    const LETstatement *let = static_cast<const LETstatement*>(stmt);
+    const BinaryOpNode *binOp = dynamic_cast<const BinaryOpNode*>(rootOf(let->RHS));
+    if (!binOp) return false;
+    const ASTNode *left = binOp->left.get();
+    const ASTNode *right = binOp->right.get();
+    if (binOp->op == "+") {
+        if (isVariable(left, let->LHS) && asNumber(right)) step = asNumber(right)->value;
+        else if (asNumber(left) && isVariable(right, let->LHS)) step = asNumber(left)->value;
+        else return false;
+    }
+    else if (binOp->op == "-" && isVariable(left, let->LHS) && asNumber(right)) {
+        step = exprSub(0, asNumber(right)->value);
+    }
+    else return false;
+    variable = let->LHS;
+    return true;
+}
+
+std::map<int, CountingLoop> LoopAnalysis::findCountingLoops(const std::map<int, Statement*> &statements) {
+    std::map<int, CountingLoop> loops;
+    for (auto it = statements.begin(); it != statements.end(); ++it) {
+        CountingLoop loop;
+        if (!isIncrement(it->second, loop.variable, loop.step)) continue;
+        loop.incrementLine = it->first;
+
+        auto after = std::next(it);
+        if (after == statements.end()) continue;
+        const Statement *next = after->second;
+        const IFstatement *test = nullptr;
+        if (next->type == statementType::IF) {
+            // 底部测试：自增之后紧跟回跳的 IF
+            test = static_cast<const IFstatement*>(next);
+            // 尚未解析的语句没有目标行
+            if (test->toLine == INT_MIN || test->toLine > it->first) continue;
+            loop.topTest = false;
+            loop.testLine = after->first;
+            loop.gotoLine = loop.incrementLine;
+            loop.headLine = test->toLine;
+            auto exit = std::next(after);
+            loop.exitLine = (exit == statements.end()) ? INT_MIN : exit->first;
+        }
+        else if (next->type == statementType::GOTO) {
+            // 顶部测试：自增之后 GOTO 回到循环头的 IF，IF 为真时跳出循环
+            int head = static_cast<const GOTOstatement*>(next)->toLine;
+            if (head == INT_MIN) continue;
+            auto headIt = statements.find(head);
+            if (head >= it->first || headIt == statements.end() || headIt->second->type != statementType::IF) continue;
+            test = static_cast<const IFstatement*>(headIt->second);
+            if (test->toLine == INT_MIN || test->toLine <= after->first) continue;
+            loop.topTest = true;
+            loop.testLine = head;
+            loop.gotoLine = after->first;
+            loop.headLine = head;
+            loop.exitLine = test->toLine;
+        }
+        else continue;
+
+        const ASTNode *lhs = rootOf(test->LHS);
+        const ASTNode *rhs = rootOf(test->RHS);
+        if (!lhs || !rhs) continue;
+        if (isVariable(lhs, loop.variable)) loop.variableOnLeft = true;
+        else if (isVariable(rhs, loop.variable)) loop.variableOnLeft = false;
+        else continue;
+        loop.ifOperator = test->ifOperator;
+        loops[loop.incrementLine] = loop;
+    }
+    return loops;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#ifndef LOOPANALYSIS_H
+#define LOOPANALYSIS_H
+#include <map>
+#include <string>
+#include "Typedef.h"
+
+class Statement;
+
+// 由 IF/GOTO 构成的计数循环，两种规范形式：
+//   底部测试  head: ...  inc: LET i = i + c   test: IF i op bound THEN head
+//   顶部测试  test: IF i op bound THEN exit  ...  inc: LET i = i + c   goto: GOTO test
+// IF 的两边可以交换（IF bound op i）。
+struct CountingLoop {
+    std::string variable;  // 归纳变量
+    int step;              // 每次迭代的增量（LET i = i - c 记为 -c，按 32 位回绕）
+    int headLine;          // 回跳目标，即循环的第一行
+    int incrementLine;     // LET i = i + c
+    int testLine;          // IF i op bound THEN ...
+    int gotoLine;          // 顶部测试形式中紧跟自增的 GOTO，底部测试形式中等于 incrementLine
+    int exitLine;          // 退出循环后执行的行，程序在此结束时为 INT_MIN
+    bool topTest;
+    bool variableOnLeft;   // 归纳变量在 IF 的左边
+    char ifOperator;
+};
+
+// LoopAnalysis 在语句表上识别计数循环，只使用已解析的语句，
+// 本次运行中还没有 parse 过的语句不参与识别。
+class LoopAnalysis {
+public:
+    // 以自增语句的行号为键
+    static std::map<int, CountingLoop> findCountingLoops(const std::map<int, Statement*> &statements);
+
+    // LET v = v + c / c + v / v - c 时返回 true 并给出增量
+    static bool isIncrement(const Statement *stmt, std::string &variable, int &step);
+};
+
+#endif // LOOPANALYSIS_H
@@ -0,0 +1,359 @@
+#include "LoopSummary.h"
+#include "Statement.h"
+#include <algorithm>
+#include <climits>
+#include <set>
+
+namespace {
+
+const int maxDegree = 6;
+const std::uint64_t wordModulus = 1ULL << 32;
+
+// 不含变量的子树（如 7 / 3、2 ** 3）能被 CompiledExpression 折叠成常量；除零不会折叠
+bool isConstantTree(const ASTNode *node) {
+    CompiledExpression folded;
+    CompiledExpression::SlotResolver none = [](const std::string&) { return -1; };
+    return folded.compile(node, none, -1) && folded.isConstant();
+}
+
+// E 关于归纳变量的次数；不是多项式或读了循环内被赋值的变量时返回 -1
+int degreeOf(const ASTNode *node, const std::string &induction, const std::set<std::string> &assigned) {
+    if (dynamic_cast<const NumberNode*>(node)) return 0;
+    if (const VariableNode *var = dynamic_cast<const VariableNode*>(node)) {
+        if (var->name == induction) return 1;
+        return assigned.count(var->name) ? -1 : 0;
+    }
+    const BinaryOpNode *binOp = dynamic_cast<const BinaryOpNode*>(node);
+    if (!binOp) return -1;
+    if (binOp->op != "+" && binOp->op != "-" && binOp->op != "*") return isConstantTree(node) ? 0 : -1;
+    int l = degreeOf(binOp->left.get(), induction, assigned);
+    int r = degreeOf(binOp->right.get(), induction, assigned);
+    if (l < 0 || r < 0) return -1;
+    int degree = (binOp->op == "*") ? l + r : std::max(l, r);
+    return degree > maxDegree ? -1 : degree;
+}
+
+const ASTNode* rootOf(const Arithstatement &expr) {
+    const ExpressionEvaluator *evaluator = expr.getExpressionEvaluator();
+    return evaluator ? evaluator->getRoot() : nullptr;
+}
+
+bool isVariable(const ASTNode *node, const std::string &name) {
+    const VariableNode *var = dynamic_cast<const VariableNode*>(node);
+    return var && var->name == name;
+}
+
+// 按 CompiledExpression::evaluate 的回绕语义求值，归纳变量取 x，不计使用次数
+int evaluateWrapped(const CompiledExpression &expr, VariableInfo* const* slotValues, int inductionSlot, int x) {
+    std::vector<int> stack;
+    for (const ExprInstr &instr : expr.instructions()) {
+        switch (instr.op) {
+        case ExprOp::Const: stack.push_back(instr.operand); break;
+        case ExprOp::Load: stack.push_back(instr.operand == inductionSlot ? x : slotValues[instr.operand]->value); break;
+        case ExprOp::Add: stack[stack.size() - 2] = exprAdd(stack[stack.size() - 2], stack.back()); stack.pop_back(); break;
+        case ExprOp::Sub: stack[stack.size() - 2] = exprSub(stack[stack.size() - 2], stack.back()); stack.pop_back(); break;
+        case ExprOp::Mul: stack[stack.size() - 2] = exprMul(stack[stack.size() - 2], stack.back()); stack.pop_back(); break;
+        default: break; // degreeOf 已排除其余运算
+        }
+    }
+    return stack.back();
+}
+
+// 不回绕的精确求值，任一中间结果超出 int 范围时返回 false
+bool evaluateExact(const CompiledExpression &expr, VariableInfo* const* slotValues, int inductionSlot, std::int64_t x, std::int64_t &result) {
+    std::vector<std::int64_t> stack;
+    for (const ExprInstr &instr : expr.instructions()) {
+        std::int64_t value;
+        switch (instr.op) {
+        case ExprOp::Const: stack.push_back(instr.operand); continue;
+        case ExprOp::Load: stack.push_back(instr.operand == inductionSlot ? x : slotValues[instr.operand]->value); continue;
+        case ExprOp::Add: value = stack[stack.size() - 2] + stack.back(); break;
+        case ExprOp::Sub: value = stack[stack.size() - 2] - stack.back(); break;
+        case ExprOp::Mul: value = stack[stack.size() - 2] * stack.back(); break;
+        default: return false;
+        }
+        if (value < INT_MIN || value > INT_MAX) return false;
+        stack.pop_back();
+        stack.back() = value;
+    }
+    result = stack.back();
+    return result >= INT_MIN && result <= INT_MAX;
+}
+
+std::uint64_t residue(std::int64_t value, std::uint64_t modulus) {
+    std::int64_t m = static_cast<std::int64_t>(modulus);
+    return static_cast<std::uint64_t>(((value % m) + m) % m);
+}
+
+// C(n, k) mod modulus（modulus <= 2^32）：先把 k! 的质因子从 n(n-1)...(n-k+1) 中约掉再相乘
+std::uint64_t binomialMod(std::uint64_t n, int k, std::uint64_t modulus) {
+    if (static_cast<std::uint64_t>(k) > n) return 0;
+    std::vector<std::uint64_t> terms;
+    for (int j = 0; j < k; ++j) terms.push_back(n - j);
+    for (int d = 2; d <= k; ++d) {
+        int rest = d;
+        for (int p = 2; p <= rest; ++p) {
+            while (rest % p == 0) {
+                rest /= p;
+                for (std::uint64_t &term : terms) {
+                    if (term % p == 0) { term /= p; break; }
+                }
+            }
+        }
+    }
+    std::uint64_t result = 1 % modulus;
+    for (std::uint64_t term : terms) result = result * (term % modulus) % modulus;
+    return result;
+}
+
+// sum_{k<count} P(k) mod modulus，points 为 P(0..d)，用牛顿前向差分公式
+std::uint64_t sumOfPolynomial(std::vector<std::uint64_t> points, std::uint64_t count, std::uint64_t modulus) {
+    std::uint64_t sum = 0;
+    for (std::size_t j = 0; j < points.size(); ++j) {
+        sum = (sum + points[0] * binomialMod(count, static_cast<int>(j) + 1, modulus)) % modulus;
+        for (std::size_t k = 0; k + 1 < points.size() - j; ++k) {
+            points[k] = (points[k + 1] + modulus - points[k]) % modulus;
+        }
+    }
+    return sum;
+}
+
+int wrapCount(std::uint64_t count) {
+    return static_cast<int>(static_cast<std::uint32_t>(count));
+}
+
+void addWrapped(int &counter, std::uint64_t amount) {
+    counter = exprAdd(counter, wrapCount(amount));
+}
+
+} // namespace
+
+LoopSummary::LoopSummary() : inductionSlot(-1), trueTime(nullptr), falseTime(nullptr) {}
+
+int LoopSummary::entryLine() const {
+    return loop.topTest ? loop.testLine : loop.headLine;
+}
+
+int LoopSummary::exitLine() const {
+    return loop.exitLine;
+}
+
+std::unique_ptr<LoopSummary> LoopSummary::build(const CountingLoop &loop,
+                                                const std::map<int, Statement*> &statements,
+                                                const CompiledExpression::SlotResolver &resolve) {
+    std::unique_ptr<LoopSummary> summary(new LoopSummary());
+    summary->loop = loop;
+    summary->inductionSlot = resolve(loop.variable);
+    if (summary->inductionSlot < 0) return nullptr;
+
+    // 循环体：底部测试为 [head, 自增)，顶部测试为 (IF, 自增)
+    auto first = loop.topTest ? statements.upper_bound(loop.testLine) : statements.find(loop.headLine);
+    auto increment = statements.find(loop.incrementLine);
+    auto test = statements.find(loop.testLine);
+    if (first == statements.end() || increment == statements.end() || test == statements.end()) return nullptr;
+
+    std::set<std::string> assigned;
+    assigned.insert(loop.variable);
+    std::vector<LETstatement*> body;
+    for (auto it = first; it != increment; ++it) {
+        if (it == statements.end()) return nullptr;
+        Statement *stmt = it->second;
+        if (stmt->getRunTime() <= 0) return nullptr;
+        if (stmt->type == statementType::REM) {
+            summary->otherRunTimes.push_back(&stmt->runTime);
+            continue;
+        }
+        if (stmt->type != statementType::LET) return nullptr;
+        LETstatement *let = static_cast<LETstatement*>(stmt);
+        if (!assigned.insert(let->LHS).second) return nullptr; // 每个变量只允许一条赋值
+        body.push_back(let);
+    }
+
+    for (LETstatement *let : body) {
+        const ASTNode *root = rootOf(let->RHS);
+        if (!root) return nullptr;
+        Update update;
+        update.target = resolve(let->LHS);
+        update.modulus = 0;
+        update.runTime = &let->runTime;
+        const ASTNode *term = root;
+        update.kind = UpdateKind::Assign;
+        const BinaryOpNode *binOp = dynamic_cast<const BinaryOpNode*>(root);
+        if (binOp && binOp->op == "MOD") {
+            // v = (v + E) MOD m
+            const BinaryOpNode *sum = dynamic_cast<const BinaryOpNode*>(binOp->left.get());
+            CompiledExpression divisor;
+            if (!sum || sum->op != "+" || !divisor.compile(binOp->right.get(), resolve, let->lineNumber)) return nullptr;
+            if (!divisor.isConstant() || divisor.constantValue() <= 0) return nullptr;
+            update.kind = UpdateKind::ModSum;
+            update.modulus = divisor.constantValue();
+            binOp = sum;
+        }
+        if (binOp && binOp->op == "+" && isVariable(binOp->left.get(), let->LHS)) {
+            term = binOp->right.get();
+            if (update.kind != UpdateKind::ModSum) update.kind = UpdateKind::Sum;
+        }
+        else if (binOp && binOp->op == "+" && isVariable(binOp->right.get(), let->LHS)) {
+            term = binOp->left.get();
+            if (update.kind != UpdateKind::ModSum) update.kind = UpdateKind::Sum;
+        }
+        else if (binOp && binOp->op == "-" && isVariable(binOp->left.get(), let->LHS) && update.kind != UpdateKind::ModSum) {
+            term = binOp->right.get();
+            update.kind = UpdateKind::Difference;
+        }
+        else if (update.kind == UpdateKind::ModSum) return nullptr;
+
+        update.degree = degreeOf(term, loop.variable, assigned);
+        if (update.degree < 0 || update.target < 0) return nullptr;
+        if (update.kind == UpdateKind::ModSum && update.degree > 1) return nullptr;
+        if (!update.term.compile(term, resolve, let->lineNumber)) return nullptr;
+
+        CompiledExpression rhs;
+        if (!rhs.compile(root, resolve, let->lineNumber)) return nullptr;
+        rhs.collectLoads(summary->bodyLoads);
+        summary->updates.push_back(std::move(update));
+    }
+
+    // 自增读一次归纳变量
+    summary->otherRunTimes.push_back(&increment->second->runTime);
+    summary->bodyLoads.push_back(summary->inductionSlot);
+    if (loop.topTest) {
+        auto gotoStmt = statements.find(loop.gotoLine);
+        if (gotoStmt == statements.end()) return nullptr;
+        summary->otherRunTimes.push_back(&gotoStmt->second->runTime);
+    }
+
+    IFstatement *ifStmt = static_cast<IFstatement*>(test->second);
+    const ASTNode *boundRoot = rootOf(loop.variableOnLeft ? ifStmt->RHS : ifStmt->LHS);
+    if (!boundRoot || degreeOf(boundRoot, loop.variable, assigned) != 0) return nullptr;
+    if (!summary->bound.compile(boundRoot, resolve, loop.testLine)) return nullptr;
+    summary->bound.collectLoads(summary->testLoads);
+    summary->testLoads.push_back(summary->inductionSlot);
+    summary->trueTime = &ifStmt->trueTime;
+    summary->falseTime = &ifStmt->falseTime;
+    return summary;
+}
+
+// 循环体执行的次数：底部测试为第一个使 IF 为假的 n >= 1，顶部测试为第一个使 IF 为真的 n >= 0，
+// 其中第 n 次测试时归纳变量为 start + n * step。途中会回绕或永不终止时返回 false
+bool LoopSummary::tripCount(std::int64_t start, std::int64_t limit, std::uint64_t &count) const {
+    std::int64_t step = loop.step;
+    std::int64_t first = loop.topTest ? 0 : 1;
+    char op = loop.ifOperator;
+    if (!loop.variableOnLeft && op != '=') op = (op == '<') ? '>' : '<';
+    bool exitOnTrue = loop.topTest;
+    auto exits = [&](std::int64_t x) {
+        bool holds = (op == '<') ? x < limit : (op == '>') ? x > limit : x == limit;
+        return holds == exitOnTrue;
+    };
+
+    std::int64_t n;
+    if (exits(start + first * step)) n = first;
+    else if (op == '=') {
+        if (step == 0) return false;
+        if (!exitOnTrue) n = first + 1;
+        else {
+            std::int64_t distance = limit - start;
+            if (distance % step != 0 || distance / step < first) return false;
+            n = distance / step;
+        }
+    }
+    else if ((op == '<') != exitOnTrue) {
+        // 归纳变量增长到 target 以上时退出
+        if (step <= 0) return false;
+        std::int64_t target = (op == '<') ? limit : limit + 1;
+        n = (target - start + step - 1) / step;
+    }
+    else {
+        // 归纳变量减小到 target 以下时退出
+        if (step >= 0) return false;
+        std::int64_t target = (op == '>') ? limit : limit - 1;
+        n = (start - target - step - 1) / -step;
+    }
+    std::int64_t last = start + n * step;
+    if (last < INT_MIN || last > INT_MAX) return false;
+    count = static_cast<std::uint64_t>(n);
+    return true;
+}
+
+bool LoopSummary::computeUpdate(const Update &update, VariableInfo* const* slotValues, std::int64_t start, std::uint64_t count, int &value) const {
+    int current = slotValues[update.target]->value;
+    value = current;
+    if (count == 0) return true;
+    std::int64_t step = loop.step;
+    switch (update.kind) {
+    case UpdateKind::Assign: {
+        std::int64_t last = start + static_cast<std::int64_t>(count - 1) * step;
+        value = evaluateWrapped(update.term, slotValues, inductionSlot, static_cast<int>(last));
+        return true;
+    }
+    case UpdateKind::Sum:
+    case UpdateKind::Difference: {
+        // 只含 + - * 的表达式在模 2^32 下与精确值同余，逐次回绕累加等于对精确和取模
+        std::vector<std::uint64_t> points;
+        for (int k = 0; k <= update.degree; ++k) {
+            int x = exprAdd(static_cast<int>(start), exprMul(k, loop.step));
+            points.push_back(static_cast<std::uint32_t>(evaluateWrapped(update.term, slotValues, inductionSlot, x)));
+        }
+        int sum = static_cast<int>(static_cast<std::uint32_t>(sumOfPolynomial(points, count, wordModulus)));
+        value = (update.kind == UpdateKind::Sum) ? exprAdd(current, sum) : exprSub(current, sum);
+        return true;
+    }
+    case UpdateKind::ModSum: {
+        // 只有在每一步 v + E 都非负且不溢出时，逐次取模才等于对总和取模
+        std::int64_t firstTerm, lastTerm;
+        if (!evaluateExact(update.term, slotValues, inductionSlot, start, firstTerm)) return false;
+        if (!evaluateExact(update.term, slotValues, inductionSlot, start + static_cast<std::int64_t>(count - 1) * step, lastTerm)) return false;
+        std::int64_t largest = std::max(firstTerm, lastTerm);
+        if (current < 0 || firstTerm < 0 || lastTerm < 0) return false;
+        if (current + firstTerm > INT_MAX || update.modulus - 1 + largest > INT_MAX) return false;
+        std::uint64_t modulus = static_cast<std::uint64_t>(update.modulus);
+        std::vector<std::uint64_t> points;
+        points.push_back(residue(firstTerm, modulus));
+        if (update.degree == 1 && count > 1) {
+            std::int64_t secondTerm;
+            if (!evaluateExact(update.term, slotValues, inductionSlot, start + step, secondTerm)) return false;
+            points.push_back(residue(secondTerm, modulus));
+        }
+        value = static_cast<int>((residue(current, modulus) + sumOfPolynomial(points, count, modulus)) % modulus);
+        return true;
+    }
+    }
+    return false;
+}
+
+bool LoopSummary::run(VariableInfo* const* slotValues, std::uint64_t &statements) const {
+    VariableInfo *var = slotValues[inductionSlot];
+    std::int64_t start = var->value;
+    int limit = evaluateWrapped(bound, slotValues, inductionSlot, var->value);
+    std::uint64_t count;
+    if (!tripCount(start, limit, count)) return false;
+
+    // 先算出全部结果，任何一步不满足条件都不改动状态
+    std::vector<int> values(updates.size());
+    for (std::size_t i = 0; i < updates.size(); ++i) {
+        if (!computeUpdate(updates[i], slotValues, start, count, values[i])) return false;
+    }
+    for (std::size_t i = 0; i < updates.size(); ++i) {
+        slotValues[updates[i].target]->value = values[i];
+        addWrapped(*updates[i].runTime, count);
+    }
+    var->value = static_cast<int>(start + static_cast<std::int64_t>(count) * loop.step);
+    for (int *runTime : otherRunTimes) addWrapped(*runTime, count);
+
+    std::uint64_t tests;
+    if (loop.topTest) {
+        tests = count + 1;
+        addWrapped(*falseTime, count);
+        addWrapped(*trueTime, 1);
+    }
+    else {
+        tests = count;
+        addWrapped(*trueTime, count - 1);
+        addWrapped(*falseTime, 1);
+    }
+    for (int slot : bodyLoads) addWrapped(slotValues[slot]->usageCount, count);
+    for (int slot : testLoads) addWrapped(slotValues[slot]->usageCount, 2 * tests);
+    statements = count * (updates.size() + otherRunTimes.size()) + tests;
+    return true;
+}
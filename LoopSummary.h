@@ -0,0 +1,62 @@
+#pragma once
+#ifndef LOOPSUMMARY_H
+#define LOOPSUMMARY_H
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+#include "Typedef.h"
+#include "CompiledExpression.h"
+#include "LoopAnalysis.h"
+
+class Statement;
+
+// LoopSummary 把循环体只含 LET 的计数循环整体折叠成闭式计算：
+//   v = v + E(i) / v = v - E(i)   多项式 E 在等差数列上求和（模 2^32，与逐次回绕相同）
+//   v = (v + E(i)) MOD m          E 为一次式且不会出现负数或溢出时按模 m 求和
+//   v = E(i)                      只取最后一次迭代的值
+// E 只能读归纳变量和循环内不变的变量，只含 + - *（常量子表达式除外）。
+// 运行统计（每行次数、IF 真/假次数、变量使用次数）按逐次迭代的结果一次性补上。
+class LoopSummary {
+public:
+    // 循环不满足条件时返回空指针
+    static std::unique_ptr<LoopSummary> build(const CountingLoop &loop,
+                                              const std::map<int, Statement*> &statements,
+                                              const CompiledExpression::SlotResolver &resolve);
+
+    // 在循环入口按当前变量值一次性执行整个循环，成功时返回 true，statements 为逐条执行时的语句数；
+    // 归纳变量会回绕、循环不终止或取模条件不成立时返回 false，交给逐条执行
+    bool run(VariableInfo* const* slotValues, std::uint64_t &statements) const;
+
+    int entryLine() const;   // 底部测试为循环第一行，顶部测试为 IF 所在行
+    int exitLine() const;
+
+private:
+    enum class UpdateKind { Sum, Difference, ModSum, Assign };
+
+    struct Update {
+        UpdateKind kind;
+        int target;
+        CompiledExpression term;   // E(i)
+        int degree;                // E 关于归纳变量的次数
+        int modulus;
+        int *runTime;
+    };
+
+    CountingLoop loop;
+    int inductionSlot;
+    CompiledExpression bound;
+    std::vector<Update> updates;
+    std::vector<int*> otherRunTimes;   // 自增、REM 以及顶部测试形式中的 GOTO
+    int *trueTime;
+    int *falseTime;
+    std::vector<int> bodyLoads;        // 每次迭代循环体读取的槽位（含自增读一次 i）
+    std::vector<int> testLoads;        // 每次执行 IF 读取的槽位（各按 2 次计）
+
+    LoopSummary();
+
+    bool tripCount(std::int64_t start, std::int64_t limit, std::uint64_t &count) const;
+    bool computeUpdate(const Update &update, VariableInfo* const* slotValues, std::int64_t start, std::uint64_t count, int &value) const;
+};
+
+#endif // LOOPSUMMARY_H
@@ -0,0 +1,40 @@
+#include "MappedFile.h"
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string &path) : begin(""), length(0), mapped(false) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("cannot read " + path);
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw std::runtime_error("cannot read " + path);
+    }
+    if (info.st_size > 0) {
+        length = static_cast<std::size_t>(info.st_size);
+        void *memory = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (memory == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("cannot map " + path);
+        }
+        madvise(memory, length, MADV_SEQUENTIAL);
+        begin = static_cast<const char*>(memory);
+        mapped = true;
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (mapped) munmap(const_cast<char*>(begin), length);
+}
+
+const char* MappedFile::data() const {
+    return begin;
+}
+
+std::size_t MappedFile::size() const {
+    return length;
+}
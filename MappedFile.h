@@ -0,0 +1,26 @@
+#pragma once
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+#include <cstddef>
+#include <string>
+
+// MappedFile 只读映射整个文件，析构时解除映射；空文件不映射，data() 指向空串。
+// 映射按顺序读取的提示，适合从头扫到尾的加载
+class MappedFile {
+public:
+    // 打不开或映射失败时抛出 std::runtime_error
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const;
+    std::size_t size() const;
+
+private:
+    const char *begin;
+    std::size_t length;
+    bool mapped;
+};
+
+#endif // MAPPEDFILE_H
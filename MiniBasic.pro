@@ -8,21 +8,81 @@ CONFIG += c++11
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# qmake CONFIG+=alloc_profile: install the allocation-tracking operator new/delete hooks
+alloc_profile {
+    DEFINES += QBASIC_ALLOC_PROFILE
+}
+
+# qmake CONFIG+=pgo: the first RUN of a program records a line-transition profile, later RUNs promote its hot lines on first execution and run superblocks laid out along its hottest paths
+pgo {
+    DEFINES += QBASIC_PGO
+}
+
+# qmake CONFIG+=edge_profile: record line transitions and coverage on every RUN and print the report to the console
+edge_profile {
+    DEFINES += QBASIC_EDGE_PROFILE
+}
+
+# qmake CONFIG+=record: save a replayable trace (inputs, taken jumps, output, counters) of every RUN for qbasic-replay
+record {
+    DEFINES += QBASIC_RECORD
+}
+
 SOURCES += \
+    AllocationProfiler.cpp \
+    CompiledExpression.cpp \
+    EdgeProfiler.cpp \
     Exception.cpp \
+    ExecutionContext.cpp \
+    ExecutionWorker.cpp \
     ExpressionEvaluator.cpp \
+    InputProvider.cpp \
+    JitCompiler.cpp \
+    ListingModel.cpp \
+    LoopAnalysis.cpp \
+    LoopSummary.cpp \
+    MappedFile.cpp \
+    PgoProfile.cpp \
     Program.cpp \
+    ProgramImage.cpp \
+    RunControl.cpp \
+    RunLimits.cpp \
+    RunTrace.cpp \
     Statement.cpp \
+    SyntaxTreeModel.cpp \
+    TierManager.cpp \
     Typedef.cpp \
+    ValidationWorker.cpp \
     main.cpp \
     mainwindow.cpp
 
 HEADERS += \
+    AllocationProfiler.h \
+    CompiledExpression.h \
+    EdgeProfiler.h \
     Exception.h \
+    ExecutionContext.h \
+    ExecutionWorker.h \
     ExpressionEvaluator.h \
+    InputProvider.h \
+    JitCompiler.h \
+    ListingModel.h \
+    ListingObserver.h \
+    LoopAnalysis.h \
+    LoopSummary.h \
+    MappedFile.h \
+    PgoProfile.h \
     Program.h \
+    ProgramImage.h \
+    RunControl.h \
+    RunLimits.h \
+    RunTrace.h \
+    SpscQueue.h \
     Statement.h \
+    SyntaxTreeModel.h \
+    TierManager.h \
     Typedef.h \
+    ValidationWorker.h \
     mainwindow.h
 
 FORMS += \
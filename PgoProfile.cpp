@@ -0,0 +1,76 @@
+#include "PgoProfile.h"
+#include <fstream>
+
+namespace {
+
+const char *const profileHeader = "qbasic-pgo 1";
+
+} // namespace
+
+PgoProfile::PgoProfile() {}
+
+std::uint64_t PgoProfile::edgeKey(int fromLine, int toLine) {
+    return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(fromLine)) << 32) | static_cast<std::uint32_t>(toLine);
+}
+
+void PgoProfile::clear() {
+    edges.clear();
+    lines.clear();
+}
+
+bool PgoProfile::empty() const {
+    return edges.empty();
+}
+
+void PgoProfile::add(int fromLine, int toLine, std::uint64_t times) {
+    edges[edgeKey(fromLine, toLine)] += times;
+    lines[fromLine] += times;
+}
+
+std::uint64_t PgoProfile::count(int fromLine, int toLine) const {
+    auto it = edges.find(edgeKey(fromLine, toLine));
+    return it == edges.end() ? 0 : it->second;
+}
+
+std::uint64_t PgoProfile::lineCount(int line) const {
+    auto it = lines.find(line);
+    return it == lines.end() ? 0 : it->second;
+}
+
+bool PgoProfile::isHot(int line, int threshold) const {
+    return threshold > 0 && lineCount(line) >= static_cast<std::uint64_t>(threshold);
+}
+
+bool PgoProfile::load(const std::string &directory, const std::string &key) {
+    clear();
+    std::ifstream file(directory + "/" + key + ".profile");
+    if (!file) return false;
+    std::string header;
+    if (!std::getline(file, header) || header != profileHeader) return false;
+    int from, to;
+    std::uint64_t times;
+    while (file >> from >> to >> times) add(from, to, times);
+    return !edges.empty();
+}
+
+bool PgoProfile::save(const std::string &directory, const std::string &key) const {
+    makeDirectories(directory);
+    // 先写临时文件再改名，避免另一个进程读到写了一半的文件
+    std::string path = directory + "/" + key + ".profile";
+    std::string partial = path + ".partial";
+    {
+        std::ofstream file(partial);
+        if (!file) return false;
+        file << profileHeader << "\n";
+        for (const auto &edge : edges) {
+            file << static_cast<int>(static_cast<std::uint32_t>(edge.first >> 32)) << " "
+                 << static_cast<int>(static_cast<std::uint32_t>(edge.first)) << " " << edge.second << "\n";
+        }
+        if (!file) return false;
+    }
+    return std::rename(partial.c_str(), path.c_str()) == 0;
+}
+
+std::string PgoProfile::defaultDirectory() {
+    return cacheDirectory("qbasic-pgo");
+}
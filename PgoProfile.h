@@ -0,0 +1,38 @@
+#pragma once
+#ifndef PGOPROFILE_H
+#define PGOPROFILE_H
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Typedef.h"
+
+// PgoProfile 保存一次运行中行与行之间的转移次数（from 行执行完后执行 to 行，由 EdgeProfiler 记录），
+// 按程序内容哈希保存到磁盘；之后同一程序的运行读入它，热行不必等到计数达到阈值就升层。
+class PgoProfile {
+public:
+    PgoProfile();
+
+    void clear();
+    bool empty() const;
+
+    void add(int fromLine, int toLine, std::uint64_t times);
+    std::uint64_t count(int fromLine, int toLine) const;
+    std::uint64_t lineCount(int line) const;   // 从该行出发的转移总数
+    bool isHot(int line, int threshold) const;
+
+    // 文件为 <directory>/<key>.profile，key 一般是 contentHashHex(program.display())
+    bool load(const std::string &directory, const std::string &key);
+    bool save(const std::string &directory, const std::string &key) const;
+
+    static std::string defaultDirectory();
+
+private:
+    std::unordered_map<std::uint64_t, std::uint64_t> edges;  // (from, to) -> 次数
+    std::map<int, std::uint64_t> lines;                      // from -> 出边次数之和
+
+    static std::uint64_t edgeKey(int fromLine, int toLine);
+};
+
+#endif // PGOPROFILE_H
@@ -1,7 +1,12 @@
 #include "Program.h"
 #include "Statement.h"
+#include "AllocationProfiler.h"
+#include "MappedFile.h"
 //#include "mainwindow.h"
 #include <QObject>
+#include <cctype>
+#include <climits>
+#include <stdexcept>
 
 bool hasContentAfterFirstNumber(const std::string& str) {
     bool numberFound = false; // 标记是否找到数字
@@ -26,9 +31,12 @@ bool hasContentAfterFirstNumber(const std::string& str) {
 //}
 
 void Program::reset(){
+    this->tier.invalidate();
+    this->runState = RunState::Idle;
     this->variables.clear();
     this->statements.clear();
-    this->raw.clear();
+    this->jumpReferences.clear();
+    this->dangling.clear();
     this->input.clear();
     this->output.clear();
     this->currentLine = -1;
@@ -37,86 +45,69 @@ void Program::reset(){
     this->hasEND = false;
 //    this->isInputFinished = false;
     this->isRunning = false;
+    notifyListingReset();
 }
 
 void Program::Load(const std::string path){
-        std::ifstream file(path);
-        std::string line;
-        int maxLine = -1; // Initialize with an invalid line number
-
-        if (!file.is_open()) {
-            std::cerr << "Error opening file: " << path << std::endl;
-            return;
-        }
-
-        while (getline(file, line)) {
-            // Remove leading spaces
-            line.erase(0, line.find_first_not_of(" \t"));
-
-            // Skip empty lines
-            if (line.empty()) continue;
-
-            // Read line number at the beginning of the line
-            std::istringstream iss(line);
-            raw.push_back(line);
-            int lineNumber;
-            if (!(iss >> lineNumber)) {
-//                std::cerr << "Error: Line number not found or invalid format" << std::endl;
-                throw ParseException(ParseErrorType::InvalidLineNumberError, "invalid line number after", maxLine);
-                return;
-            }
-
-            // Check if the current line number is greater than the max line number
-//            if (lineNumber <= maxLine) {
-//                throw ParseException(ParseErrorType::InvalidLineNumberError, "decreasing line number", lineNumber);
-//                return;
-//            }
-//            maxLine = lineNumber;
-
-            // Remove the line number and the following space character (if exists)
-            size_t spacePos = line.find(' ');
-            if (spacePos != std::string::npos) {
-                saveLine(lineNumber, line.substr(spacePos + 1));
-            }
-            else {
-                throw ParseException(ParseErrorType::InvalidExpressionError, "lack of expression", lineNumber);
-            }
-        }
-
-        file.close();
-
-        if (!hasEND) {
-            throw ParseException(ParseErrorType::MissingEndError, "missing END", -1);
-        }
+    // 映射文件，逐行直接从映射中取出语句，不先把整个文件读进字符串
+    std::unique_ptr<MappedFile> file;
+    try {
+        file.reset(new MappedFile(path));
+    }
+    catch (const std::runtime_error&) {
+        std::cerr << "Error opening file: " << path << std::endl;
+        return;
+    }
+    LoadContent(file->data(), file->size());
 }
 
 
 void Program::LoadContent(const std::string &content) {
-    std::istringstream file(content);
-    std::string line;
+    LoadContent(content.data(), content.size());
+}
+
+// 按 '\n' 分行（与 getline 相同），去掉行首的空格和制表符，跳过空行；
+// 行号的解析规则与 istream 读 int 相同，第一个空格之后的内容交给 saveLine
+void Program::LoadContent(const char *data, std::size_t size) {
+    QBASIC_ALLOC_PHASE(AllocPhase::Load);
+    // 载入过程中不逐行通知、不逐行维护反向转移索引，结束时（包括中途出错）重建索引并通知一次整体变化
+    struct ResetOnExit {
+        Program &program;
+        ~ResetOnExit() {
+            program.finishDeferredJumps();
+            program.notifyListingReset();
+        }
+    } resetOnExit = {*this};
+    this->jumpIndexDeferred = true;
+    this->deferredJumps.clear();
+    this->deferredLines.clear();
+    this->deferredJumpsComplete = this->statements.empty();
+    const char *end = data + size;
     int cur_line = -1; // Initialize with an invalid line number
 
-    while (getline(file, line)) {
+    for (const char *next = data; next < end; ) {
+        const char *eol = findByte(next, end, '\n');
+        const char *line = next;
+        next = eol < end ? eol + 1 : end;
+
         // Remove leading spaces
-        line.erase(0, line.find_first_not_of(" \t"));
+        while (line < eol && (*line == ' ' || *line == '\t')) ++line;
 
         // Skip empty lines
-        if (line.empty()) continue;
+        if (line == eol) continue;
 
         // Read line number at the beginning of the line
-        std::istringstream iss(line);
-        raw.push_back(line);
         int lineNumber;
-        if (!(iss >> lineNumber)) {
+        if (!parseInteger(line, eol - line, lineNumber)) {
             throw ParseException(ParseErrorType::InvalidLineNumberError, "invalid line number after", cur_line);
         }
 
         cur_line = lineNumber;
 
         // Remove the line number and the following space character (if exists)
-        size_t spacePos = line.find(' ');
-        if (spacePos != std::string::npos) {
-            saveLine(lineNumber, line.substr(spacePos + 1));
+        const char *space = findByte(line, eol, ' ');
+        if (space != eol) {
+            saveLine(lineNumber, std::string(space + 1, eol));
         }
         else {
             throw ParseException(ParseErrorType::InvalidExpressionError, "lack of expression", lineNumber);
@@ -130,6 +121,7 @@ void Program::LoadContent(const std::string &content) {
 
 
 std::string Program::display() const{
+    QBASIC_ALLOC_PHASE(AllocPhase::Render);
     std::string result;
     for (auto it = this->statements.begin(); it != statements.end(); ++it) {
         result += it->second->getRaw();
@@ -137,41 +129,170 @@ std::string Program::display() const{
     return result;
 }
 
-void Program::saveLine(int lineNumber, std::string cmd){
-    std::cout << "saveLine: " << cmd << std::endl;
-    std::istringstream iss(cmd);
-    std::string firstWord;
-    iss >> firstWord;
-    if (firstWord.length() == 0) return;
-    if (firstWord == "REM") {
-        statements[lineNumber] = new REMstatement(lineNumber, cmd);
-        return;
+std::vector<int> Program::lineNumbers() const{
+    std::vector<int> result;
+    result.reserve(this->statements.size());
+    for (auto it = this->statements.begin(); it != statements.end(); ++it) {
+        result.push_back(it->first);
     }
-    if (firstWord == "LET"){
-        statements[lineNumber] = new LETstatement(lineNumber, cmd);
-        return;
+    return result;
+}
+
+std::string Program::lineText(int lineNumber) const{
+    auto it = this->statements.find(lineNumber);
+    if (it == this->statements.end()) return std::string();
+    std::string text = it->second->getRaw();
+    text.pop_back(); // getRaw 以换行结尾
+    return text;
+}
+
+void Program::addListingObserver(ListingObserver *observer){
+    this->listingObservers.push_back(observer);
+}
+
+void Program::removeListingObserver(ListingObserver *observer){
+    this->listingObservers.erase(std::remove(this->listingObservers.begin(), this->listingObservers.end(), observer),
+                                 this->listingObservers.end());
+}
+
+void Program::notifyListingReset(){
+    for (ListingObserver *observer : this->listingObservers) observer->listingReset();
+}
+
+std::vector<int> Program::jumpSources(int lineNumber) const{
+    std::vector<int> sources;
+    auto range = this->jumpReferences.equal_range(lineNumber);
+    for (auto it = range.first; it != range.second; ++it) sources.push_back(it->second);
+    std::sort(sources.begin(), sources.end());
+    return sources;
+}
+
+const std::set<int>& Program::danglingJumps() const{
+    return this->dangling;
+}
+
+void Program::placeStatement(int lineNumber, Statement *stmt){
+    // 与原来的 statements[lineNumber] 一样只查找一次，载入时每行都经过这里
+    auto it = this->statements.lower_bound(lineNumber);
+    bool existed = it != this->statements.end() && it->first == lineNumber;
+    if (existed) {
+        if (this->jumpIndexDeferred) this->deferredJumpsComplete = false; // 记下的转移可能已被替换
+        else unlinkJumps(lineNumber, it->second);
+        delete it->second;
+        it->second = stmt;
     }
-    if (firstWord == "IF"){
-        statements[lineNumber] = new IFstatement(lineNumber, cmd);
-        return;
+    else {
+        this->statements.emplace_hint(it, lineNumber, stmt);
     }
-    if (firstWord == "PRINT"){
-        statements[lineNumber] = new PRINTstatement(lineNumber, cmd);
+    if (this->jumpIndexDeferred) {
+        // 语句刚构造完还在缓存里，这时读出目标，结束时只登记这些转移
+        int target;
+        if (stmt->jumpTarget(target)) this->deferredJumps.emplace_back(target, lineNumber);
+        this->deferredLines.push_back(lineNumber);
         return;
     }
-    if (firstWord == "INPUT"){
-        statements[lineNumber] = new INPUTstatement(lineNumber, cmd);
-        return;
+    if (!existed) {
+        // 以这一行为目标的转移不再悬空
+        auto range = this->jumpReferences.equal_range(lineNumber);
+        for (auto source = range.first; source != range.second; ++source) this->dangling.erase(source->second);
     }
-    if (firstWord == "GOTO"){
-        statements[lineNumber] = new GOTOstatement(lineNumber, cmd);
-        return;
+    linkJumps(lineNumber, stmt);
+}
+
+void Program::removeStatement(std::map<int, Statement*>::iterator it){
+    int lineNumber = it->first;
+    unlinkJumps(lineNumber, it->second);
+    delete it->second;
+    this->statements.erase(it);
+    // 以这一行为目标的转移变为悬空
+    auto range = this->jumpReferences.equal_range(lineNumber);
+    for (auto source = range.first; source != range.second; ++source) this->dangling.insert(source->second);
+}
+
+void Program::linkJumps(int lineNumber, const Statement *stmt){
+    int target;
+    if (!stmt->jumpTarget(target)) return;
+    this->jumpReferences.emplace(target, lineNumber);
+    if (this->statements.find(target) == this->statements.end()) this->dangling.insert(lineNumber);
+}
+
+void Program::unlinkJumps(int lineNumber, const Statement *stmt){
+    int target;
+    if (!stmt->jumpTarget(target)) return;
+    // 同一行只登记一次
+    auto range = this->jumpReferences.equal_range(target);
+    for (auto source = range.first; source != range.second; ++source) {
+        if (source->second == lineNumber) {
+            this->jumpReferences.erase(source);
+            break;
+        }
     }
-    if (firstWord == "END"){
-        statements[lineNumber] = new ENDstatement(lineNumber, cmd);
-        this->hasEND = true;
-        return;
+    this->dangling.erase(lineNumber);
+}
+
+void Program::rebuildJumpIndex(){
+    this->jumpReferences.clear();
+    this->dangling.clear();
+    for (auto it = this->statements.begin(); it != this->statements.end(); ++it) {
+        linkJumps(it->first, it->second);
+    }
+}
+
+// 载入结束：通常只需登记载入时记下的转移，不必再访问每条语句；
+// 载入前已有语句或有重复的行号时，记下的转移不完整，改为整体重建
+void Program::finishDeferredJumps(){
+    this->jumpIndexDeferred = false;
+    if (!this->deferredJumpsComplete) {
+        rebuildJumpIndex();
     }
+    else {
+        // 目标和载入的行号都排好序后一起向前走，不必在语句表的树中逐个查找
+        std::sort(this->deferredJumps.begin(), this->deferredJumps.end());
+        if (!std::is_sorted(this->deferredLines.begin(), this->deferredLines.end())) {
+            std::sort(this->deferredLines.begin(), this->deferredLines.end());
+        }
+        this->jumpReferences.clear();
+        this->dangling.clear();
+        this->jumpReferences.reserve(this->deferredJumps.size());
+        auto line = this->deferredLines.begin();
+        for (std::size_t i = 0; i < this->deferredJumps.size(); ) {
+            int target = this->deferredJumps[i].first;
+            while (line != this->deferredLines.end() && *line < target) ++line;
+            bool exists = line != this->deferredLines.end() && *line == target;
+            for (; i < this->deferredJumps.size() && this->deferredJumps[i].first == target; ++i) {
+                this->jumpReferences.emplace(target, this->deferredJumps[i].second);
+                if (!exists) this->dangling.insert(this->deferredJumps[i].second);
+            }
+        }
+    }
+    std::vector<std::pair<int, int>>().swap(this->deferredJumps);
+    std::vector<int>().swap(this->deferredLines);
+}
+
+void Program::saveLine(int lineNumber, std::string cmd){
+    std::cout << "saveLine: " << cmd << std::endl;
+    this->tier.invalidate(); // 任何编辑都回到解释层
+    this->runState = RunState::Idle; // 编辑后暂停中的运行不能继续
+    // 第一个单词：跳过前导空白，到下一个空白为止（与 istream 读 string 相同）
+    std::size_t wordStart = 0;
+    while (wordStart < cmd.size() && std::isspace(static_cast<unsigned char>(cmd[wordStart]))) ++wordStart;
+    std::size_t wordEnd = wordStart;
+    while (wordEnd < cmd.size() && !std::isspace(static_cast<unsigned char>(cmd[wordEnd]))) ++wordEnd;
+    if (wordEnd == wordStart) return;
+    std::string firstWord = cmd.substr(wordStart, wordEnd - wordStart);
+    Statement *stmt = newStatement(lineNumber, std::move(cmd), firstWord);
+    placeStatement(lineNumber, stmt);
+    if (stmt->type == statementType::END) this->hasEND = true;
+}
+
+Statement* Program::newStatement(int lineNumber, std::string cmd, const std::string &firstWord){
+    if (firstWord == "REM") return new REMstatement(lineNumber, std::move(cmd));
+    if (firstWord == "LET") return new LETstatement(lineNumber, std::move(cmd));
+    if (firstWord == "IF") return new IFstatement(lineNumber, std::move(cmd));
+    if (firstWord == "PRINT") return new PRINTstatement(lineNumber, std::move(cmd));
+    if (firstWord == "INPUT") return new INPUTstatement(lineNumber, std::move(cmd));
+    if (firstWord == "GOTO") return new GOTOstatement(lineNumber, std::move(cmd));
+    if (firstWord == "END") return new ENDstatement(lineNumber, std::move(cmd));
     throw ParseException(ParseErrorType::InvalidExpressionError, "unknown expression", lineNumber);
 }
 
@@ -181,21 +302,21 @@ void Program::execLine(std::string cmd){
     iss >> firstWord;
     if (firstWord == "LET"){
         this->output.clear();
-        LETstatement execStmt = LETstatement(-1, cmd);
+        LETstatement execStmt(-1, cmd);
         execStmt.parse(*this);
         execStmt.exec(*this);
         return;
     }
     if (firstWord == "PRINT"){
         this->output.clear();
-        PRINTstatement execStmt = PRINTstatement(-1, cmd);
+        PRINTstatement execStmt(-1, cmd);
         execStmt.parse(*this);
         execStmt.exec(*this);
         return;
     }
     if (firstWord == "INPUT"){
         this->output.clear();
-        INPUTstatement execStmt = INPUTstatement(-1, cmd);
+        INPUTstatement execStmt(-1, cmd);
         execStmt.parse(*this);
 
         emit this->requestInput();
@@ -212,23 +333,133 @@ void Program::execLine(std::string cmd){
 
 
 void Program::exec(){
-    bool iteratorUpdated = false;
+    // 一次跑完：INPUT 时发出 requestInput 并在事件循环中等待界面送来输入
+    for (;;) {
+        switch (step(INT_MAX)) {
+        case StepResult::NeedsInput:
+            emit this->requestInput();
+            waitUntilInputIsFinished(); // 等待用户输入
+            std::cout << "program input: " << input << std::endl;
+            provideInput(input);
+            break;
+        case StepResult::Finished:
+            return;
+        case StepResult::Error:
+            std::rethrow_exception(failure);
+        default:
+            break;
+        }
+    }
+}
+
+Program::StepResult Program::step(int budget){
+    if (runState == RunState::Idle) return StepResult::Finished;
+    if (runState == RunState::Done) return failure ? StepResult::Error : StepResult::Finished;
+    if (runState == RunState::WaitingForInput) {
+        // 交互式输入只能等 provideInput；其它来源（例如补充过的队列）回到 INPUT 行重新取值
+        if (!inputProvider) return StepResult::NeedsInput;
+        runState = RunState::Ready;
+    }
+    std::size_t sliceStart = output.size();
+    try {
+        StepResult result = runSlice(budget, sliceStart);
+        if (result == StepResult::Finished) finishRun();
+        return result;
+    }
+    catch (const ParseException &e) {
+        errorMessage = e.what();
+        failure = std::current_exception();
+    } catch (const std::invalid_argument&) {
+        // 如果输入的不是整数，将会捕获到invalid_argument异常
+        errorMessage = "Error: Invalid input, not an integer.";
+        failure = std::current_exception();
+    } catch (const std::exception &e) {
+        errorMessage = e.what();
+        failure = std::current_exception();
+    }
+    tier.flushEdges();
+    runState = RunState::Done;
+    if (recordingTrace) trace.finish(executedStatements, output, getRunCounters(), errorMessage);
+    return StepResult::Error;
+}
 
-    for (auto it = this->statements.begin(); it != statements.end(); /** We'll increment it manually */) {
+Program::StepResult Program::runSlice(int budget, std::size_t sliceStart){
+    bool iteratorUpdated = false;
+    auto &it = this->pc;
+
+    for (; it != statements.end(); /** We'll increment it manually */) {
+        // Safepoint: answer stop and snapshot requests from the GUI thread before this line runs.
+        if (control && control->hasRequest() && serviceControl()) {
+            currentLine = it->first;
+            stopped = true;
+            return StepResult::Finished;
+        }
+        if (budget-- <= 0) return output.size() > sliceStart ? StepResult::OutputReady : StepResult::BudgetExhausted;
+        // Record the line-to-line transition for the edge profile and profile-guided runs.
+        if (recordingEdges) {
+            if (previousLine != TierManager::noLine) edgeProfiler.record(previousLine, it->first);
+            else edgeProfiler.markLine(it->first);
+            previousLine = it->first;
+        }
+        // Switch to the optimized tier at a statement boundary if this line has been promoted.
+        if (tier.hasCompiledCode()) {
+            // 已经通过 provideInput 给出值的 INPUT 由解释器执行
+            OptimizedStatement* optimized = inputProvided ? nullptr : tier.lookup(it->first);
+            if (optimized) {
+                // 本行已在上面扣过一条，优化层按实际执行的语句数重新扣除
+                long long remaining = static_cast<long long>(budget) + 1;
+                int resumeLine;
+                {
+                    // 与解释执行相同，优化层中的分配记在 Exec 阶段，执行的语句计入每条语句的分配次数
+                    QBASIC_ALLOC_LINE(it->first);
+                    QBASIC_ALLOC_PHASE(AllocPhase::Exec);
+#ifdef QBASIC_ALLOC_PROFILE
+                    TierAllocationCount counting(tier);
+#endif
+                    resumeLine = tier.run(optimized, *this, remaining);
+                }
+                budget = remaining > 0 ? static_cast<int>(remaining) : 0;
+                previousLine = TierManager::noLine; // The tier records its own transitions, including the one leaving it.
+                if (resumeLine == TierManager::noLine) { // Fell off the end of the program.
+                    it = statements.end();
+                    break;
+                }
+                if (resumeLine == TierManager::needsInput) {
+                    // 与解释器中的 INPUT 一样暂停在这一行，取到值之后重新进入优化层
+                    it = statements.find(currentLine);
+                    if (output.size() > sliceStart) return StepResult::OutputReady;
+                    runState = RunState::WaitingForInput;
+                    return StepResult::NeedsInput;
+                }
+                it = statements.find(resumeLine);
+                continue;
+            }
+        }
         currentLine = it->first; // Get the line number of the current statement.
         int saveLine = currentLine; // Save the current line number to check for changes later.
         Statement* stmt = it->second; // Get the statement object.
 
         if (stmt) { // Ensure the pointer to the statement is not null.
+            // 从懒解析到升层观察的全部分配都记在正在执行的这一行上
+            QBASIC_ALLOC_STATEMENT(currentLine);
+            QBASIC_ALLOC_PHASE(AllocPhase::Exec);
             stmt->parse(*this); // Parse the statement.
-            if (stmt->type == statementType::INPUT) {
-//                std::lock_guard<std::mutex> lock(this->inputMutex); // Locks the mutex
-                emit this->requestInput();
-//                while (!isInputFinished){}
-                 waitUntilInputIsFinished(); // 等待用户输入
-                std::cout << "program input: " << input << std::endl;
+            if (stmt->type == statementType::INPUT && !inputProvided && inputProvider) {
+                InputProvider::Status status = inputProvider->next(inputValue);
+                if (status == InputProvider::Value) inputIsValue = inputProvided = true;
+                else InputProvider::fail(status, currentLine);
             }
+            if (stmt->type == statementType::INPUT && !inputProvided) {
+                // 暂停在本行：先交出本段产生的输出，再向调用方要输入；provideInput 之后从本行继续
+                if (recordingEdges) previousLine = TierManager::noLine;
+                if (output.size() > sliceStart) return StepResult::OutputReady;
+                runState = RunState::WaitingForInput;
+                return StepResult::NeedsInput;
+            }
+            inputProvided = false;
+            if (recordingTrace && stmt->type == statementType::INPUT) trace.addInput(inputIsValue ? std::to_string(inputValue) : input);
             stmt->exec(*this); // Execute the statement.
+            inputIsValue = false;
             std::cout << "After line " << currentLine << ":\n";
             // 遍历并输出变量名和使用次数
             for (const auto& pair : variables) {
@@ -236,10 +467,23 @@ void Program::exec(){
                           << ", Usage Count: " << pair.second.usageCount << std::endl;
             }
             if (stmt->type == statementType::END) break; // Stop if the statement type is END.
+            ++executedStatements;
+            if (limiter.active()) {
+                // 受限的运行不升层，每条语句都在这里计数和检查
+                if (stmt->type == statementType::PRINT) limiter.printed(output.size(), output.size(), variables.size(), saveLine);
+                else if (stmt->type == statementType::LET || stmt->type == statementType::INPUT) limiter.defined(variables.size(), output.size(), saveLine);
+                else if (currentLine < saveLine) limiter.backwardJump(executedStatements - 1, saveLine);
+            }
+            else if (tier.isEnabled() && !recordingTrace) tier.observe(stmt, *this); // Promote hot lines and loops.
             // If the statement is an IF or GOTO, check if the line number has changed.
             if (stmt->type == statementType::IF || stmt->type == statementType::GOTO) {
                 // If the current line number has changed, update the iterator to the new line.
                 if (currentLine != saveLine) {
+                    if (recordingTrace) {
+                        std::size_t from = std::lower_bound(traceLines.begin(), traceLines.end(), saveLine) - traceLines.begin();
+                        std::size_t to = std::lower_bound(traceLines.begin(), traceLines.end(), currentLine) - traceLines.begin();
+                        trace.addJump(executedStatements - 1, from, to);
+                    }
                     it = statements.find(currentLine);
                     iteratorUpdated = true; // Mark that the iterator has been updated.
                     std::cout << "skip to line " << currentLine << std::endl;
@@ -255,13 +499,94 @@ void Program::exec(){
             iteratorUpdated = false;
         }
     }
+    return StepResult::Finished;
+}
+
+void Program::provideInput(const std::string &value){
+    this->input = value;
+    this->inputIsValue = false;
+    this->inputProvided = true;
+    if (runState == RunState::WaitingForInput) runState = RunState::Ready;
+}
+
+// 运行正常结束或被停止之后的收尾
+void Program::finishRun(){
+    runState = RunState::Done;
+    tier.flushEdges();
+    // 与 ExecutionContext 一致，结束运行的 END 也算一条
+    if (recordingTrace) trace.finish(executedStatements + (pc != statements.end() ? 1 : 0), output, getRunCounters(), errorMessage);
+    if (!stopped) checkUnreachedLines();
+    // 中途停止的运行只覆盖了一部分路径，不保存剖析
+    if (recordingProfile && !stopped) {
+        profile.clear();
+        for (const EdgeProfiler::Edge &edge : edgeProfiler.edges()) profile.add(edge.from, edge.to, edge.count);
+        profile.save(profileDirectory, contentHashHex(display()));
+    }
+    recordingProfile = false;
+}
+
+// 只解析运行次数为 0 的行，执行过的行已经在执行时解析过
+void Program::checkUnreachedLines(){
+    for (auto it = this->statements.begin(); it != statements.end(); ++it) {
+        if (it->second->getRunTime() != 0) continue;
+        try {
+            it->second->parse(*this);
+        }
+        catch (const ParseException &e) {
+            unreachedErrors.push_back(std::make_pair(it->first, std::string(e.what())));
+        }
+        catch (const std::exception &) {
+            // 与 ValidationWorker 相同：数字不合法时 std::stoi 抛出的异常按解析错误报告
+            ParseException error(ParseErrorType::InvalidExpressionError, "invalid number", it->first);
+            unreachedErrors.push_back(std::make_pair(it->first, std::string(error.what())));
+        }
+    }
+}
+
+// 执行线程的安全点：快照请求把新增输出和运行统计发给界面线程，返回是否应当停止
+bool Program::serviceControl(){
+    if (control->takeSnapshotRequest()) publishProgress();
+    return control->stopRequested();
+}
+
+// 运行统计只发运行次数变了的行（次数在运行中只增不减，IF 的两个计数之和变了即有变化），
+// 每行“下标 次数”；运行次数没有变化时不发
+void Program::publishProgress(){
+    if (output.size() > outputTaken) control->publish(RunEvent::Output, currentLine, takeOutput());
+    std::string changes;
+    std::size_t row = 0;
+    for (auto it = this->statements.begin(); it != statements.end(); ++it, ++row) {
+        int runTime = it->second->getRunTime();
+        if (runTime == publishedRunTimes[row]) continue;
+        publishedRunTimes[row] = runTime;
+        changes += std::to_string(row);
+        changes += ' ';
+        changes += it->second->runCounts();
+        changes += '\n';
+    }
+    if (!changes.empty()) control->publish(RunEvent::Counters, currentLine, changes);
 }
 
 std::string Program::getOutput() const{
     return this->output;
 }
 
+std::string Program::takeOutput(){
+    std::string fresh = this->output.substr(this->outputTaken);
+    this->outputTaken = this->output.size();
+    return fresh;
+}
+
+std::string Program::getError() const{
+    return this->errorMessage;
+}
+
+const std::vector<std::pair<int, std::string>>& Program::getUnreachedErrors() const{
+    return this->unreachedErrors;
+}
+
 std::string Program::getSyntaxTree() {
+    QBASIC_ALLOC_PHASE(AllocPhase::Render);
     std::string syntaxTree;
     for (auto it = this->statements.begin(); it != statements.end(); ++it) {
         Statement* stmt = it->second;
@@ -272,6 +597,7 @@ std::string Program::getSyntaxTree() {
 }
 
 std::string Program::getSyntaxTreeWithRunStatistics(){
+    QBASIC_ALLOC_PHASE(AllocPhase::Render);
     std::string syntaxTree;
     for (auto it = this->statements.begin(); it != statements.end(); ++it) {
         Statement* stmt = it->second;
@@ -286,11 +612,135 @@ std::string Program::getSyntaxTreeWithRunStatistics(){
     return syntaxTree;
 }
 
+std::string Program::getRunCounters() const{
+    std::string counters;
+    for (auto it = this->statements.begin(); it != statements.end(); ++it) {
+        counters += it->second->runStatisticsLine();
+    }
+    return counters;
+}
+
+std::string Program::lineSyntaxTree(int lineNumber){
+    QBASIC_ALLOC_PHASE(AllocPhase::Render);
+    auto it = this->statements.find(lineNumber);
+    if (it == this->statements.end()) return std::string();
+    it->second->parse(*this);
+    return it->second->syntaxTreeWithRunStatistics();
+}
+
+std::string Program::lineRunCounts(int lineNumber) const{
+    auto it = this->statements.find(lineNumber);
+    if (it == this->statements.end()) return std::string();
+    return it->second->runCounts();
+}
+
+bool Program::lineHasSubtree(int lineNumber) const{
+    auto it = this->statements.find(lineNumber);
+    return it != this->statements.end() && it->second->type != statementType::END;
+}
+
 void Program::setInput(std::string input){
     this->input = input;
 }
 
+void Program::setTierThreshold(int threshold){
+    this->tier.setThreshold(threshold);
+}
+
+void Program::setJitThreshold(int threshold){
+    this->tier.setJitThreshold(threshold);
+}
+
+void Program::setProfileGuided(bool enabled, const std::string &directory){
+    this->profileGuided = enabled;
+    this->profileDirectory = directory.empty() ? PgoProfile::defaultDirectory() : directory;
+}
+
+void Program::setEdgeProfiling(bool enabled){
+    this->edgeProfiling = enabled;
+}
+
+void Program::setTraceRecording(bool enabled){
+    this->recordingTrace = enabled;
+}
+
+const RunTrace& Program::getTrace() const{
+    return this->trace;
+}
+
+long long Program::getExecutedStatements() const{
+    return this->executedStatements;
+}
+
+std::string Program::getEdgeProfileReport(bool json){
+    tier.flushEdges();
+    std::string key = contentHashHex(display());
+    return json ? edgeProfiler.reportJson(key) : edgeProfiler.report(key);
+}
+
+void Program::setRunControl(RunControl *control){
+    this->control = control;
+}
+
+bool Program::hasLine(int lineNumber) const{
+    const std::map<int, Statement*> &lines = this->lineTable ? *this->lineTable : this->statements;
+    return lines.find(lineNumber) != lines.end();
+}
+
+void Program::setLimits(const RunLimits &limits){
+    this->limits = limits;
+}
+
+void Program::setInputProvider(InputProvider *provider){
+    this->inputProvider = provider;
+}
+
+bool Program::isStopped() const{
+    return this->stopped;
+}
+
+int Program::getCurrentLine() const{
+    return this->currentLine;
+}
+
 void Program::preRun(){
+    this->tier.invalidate();
+    this->tier.setInterrupt(this->control ? this->control->attentionFlag() : nullptr);
+    // 交互式输入要暂停运行，只有能直接给出值的来源才让 INPUT 升层
+    InteractiveInput *interactive = dynamic_cast<InteractiveInput*>(this->inputProvider);
+    this->tier.setInputProvider(interactive ? nullptr : this->inputProvider);
+    this->inputIsValue = false;
+    this->outputTaken = 0;
+    this->publishedRunTimes.assign(this->statements.size(), -1);
+    this->stopped = false;
+    this->runState = RunState::Ready;
+    this->pc = this->statements.begin();
+    this->previousLine = TierManager::noLine;
+    this->inputProvided = false;
+    this->failure = nullptr;
+    this->errorMessage.clear();
+    this->unreachedErrors.clear();
+    this->executedStatements = 0;
+    this->limiter.start(this->limits);
+    this->recordingProfile = false;
+    this->tier.setProfile(nullptr);
+    if (this->profileGuided) {
+        // 有剖析文件就按它执行，否则本次运行负责记录
+        if (this->profile.load(this->profileDirectory, contentHashHex(display()))) this->tier.setProfile(&this->profile);
+        else this->recordingProfile = true;
+    }
+    this->recordingEdges = this->edgeProfiling || this->recordingProfile;
+    this->tier.setRecorder(this->recordingEdges ? &this->edgeProfiler : nullptr);
+    if (this->recordingTrace) {
+        this->trace.start(display());
+        this->traceLines.clear();
+        for (auto it = this->statements.begin(); it != statements.end(); ++it) this->traceLines.push_back(it->first);
+    }
+    if (this->recordingEdges) {
+        std::vector<int> lines;
+        for (auto it = this->statements.begin(); it != statements.end(); ++it) lines.push_back(it->first);
+        this->edgeProfiler.reset(lines);
+    }
     variables.clear();
     this->input.clear();
     this->output.clear();
@@ -303,18 +753,32 @@ void Program::preRun(){
 
 void Program::updateStatement(int lineNumber, std::string statement){
     auto it = this->statements.find(lineNumber);
-    if (it != this->statements.end()){
-        delete it->second;
-        statements.erase(it);
-    }
+    bool existed = it != this->statements.end();
+    if (existed) removeStatement(it);
+    // saveLine 可能不保存（空语句）或抛出异常（未知语句），这两种情况下原来的行已经删除
+    struct NotifyOnExit {
+        Program &program;
+        int lineNumber;
+        bool existed;
+        ~NotifyOnExit() {
+            bool exists = program.statements.count(lineNumber) != 0;
+            for (ListingObserver *observer : program.listingObservers) {
+                if (exists && existed) observer->lineReplaced(lineNumber);
+                else if (exists) observer->lineInserted(lineNumber);
+                else if (existed) observer->lineRemoved(lineNumber);
+            }
+        }
+    } notifyOnExit = {*this, lineNumber, existed};
     saveLine(lineNumber, trimBothEnds(statement));
 }
 
 void Program::deleteStatement(int lineNumber){
+    this->tier.invalidate();
+    this->runState = RunState::Idle;
     auto it = this->statements.find(lineNumber);
     if (it != this->statements.end()){
-        delete it->second;
-        statements.erase(it);
+        removeStatement(it);
+        for (ListingObserver *observer : this->listingObservers) observer->lineRemoved(lineNumber);
     }
     else {
         throw ParseException(ParseErrorType::UndefinedLineError, "delete invalid line", lineNumber);
@@ -13,7 +13,18 @@
 #include <algorithm>
 #include "Typedef.h"
 #include "ExpressionEvaluator.h"
+#include "TierManager.h"
+#include "PgoProfile.h"
+#include "EdgeProfiler.h"
+#include "RunTrace.h"
+#include "RunControl.h"
+#include "InputProvider.h"
+#include "RunLimits.h"
+#include "ListingObserver.h"
 #include <map>
+#include <set>
+#include <unordered_map>
+#include <exception>
 #include <QObject>
 #include <QEventLoop>
 
@@ -24,11 +35,28 @@ bool hasContentAfterFirstNumber(const std::string& str);
 
 class Program:public QObject{
     Q_OBJECT
+public:
+    // step 的返回值
+    enum class StepResult {
+        NeedsInput,       // 停在 INPUT 上，provideInput 之后继续
+        OutputReady,      // 本次 step 产生了新的输出，可用 takeOutput 取走
+        BudgetExhausted,  // 用完了语句预算，没有新的输出
+        Finished,         // 执行到 END、程序末尾或被停止
+        Error             // 运行出错，getError 为错误信息
+    };
 private:
+    enum class RunState {
+        Idle,             // 还没有 preRun，或 preRun 之后程序被编辑过
+        Ready,
+        WaitingForInput,
+        Done
+    };
     QEventLoop *inputEventLoop;
-    std::vector<std::string> raw;
     std::map<std::string, VariableInfo> variables;
     std::map<int, Statement*> statements;
+    // IF / GOTO 解析时检查目标行用的行表，为空时用 statements；并行构建映像时
+    // 各线程的临时 Program 指向原程序的 statements，只读共享
+    const std::map<int, Statement*> *lineTable;
     std::string input;
     std::string output;
 //    std::string syntaxTree;
@@ -36,6 +64,45 @@ private:
     int currentLine;
 //    int maxLine;
     bool hasEND;
+    TierManager tier;
+    PgoProfile profile;
+    bool profileGuided;
+    bool recordingProfile;    // 本次运行记录转移，结束时保存为剖析文件
+    std::string profileDirectory;
+    EdgeProfiler edgeProfiler;
+    bool edgeProfiling;
+    bool recordingEdges;
+    RunTrace trace;
+    bool recordingTrace;
+    std::vector<int> traceLines;  // 录制时按顺序排列的行号，转移记为它们的下标
+    RunControl *control;          // 在执行线程上运行时与界面线程的通道，为空表示直接运行
+    std::size_t outputTaken;      // 已经由 takeOutput 取走的输出长度
+    std::vector<int> publishedRunTimes;  // 按语句顺序，上次发给界面线程的运行次数，-1 表示还没有发过
+    bool stopped;
+    // 可恢复的执行状态：下一条要执行的语句、上一条执行的行（转移剖析用）和等待中的输入
+    RunState runState;
+    std::map<int, Statement*>::iterator pc;
+    int previousLine;
+    bool inputProvided;
+    InputProvider *inputProvider;  // 为空表示交互式输入
+    bool inputIsValue;             // 本次 INPUT 的值已由 inputProvider 解析好，存放在 inputValue
+    int inputValue;
+    LimitChecker limiter;
+    RunLimits limits;              // 下次 preRun 时生效
+    long long executedStatements;  // 本次运行解释执行的语句数，用于语句数限制
+    std::exception_ptr failure;
+    std::string errorMessage;
+    std::vector<std::pair<int, std::string>> unreachedErrors;  // 本次运行没有执行到、解析出错的行
+    std::vector<ListingObserver*> listingObservers;  // 关心清单变化的视图等，不拥有
+    // 反向转移索引：目标行号 -> 转移到该行的 IF / GOTO 所在的行，目标行不存在时也保留；
+    // dangling 为目标行不存在的转移所在的行。增删一行时只需查看以它为目标的转移
+    std::unordered_multimap<int, int> jumpReferences;
+    std::set<int> dangling;
+    // LoadContent 期间不逐行维护，只记下各转移的 (目标, 行号) 和载入的行号，载入结束时一次建立
+    bool jumpIndexDeferred;
+    bool deferredJumpsComplete;
+    std::vector<std::pair<int, int>> deferredJumps;
+    std::vector<int> deferredLines;
     friend class Statement;
     friend class Arithstatement;
     friend class REMstatement;
@@ -47,9 +114,28 @@ private:
     friend class ENDstatement;
     friend class ExpressionEvaluator;
     friend struct VariableNode;
+    friend class TierManager;
+    friend class AotCompiler;
+    friend class ProgramImage;
+    friend class ExecutionWorker;
+    friend class ValidationWorker;
 
+    bool hasLine(int lineNumber) const;
     void updateStatement(int lineNumber, std::string statement);
     void deleteStatement(int lineNumber);
+    void notifyListingReset();
+    // 语句表的增删都经过这两个函数，同时维护反向转移索引
+    void placeStatement(int lineNumber, Statement *stmt);
+    void removeStatement(std::map<int, Statement*>::iterator it);
+    void linkJumps(int lineNumber, const Statement *stmt);
+    void unlinkJumps(int lineNumber, const Statement *stmt);
+    void rebuildJumpIndex();
+    void finishDeferredJumps();
+    StepResult runSlice(int budget, std::size_t sliceStart);
+    void finishRun();
+    void checkUnreachedLines();
+    bool serviceControl();
+    void publishProgress();
     void waitUntilInputIsFinished() {
         inputEventLoop->exec();
     }
@@ -69,23 +155,99 @@ public:
         this->currentLine = -1;
         this->hasEND = false;
         this->isRunning = false;
+        this->profileGuided = false;
+        this->recordingProfile = false;
+        this->edgeProfiling = false;
+        this->recordingEdges = false;
+        this->recordingTrace = false;
+        this->control = nullptr;
+        this->outputTaken = 0;
+        this->stopped = false;
+        this->runState = RunState::Idle;
+        this->previousLine = -1;
+        this->inputProvided = false;
+        this->inputProvider = nullptr;
+        this->inputIsValue = false;
+        this->inputValue = 0;
+        this->executedStatements = 0;
+        this->lineTable = nullptr;
+        this->jumpIndexDeferred = false;
+        this->deferredJumpsComplete = false;
         inputEventLoop = new QEventLoop(this);
     }
 
     void Load(std::string path);
     void LoadContent(const std::string &content);
+    // 同上，直接读 [data, data + size)，例如映射的文件；逐行取出语句，不复制整个文本
+    void LoadContent(const char *data, std::size_t size);
     std::string display() const;
+    // 按行号顺序的全部行号，以及一行的清单文本（行号加语句，不含换行），该行不存在时为空
+    std::vector<int> lineNumbers() const;
+    std::string lineText(int lineNumber) const;
+    // 编辑、LOAD 和 CLEAR 时按加入的顺序通知各 observer，不转移所有权
+    void addListingObserver(ListingObserver *observer);
+    void removeListingObserver(ListingObserver *observer);
+    // 转移到 lineNumber 的 IF / GOTO 所在的行（升序），以及目标行不存在的转移所在的行；
+    // 编辑时随之更新，开销与被编辑行的入度成正比，不需要解析
+    std::vector<int> jumpSources(int lineNumber) const;
+    const std::set<int>& danglingJumps() const;
     void saveLine(int lineNumber, std::string cmd);
+    // 按第一个单词新建一条未解析的语句，不认识的语句抛出异常；映像构建用它复制语句，不解析程序中的语句
+    static Statement* newStatement(int lineNumber, std::string cmd, const std::string &firstWord);
+    // 一次执行完整个程序，INPUT 通过 requestInput 信号和事件循环等待界面输入；出错时抛出异常
     void exec();
+    // 从 preRun 之后的位置继续执行最多 budget 条语句（含优化层执行的语句，折叠的循环整个计入，可能略微超出）后返回，
+    // 不需要 Qt 事件循环，一个线程可以轮流推进多个暂停中的程序
+    StepResult step(int budget);
+    void provideInput(const std::string &value);
+    // INPUT 的来源，不转移所有权；为空或交互式来源时 INPUT 暂停并返回 NeedsInput。
+    // 非交互式来源的 INPUT 不离开执行循环，也可以升到优化层
+    void setInputProvider(InputProvider *provider);
     void execLine(std::string cmd);
 //    void cmd(std::string cmd);
     void reset();
     void preRun();
     void edit(std::string cmd);
     std::string getOutput() const;
+    // 自上次调用以来新增的输出
+    std::string takeOutput();
+    std::string getError() const;
+    // 正常结束的运行之后：没有执行到的行中解析出错的行号和错误信息，按行号排列。
+    // 语句在执行时才解析，这些错误不会中断运行，由运行结束时单独检查一遍
+    const std::vector<std::pair<int, std::string>>& getUnreachedErrors() const;
     std::string getSyntaxTree() ;
     std::string getSyntaxTreeWithRunStatistics();
+    // 每行一条的运行统计，不重新解析语句，运行中途也可以调用
+    std::string getRunCounters() const;
+    // 单独一行的语法树（格式同 getSyntaxTreeWithRunStatistics，会重新解析这一行，出错时抛出异常）
+    // 和运行次数，供只渲染可见行的语法树视图使用；该行不存在时为空
+    std::string lineSyntaxTree(int lineNumber);
+    std::string lineRunCounts(int lineNumber) const;
+    // 该行的语法树除了标题行之外还有内容（END 没有）
+    bool lineHasSubtree(int lineNumber) const;
     void setInput(std::string input);
+    void setTierThreshold(int threshold);
+    void setJitThreshold(int threshold);
+    // 剖析引导模式：同一程序没有剖析文件时本次运行记录并保存，有则读入，剖析中的热行第一次执行后就升层，
+    // 并沿最热路径组成超级块；
+    // directory 为空时使用 PgoProfile::defaultDirectory()
+    void setProfileGuided(bool enabled, const std::string &directory = "");
+    // 转移剖析与行覆盖：每次 RUN 记录，报告为文本或 JSON
+    void setEdgeProfiling(bool enabled);
+    std::string getEdgeProfileReport(bool json = false);
+    // 录制每次 RUN 的输入、转移和结果，供 qbasic-replay 回放；录制的运行不升层，每次转移都经过解释器。
+    // getTrace 在运行结束之后有效
+    void setTraceRecording(bool enabled);
+    const RunTrace& getTrace() const;
+    // 本次运行已执行的语句数（结束运行的 END 不算）
+    long long getExecutedStatements() const;
+    // 设置后 exec 在安全点响应停止和快照请求，INPUT 从 control 读取而不进入事件循环
+    void setRunControl(RunControl *control);
+    // 之后每次运行的资源限制，超出时以 ResourceLimitError 结束；设置了任何一项时
+    // 整个运行都留在解释器中，优化层的循环不会绕过检查
+    void setLimits(const RunLimits &limits);
+    bool isStopped() const;
+    int getCurrentLine() const;
 signals:
     void requestInput();
 };
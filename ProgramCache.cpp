@@ -0,0 +1,60 @@
+#include "ProgramCache.h"
+#include "Program.h"
+
+ProgramCache::ProgramCache(std::size_t capacity, ImageCache *images)
+    : capacity(capacity ? capacity : 1), images(images), hitCount(0), missCount(0) {}
+
+std::shared_ptr<const ProgramImage> ProgramCache::get(const std::string &text, bool *hit) {
+    std::uint64_t key = contentHash(text);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key);
+        if (it != entries.end() && it->second.text == text) {
+            recent.splice(recent.begin(), recent, it->second.position);
+            ++hitCount;
+            if (hit) *hit = true;
+            return it->second.image;
+        }
+        ++missCount;
+    }
+    if (hit) *hit = false;
+
+    // 解析在锁外进行，不挡住其它线程的查询
+    std::shared_ptr<const ProgramImage> image;
+    if (images) image = images->get(text);
+    else {
+        Program program;
+        program.LoadContent(text);
+        image = ProgramImage::build(program);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        recent.erase(it->second.position);
+        entries.erase(it);
+    }
+    recent.push_front(key);
+    Entry entry = {text, image, recent.begin()};
+    entries[key] = entry;
+    while (entries.size() > capacity) {
+        entries.erase(recent.back());
+        recent.pop_back();
+    }
+    return image;
+}
+
+std::size_t ProgramCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+long long ProgramCache::hits() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hitCount;
+}
+
+long long ProgramCache::misses() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return missCount;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "ImageCache.h"
+#include "ProgramImage.h"
+
+// ProgramCache 按程序文本的内容哈希缓存解析好的 ProgramImage，最近最少使用的先淘汰。
+// 多个线程可以同时查询；同一文本同时未命中时可能各自解析一次，结果相同。
+// 给了 ImageCache 时未命中先查磁盘上的映像，由它负责解析和写入。
+class ProgramCache {
+public:
+    // images 不转移所有权，为空时不使用磁盘缓存
+    explicit ProgramCache(std::size_t capacity, ImageCache *images = nullptr);
+
+    // 返回 text 对应的映像，没有时用 LoadContent 加载、解析并放入缓存。
+    // 加载失败时抛出 ParseException，失败的程序不缓存。hit 为是否命中缓存
+    std::shared_ptr<const ProgramImage> get(const std::string &text, bool *hit = nullptr);
+
+    std::size_t size() const;
+    long long hits() const;
+    long long misses() const;
+
+private:
+    struct Entry {
+        std::string text;   // 哈希相同但文本不同时不算命中
+        std::shared_ptr<const ProgramImage> image;
+        std::list<std::uint64_t>::iterator position;
+    };
+
+    std::size_t capacity;
+    ImageCache *images;
+    mutable std::mutex mutex;
+    std::unordered_map<std::uint64_t, Entry> entries;
+    std::list<std::uint64_t> recent;   // 头部是最近使用的
+    long long hitCount;
+    long long missCount;
+};
+
+#endif // PROGRAMCACHE_H
@@ -0,0 +1,404 @@
+#include "ProgramImage.h"
+#include "AllocationProfiler.h"
+#include "MappedFile.h"
+#include "Program.h"
+#include "Statement.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+// 映像文件中的整数一律按小端序定长写入，与主机字节序无关
+const char imageMagic[4] = {'Q', 'B', 'I', 'M'};
+const std::uint32_t imageVersion = 2;
+// 并行构建时每块的行数：太小时领取块的开销显著，太大时最后几块拖尾
+const std::size_t chunkLines = 2048;
+
+void putInteger(std::string &out, std::uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) out += static_cast<char>((value >> (8 * i)) & 0xff);
+}
+
+void putString(std::string &out, const std::string &text) {
+    putInteger(out, text.size(), 4);
+    out += text;
+}
+
+void putExpression(std::string &out, const std::vector<ExprInstr> &code, int line) {
+    putInteger(out, static_cast<std::uint32_t>(line), 4);
+    putInteger(out, code.size(), 4);
+    for (const ExprInstr &instr : code) {
+        putInteger(out, static_cast<unsigned char>(instr.op), 1);
+        putInteger(out, static_cast<std::uint32_t>(instr.operand), 4);
+    }
+}
+
+class ImageReader {
+public:
+    ImageReader(const char *data, std::size_t size) : data(data), size(size), offset(0) {}
+
+    std::uint64_t integer(int bytes) {
+        need(bytes);
+        std::uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i) value |= static_cast<std::uint64_t>(static_cast<unsigned char>(data[offset + i])) << (8 * i);
+        offset += bytes;
+        return value;
+    }
+    int int32() { return static_cast<int>(static_cast<std::uint32_t>(integer(4))); }
+    // 元素个数：每个元素至少占 minBytes 字节，超出剩余长度的个数在预留空间之前就拒绝
+    std::size_t count(std::uint64_t minBytes) {
+        std::uint64_t value = integer(4);
+        need(value * minBytes);
+        return static_cast<std::size_t>(value);
+    }
+    std::string text() {
+        std::uint64_t length = integer(4);
+        need(length);
+        std::string value(data + offset, length);
+        offset += length;
+        return value;
+    }
+    // 与 expected 逐字节比较长度（8 字节）和内容，直接在映射中比较，不复制
+    bool matches(const std::string &expected) {
+        std::uint64_t length = integer(8);
+        if (length != expected.size()) return false;
+        need(length);
+        bool same = std::memcmp(data + offset, expected.data(), expected.size()) == 0;
+        offset += length;
+        return same;
+    }
+    bool atEnd() const { return offset == size; }
+
+private:
+    const char *data;
+    std::size_t size;
+    std::size_t offset;
+
+    void need(std::uint64_t bytes) const {
+        if (bytes > size - offset) throw std::runtime_error("image is truncated");
+    }
+};
+
+// 读回一个表达式并重新计算栈深度；指令不合法（未知操作、槽位越界、栈不平衡）时抛出
+void readExpression(ImageReader &in, std::vector<ExprInstr> &code, int &line, int &stackDepth, std::size_t slotCount) {
+    line = in.int32();
+    std::size_t count = in.count(5);
+    code.clear();
+    code.reserve(count);
+    int depth = 0;
+    stackDepth = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        ExprInstr instr;
+        std::uint64_t op = in.integer(1);
+        instr.operand = in.int32();
+        if (op > static_cast<std::uint64_t>(ExprOp::Pow)) throw std::runtime_error("image is corrupt");
+        instr.op = static_cast<ExprOp>(op);
+        if (instr.op == ExprOp::Const || instr.op == ExprOp::Load) {
+            if (instr.op == ExprOp::Load && (instr.operand < 0 || static_cast<std::size_t>(instr.operand) >= slotCount)) {
+                throw std::runtime_error("image is corrupt");
+            }
+            if (++depth > stackDepth) stackDepth = depth;
+        }
+        else if (--depth < 1) throw std::runtime_error("image is corrupt");
+        code.push_back(instr);
+    }
+    if (count && depth != 1) throw std::runtime_error("image is corrupt");
+}
+
+}
+
+ProgramImage::ProgramImage() {}
+
+std::shared_ptr<const ProgramImage> ProgramImage::build(const Program &program, int threads) {
+    std::shared_ptr<ProgramImage> image(new ProgramImage());
+    image->hash = contentHashHex(program.display());
+
+    std::vector<std::pair<int, const Statement*>> statements(program.statements.begin(), program.statements.end());
+    image->lines.resize(statements.size());
+    std::size_t chunkCount = (statements.size() + chunkLines - 1) / chunkLines;
+    if (threads <= 0) threads = static_cast<int>(std::thread::hardware_concurrency());
+    if (static_cast<std::size_t>(threads) > chunkCount) threads = static_cast<int>(chunkCount);
+
+    // 语句按文本复制后在临时 Program 中解析（目标行在原程序的 statements 中只读地检查），
+    // 原程序的语句、变量表都不改动
+    if (threads <= 1) {
+        Program parser;
+        parser.lineTable = &program.statements;
+        parseLines(parser, statements, 0, statements.size(), image->lines, image->names);
+        return image;
+    }
+
+    // 各线程轮流领取一块连续的行，用自己的临时 Program 解析，变量编成块内的局部槽位
+    std::vector<std::vector<std::string>> chunkNames(chunkCount);
+    std::atomic<std::size_t> nextChunk(0);
+    auto work = [&]() {
+        Program parser;
+        parser.lineTable = &program.statements;
+        for (std::size_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++) {
+            std::size_t begin = chunk * chunkLines;
+            std::size_t end = std::min(begin + chunkLines, statements.size());
+            parseLines(parser, statements, begin, end, image->lines, chunkNames[chunk]);
+            parser.variables.clear();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i) workers.emplace_back(work);
+    work();
+    for (std::thread &worker : workers) worker.join();
+
+    // 合并：按块的顺序把局部槽位换成全局槽位。块内按首次出现编号，所以全局编号
+    // 与逐行顺序构建时完全相同
+    std::map<std::string, int> slotOf;
+    for (std::size_t chunk = 0; chunk < chunkCount; ++chunk) {
+        const std::vector<std::string> &names = chunkNames[chunk];
+        std::vector<int> slot(names.size());
+        for (std::size_t i = 0; i < names.size(); ++i) {
+            auto it = slotOf.find(names[i]);
+            if (it == slotOf.end()) {
+                it = slotOf.insert(std::make_pair(names[i], static_cast<int>(image->names.size()))).first;
+                image->names.push_back(names[i]);
+            }
+            slot[i] = it->second;
+        }
+        std::size_t end = std::min((chunk + 1) * chunkLines, statements.size());
+        for (std::size_t index = chunk * chunkLines; index < end; ++index) {
+            Line &line = image->lines[index];
+            if (line.target >= 0) line.target = slot[line.target];
+            for (ExprInstr &instr : line.lhs.code) {
+                if (instr.op == ExprOp::Load) instr.operand = slot[instr.operand];
+            }
+            for (ExprInstr &instr : line.rhs.code) {
+                if (instr.op == ExprOp::Load) instr.operand = slot[instr.operand];
+            }
+        }
+    }
+    return image;
+}
+
+void ProgramImage::parseLines(Program &parser, const std::vector<std::pair<int, const Statement*>> &statements,
+                              std::size_t begin, std::size_t end, std::vector<Line> &lines, std::vector<std::string> &names) {
+    QBASIC_ALLOC_PHASE(AllocPhase::Parse);
+    std::map<std::string, int> slotOf;
+    for (std::size_t i = 0; i < names.size(); ++i) slotOf[names[i]] = static_cast<int>(i);
+    CompiledExpression::SlotResolver resolve = [&slotOf, &names](const std::string &name) {
+        auto it = slotOf.find(name);
+        if (it != slotOf.end()) return it->second;
+        int slot = static_cast<int>(names.size());
+        slotOf[name] = slot;
+        names.push_back(name);
+        return slot;
+    };
+    auto indexOf = [&statements](int lineNumber) {
+        auto it = std::lower_bound(statements.begin(), statements.end(), lineNumber,
+                                   [](const std::pair<int, const Statement*> &entry, int number) { return entry.first < number; });
+        return static_cast<std::size_t>(it - statements.begin());
+    };
+    auto link = [&indexOf](int toLine, std::size_t from, int fromLine) {
+        // 与解释器一致：跳转到本行等同于顺序执行
+        return toLine == fromLine ? from + 1 : indexOf(toLine);
+    };
+
+    for (std::size_t index = begin; index < end; ++index) {
+        int lineNumber = statements[index].first;
+        const Statement *source = statements[index].second;
+        Line &line = lines[index];
+        line.type = source->type;
+        line.lineNumber = lineNumber;
+        line.target = -1;
+        line.ifOperator = 0;
+        line.jump = index + 1;
+        line.text = source->statement;
+        std::string number = std::to_string(lineNumber);
+        try {
+            // 解析本线程的副本，语法树中的变量指向 parser，用完即释放
+            std::unique_ptr<Statement> copy(Program::newStatement(lineNumber, line.text, line.text.substr(0, line.text.find_first_of(" \t\r\n\f\v"))));
+            Statement *stmt = copy.get();
+            stmt->parse(parser);
+            switch (stmt->type) {
+            case statementType::REM: {
+                REMstatement *rem = static_cast<REMstatement*>(stmt);
+                line.treeHead = number + " REM";
+                if (rem->remark.length() > 0) line.treeBody = retract + rem->remark + "\n";
+                break;
+            }
+            case statementType::LET: {
+                LETstatement *let = static_cast<LETstatement*>(stmt);
+                line.target = resolve(let->LHS);
+                line.treeHead = number + " LET =";
+                line.treeBody = let->RHS.syntaxTreeWithOffset(1);
+                if (!line.rhs.compile(let->RHS.getExpressionEvaluator()->getRoot(), resolve, lineNumber)) {
+                    throw ParseException(ParseErrorType::InvalidExpressionError, "invalid expression", lineNumber);
+                }
+                break;
+            }
+            case statementType::PRINT: {
+                PRINTstatement *print = static_cast<PRINTstatement*>(stmt);
+                line.treeHead = number + " PRINT";
+                line.treeBody = print->print.syntaxTreeWithOffset(1);
+                if (!line.rhs.compile(print->print.getExpressionEvaluator()->getRoot(), resolve, lineNumber)) {
+                    throw ParseException(ParseErrorType::InvalidExpressionError, "invalid expression", lineNumber);
+                }
+                break;
+            }
+            case statementType::INPUT: {
+                INPUTstatement *input = static_cast<INPUTstatement*>(stmt);
+                line.target = resolve(input->input);
+                line.treeHead = number + " INPUT";
+                line.treeBody = retract + input->input + "\n";
+                break;
+            }
+            case statementType::IF: {
+                IFstatement *ifStmt = static_cast<IFstatement*>(stmt);
+                line.ifOperator = ifStmt->ifOperator;
+                line.jump = link(ifStmt->toLine, index, lineNumber);
+                line.treeHead = number + " IF THEN";
+                line.treeBody = ifStmt->printLevelOrder(ifStmt->LHS.mergeTrees(ifStmt->RHS));
+                if (!line.lhs.compile(ifStmt->LHS.getExpressionEvaluator()->getRoot(), resolve, lineNumber)
+                    || !line.rhs.compile(ifStmt->RHS.getExpressionEvaluator()->getRoot(), resolve, lineNumber)) {
+                    throw ParseException(ParseErrorType::InvalidExpressionError, "invalid expression", lineNumber);
+                }
+                break;
+            }
+            case statementType::GOTO: {
+                GOTOstatement *gotoStmt = static_cast<GOTOstatement*>(stmt);
+                line.jump = link(gotoStmt->toLine, index, lineNumber);
+                line.treeHead = number + " GOTO";
+                line.treeBody = retract + std::to_string(gotoStmt->toLine) + "\n";
+                break;
+            }
+            default:
+                line.treeHead = number + " END";
+                break;
+            }
+        }
+        catch (...) {
+            line.error = std::current_exception();
+        }
+    }
+}
+
+std::size_t ProgramImage::size() const {
+    return lines.size();
+}
+
+std::size_t ProgramImage::memoryBytes() const {
+    std::size_t bytes = sizeof(ProgramImage) + lines.capacity() * sizeof(Line) + names.capacity() * sizeof(std::string) + hash.capacity();
+    for (const Line &line : lines) {
+        bytes += (line.lhs.code.capacity() + line.rhs.code.capacity()) * sizeof(ExprInstr);
+        bytes += line.text.capacity() + line.treeHead.capacity() + line.treeBody.capacity();
+    }
+    for (const std::string &name : names) bytes += name.capacity();
+    return bytes;
+}
+
+int ProgramImage::slotCount() const {
+    return static_cast<int>(names.size());
+}
+
+const std::vector<std::string>& ProgramImage::variableNames() const {
+    return names;
+}
+
+const std::string& ProgramImage::key() const {
+    return hash;
+}
+
+bool ProgramImage::hasErrors() const {
+    for (const Line &line : lines) {
+        if (line.error) return true;
+    }
+    return false;
+}
+
+void ProgramImage::save(const std::string &path, const std::string &source) const {
+    if (hasErrors()) throw std::runtime_error("cannot save an image with parse errors");
+    std::string out(imageMagic, sizeof(imageMagic));
+    putInteger(out, imageVersion, 4);
+    putInteger(out, source.size(), 8);
+    out += source;
+    putString(out, hash);
+    putInteger(out, names.size(), 4);
+    for (const std::string &name : names) putString(out, name);
+    putInteger(out, lines.size(), 4);
+    for (const Line &line : lines) {
+        putInteger(out, static_cast<unsigned char>(line.type), 1);
+        putInteger(out, static_cast<unsigned char>(line.ifOperator), 1);
+        putInteger(out, static_cast<std::uint32_t>(line.lineNumber), 4);
+        putInteger(out, static_cast<std::uint32_t>(line.target), 4);
+        putInteger(out, line.jump, 4);
+        putExpression(out, line.lhs.code, line.lhs.line);
+        putExpression(out, line.rhs.code, line.rhs.line);
+        putString(out, line.text);
+        putString(out, line.treeHead);
+        putString(out, line.treeBody);
+    }
+
+    // 同一个文件可能被多个进程、多个线程同时写入，各自先写自己的临时文件
+    std::string partial = path + ".partial." + std::to_string(getpid()) + "."
+        + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream file(partial, std::ios::binary);
+        if (!file || !file.write(out.data(), out.size())) {
+            std::remove(partial.c_str());
+            throw std::runtime_error("cannot write " + path);
+        }
+    }
+    if (std::rename(partial.c_str(), path.c_str()) != 0) {
+        std::remove(partial.c_str());
+        throw std::runtime_error("cannot write " + path);
+    }
+}
+
+std::shared_ptr<const ProgramImage> ProgramImage::load(const std::string &path, const std::string &source) {
+    MappedFile file(path);
+    ImageReader in(file.data(), file.size());
+    if (file.size() < sizeof(imageMagic) || std::string(file.data(), sizeof(imageMagic)) != std::string(imageMagic, sizeof(imageMagic))) {
+        throw std::runtime_error(path + " is not a program image");
+    }
+    in.integer(sizeof(imageMagic));
+    if (in.integer(4) != imageVersion) throw std::runtime_error(path + ": unsupported image version");
+    if (!in.matches(source)) {
+        throw std::runtime_error(path + " is the image of a different program");
+    }
+
+    std::shared_ptr<ProgramImage> image(new ProgramImage());
+    image->hash = in.text();
+    std::size_t slotCount = in.count(4);
+    image->names.reserve(slotCount);
+    for (std::size_t i = 0; i < slotCount; ++i) image->names.push_back(in.text());
+    // 一行至少有类型、运算符、行号、目标、跳转、两个空表达式和三个空字符串
+    std::size_t lineCount = in.count(1 + 1 + 4 + 4 + 4 + 2 * 8 + 3 * 4);
+    image->lines.reserve(lineCount);
+    for (std::size_t i = 0; i < lineCount; ++i) {
+        Line line;
+        std::uint64_t type = in.integer(1);
+        if (type > statementType::Arith) throw std::runtime_error(path + ": image is corrupt");
+        line.type = static_cast<statementType>(type);
+        line.ifOperator = static_cast<char>(in.integer(1));
+        line.lineNumber = in.int32();
+        line.target = in.int32();
+        line.jump = in.integer(4);
+        readExpression(in, line.lhs.code, line.lhs.line, line.lhs.stackDepth, slotCount);
+        readExpression(in, line.rhs.code, line.rhs.line, line.rhs.stackDepth, slotCount);
+        line.text = in.text();
+        line.treeHead = in.text();
+        line.treeBody = in.text();
+        // 执行时不再检查的不变量：跳转下标和槽位在范围内，用到的表达式不为空
+        bool assigns = line.type == statementType::LET || line.type == statementType::INPUT;
+        bool evaluates = line.type == statementType::LET || line.type == statementType::PRINT || line.type == statementType::IF;
+        if (line.jump > lineCount
+            || (assigns && (line.target < 0 || static_cast<std::size_t>(line.target) >= slotCount))
+            || (evaluates && line.rhs.code.empty())
+            || (line.type == statementType::IF && line.lhs.code.empty())) {
+            throw std::runtime_error(path + ": image is corrupt");
+        }
+        image->lines.push_back(std::move(line));
+    }
+    if (!in.atEnd()) throw std::runtime_error(path + ": image is corrupt");
+    return image;
+}
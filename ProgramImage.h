@@ -0,0 +1,76 @@
+#pragma once
+#ifndef PROGRAMIMAGE_H
+#define PROGRAMIMAGE_H
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Typedef.h"
+#include "CompiledExpression.h"
+
+class Program;
+class Statement;
+
+// ProgramImage 是解析、链接完成的程序：每条语句只解析一次，表达式编译成槽位形式，
+// 跳转目标解析成语句下标，语法树中不随运行变化的部分预先生成。
+// 构建之后不再修改，也不引用原来的 Program，多个线程可以用同一个映像各自运行
+// （见 ExecutionContext），不需要复制和加锁。
+class ProgramImage {
+public:
+    // 解析 program 的全部语句；某一行解析失败时不在这里抛出，而是记在该行上，
+    // 运行到该行（或生成语法树）时再抛出，与解释器执行到该行才解析的行为一致。
+    // threads > 1 时按块在多个线程上并行解析（<= 0 表示全部核心），结果与单线程构建完全相同。
+    // 解析的是按语句文本新建的副本，program 本身（语句、变量表）不变
+    static std::shared_ptr<const ProgramImage> build(const Program &program, int threads = 1);
+
+    std::size_t size() const;
+    // 映像在内存中占用的字节数：语句记录、表达式指令、语法树文本和变量名
+    std::size_t memoryBytes() const;
+    int slotCount() const;
+    const std::vector<std::string>& variableNames() const;
+    // 程序文本的内容哈希，与剖析文件、AOT 缓存使用的键相同
+    const std::string& key() const;
+    // 有解析失败的行，这样的映像不能保存
+    bool hasErrors() const;
+
+    // 二进制映像文件：变量表、语句记录、表达式指令、链接好的跳转下标和语法树中不变的部分，
+    // 整数按小端序定长写入，并记下源码 source 的全文。先写临时文件再改名，
+    // 失败时抛出 std::runtime_error
+    void save(const std::string &path, const std::string &source) const;
+    // 映射 path 并直接从映射中解码，不解析任何语句；记下的源码与 source 逐字节比较（在映射中比较，
+    // 哈希相同的不同程序不会被误用），不是 source 的映像、版本不对或内容损坏时
+    // 抛出 std::runtime_error
+    static std::shared_ptr<const ProgramImage> load(const std::string &path, const std::string &source);
+
+private:
+    friend class ExecutionContext;
+
+    struct Line {
+        statementType type;
+        int lineNumber;
+        int target;               // LET 左值 / INPUT 变量的槽位
+        CompiledExpression lhs;   // IF 的左边
+        CompiledExpression rhs;   // LET 右值、PRINT 表达式、IF 的右边
+        char ifOperator;
+        std::size_t jump;         // IF 成立 / GOTO 之后的语句下标，跳到本行时为下一行
+        std::exception_ptr error; // 解析失败时的异常
+        std::string text;         // 运行统计行中的源码
+        std::string treeHead;     // 语法树第一行中运行次数之前的部分
+        std::string treeBody;     // 语法树其余不变的部分（LET 左值一行除外）
+    };
+
+    std::vector<Line> lines;
+    std::vector<std::string> names;
+    std::string hash;
+
+    ProgramImage();
+
+    // 用 parser 解析 statements[begin, end)，写入 lines 的对应位置；变量按首次出现的顺序
+    // 追加到 names，槽位是 names 中的下标
+    static void parseLines(Program &parser, const std::vector<std::pair<int, const Statement*>> &statements,
+                           std::size_t begin, std::size_t end, std::vector<Line> &lines, std::vector<std::string> &names);
+};
+
+#endif // PROGRAMIMAGE_H
@@ -0,0 +1,66 @@
+#include "RunControl.h"
+#include <chrono>
+#include <thread>
+
+namespace {
+
+const std::size_t inputCapacity = 256;
+const std::size_t eventCapacity = 1024;
+
+// 队列为空或已满时先让出几次时间片，仍未就绪再短暂休眠
+void backOff(int &spins) {
+    if (++spins < 64) std::this_thread::yield();
+    else std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+} // namespace
+
+RunControl::RunControl() : attention(0), inputs(inputCapacity), events(eventCapacity) {}
+
+void RunControl::reset() {
+    attention.store(0);
+    inputs.clear();
+    events.clear();
+}
+
+void RunControl::requestStop() {
+    attention.fetch_or(StopRequest);
+}
+
+void RunControl::requestSnapshot() {
+    attention.fetch_or(SnapshotRequest);
+}
+
+bool RunControl::provideInput(const std::string &value) {
+    return inputs.push(value);
+}
+
+bool RunControl::pollEvent(RunEvent &event) {
+    return events.pop(event);
+}
+
+bool RunControl::stopRequested() const {
+    return (attention.load(std::memory_order_acquire) & StopRequest) != 0;
+}
+
+bool RunControl::takeSnapshotRequest() {
+    return (attention.fetch_and(~SnapshotRequest) & SnapshotRequest) != 0;
+}
+
+void RunControl::publish(RunEvent::Kind kind, int line, const std::string &text) {
+    RunEvent event = {kind, line, text};
+    int spins = 0;
+    while (!events.push(event)) {
+        if (stopRequested()) return;
+        backOff(spins);
+    }
+}
+
+bool RunControl::waitForInput(std::string &value) {
+    int spins = 0;
+    while (!inputs.pop(value)) {
+        if (stopRequested()) return false;
+        backOff(spins);
+    }
+    return true;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#ifndef RUNCONTROL_H
+#define RUNCONTROL_H
+#include <atomic>
+#include <string>
+#include "SpscQueue.h"
+
+// 执行线程报告给界面线程的事件
+struct RunEvent {
+    enum Kind {
+        Output,      // 自上次报告以来新增的输出
+        Counters,    // 运行次数有变化的行，每行“下标 次数”，下标为语句的顺序
+        NeedsInput,  // 执行到 INPUT，等待 provideInput
+        Finished,
+        Stopped,     // 响应 requestStop 在 line 行之前停下
+        Error        // text 为异常信息
+    };
+    Kind kind;
+    int line;
+    std::string text;
+};
+
+// RunControl 是执行线程与界面线程之间的通道：输入和事件各走一条无锁队列，
+// 停止和快照请求写在 attention 标志上。解释器在每个语句边界、优化层在每步、
+// JIT 代码在每条回跳上检查该标志，非零时回到解释器的安全点处理请求。
+class RunControl {
+public:
+    enum Request {
+        StopRequest = 1,
+        SnapshotRequest = 2
+    };
+
+    RunControl();
+
+    // 只在没有执行线程时调用
+    void reset();
+
+    // 界面线程
+    void requestStop();
+    void requestSnapshot();
+    bool provideInput(const std::string &value);
+    bool pollEvent(RunEvent &event);
+
+    // 执行线程
+    bool hasRequest() const { return attention.load(std::memory_order_relaxed) != 0; }
+    const std::atomic<int>* attentionFlag() const { return &attention; }
+    bool stopRequested() const;
+    bool takeSnapshotRequest();
+    // 队列满时等待界面线程取走事件；已请求停止时丢弃
+    void publish(RunEvent::Kind kind, int line, const std::string &text);
+    // 阻塞到有输入为止，等待期间请求停止时返回 false
+    bool waitForInput(std::string &value);
+
+private:
+    std::atomic<int> attention;
+    SpscQueue<std::string> inputs;
+    SpscQueue<RunEvent> events;
+};
+
+#endif // RUNCONTROL_H
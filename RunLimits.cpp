@@ -0,0 +1,58 @@
+#include "RunLimits.h"
+#include "Exception.h"
+#include <limits>
+
+RunLimits::RunLimits()
+    : maxStatements(0), maxVariables(0), maxMemory(0), maxOutput(0), timeoutMs(0) {}
+
+bool RunLimits::any() const {
+    return maxStatements > 0 || maxVariables || maxMemory || maxOutput || timeoutMs > 0;
+}
+
+LimitChecker::LimitChecker() {
+    start(RunLimits());
+}
+
+void LimitChecker::start(const RunLimits &limits) {
+    const std::size_t unlimited = std::numeric_limits<std::size_t>::max();
+    current = limits;
+    variableCap = limits.maxVariables ? limits.maxVariables : unlimited;
+    outputCap = limits.maxOutput ? limits.maxOutput : unlimited;
+    memoryCap = limits.maxMemory ? limits.maxMemory : unlimited;
+    if (limits.timeoutMs > 0) deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(limits.timeoutMs);
+    nextCheck = std::numeric_limits<long long>::max();
+    if (limits.maxStatements > 0) nextCheck = limits.maxStatements;
+    if (limits.timeoutMs > 0 && deadlineInterval < nextCheck) nextCheck = deadlineInterval;
+}
+
+const RunLimits& LimitChecker::limits() const {
+    return current;
+}
+
+bool LimitChecker::active() const {
+    return current.any();
+}
+
+void LimitChecker::checkpoint(long long executed, int line) {
+    if (current.maxStatements > 0 && executed >= current.maxStatements) {
+        throw ParseException(ParseErrorType::ResourceLimitError,
+                             "statement limit exceeded (" + std::to_string(current.maxStatements) + " statements)", line);
+    }
+    nextCheck = std::numeric_limits<long long>::max();
+    if (current.maxStatements > 0) nextCheck = current.maxStatements;
+    if (current.timeoutMs > 0) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            throw ParseException(ParseErrorType::ResourceLimitError,
+                                 "time limit exceeded (" + std::to_string(current.timeoutMs) + " ms)", line);
+        }
+        if (executed + deadlineInterval < nextCheck) nextCheck = executed + deadlineInterval;
+    }
+}
+
+void LimitChecker::exceeded(std::size_t totalOutput, std::size_t variables, int line) const {
+    std::string message;
+    if (variables > variableCap) message = "variable limit exceeded (" + std::to_string(current.maxVariables) + " variables)";
+    else if (totalOutput > outputCap) message = "output limit exceeded (" + std::to_string(current.maxOutput) + " bytes)";
+    else message = "memory limit exceeded (" + std::to_string(current.maxMemory) + " bytes)";
+    throw ParseException(ParseErrorType::ResourceLimitError, message, line);
+}
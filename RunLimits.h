@@ -0,0 +1,61 @@
+#pragma once
+#ifndef RUNLIMITS_H
+#define RUNLIMITS_H
+#include <chrono>
+#include <cstddef>
+
+// 一次运行可以使用的资源，各项为 0 表示不限
+struct RunLimits {
+    long long maxStatements;   // 执行的语句条数（燃料）
+    std::size_t maxVariables;  // 定义过的变量个数
+    std::size_t maxMemory;     // 变量和还留在缓冲区里的输出占用的字节数，变量按 LimitChecker::variableBytes 估计
+    std::size_t maxOutput;     // 本次运行输出的总字节数
+    int timeoutMs;             // 从运行开始算起的墙钟时间，等待输入的时间也计算在内
+
+    RunLimits();
+    bool any() const;
+};
+
+// LimitChecker 在运行循环里检查 RunLimits，超出时抛出 ResourceLimitError 类型的 ParseException。
+// 语句数和期限只在向回转移时检查（不向回转移的程序每行最多执行一次），并且只在执行数到达
+// 下一个检查点时才真正比较，期限每 deadlineInterval 条语句才读一次时钟；
+// 变量数在定义新变量时检查，输出和内存在 PRINT 之后检查。没有限制时每处都只是一次整数比较
+class LimitChecker {
+public:
+    LimitChecker();
+
+    // 开始一次运行，期限从此刻算起
+    void start(const RunLimits &limits);
+    const RunLimits& limits() const;
+    bool active() const;
+
+    // executed 为此前已经执行完的语句数，line 为转移所在的行号
+    void backwardJump(long long executed, int line) {
+        if (executed >= nextCheck) checkpoint(executed, line);
+    }
+    // 定义了新的变量之后调用，variables 为现有的变量个数，heldOutput 为缓冲区中的输出字节数
+    void defined(std::size_t variables, std::size_t heldOutput, int line) {
+        if (variables > variableCap || heldOutput + variables * variableBytes > memoryCap) exceeded(0, variables, line);
+    }
+    // PRINT 之后调用，totalOutput 为本次运行输出的总字节数（包括已经释放的）
+    void printed(std::size_t totalOutput, std::size_t heldOutput, std::size_t variables, int line) {
+        if (totalOutput > outputCap || heldOutput + variables * variableBytes > memoryCap) exceeded(totalOutput, variables, line);
+    }
+
+    // 每个变量按这么多字节计入内存（名字、值和映射表的节点）
+    static const std::size_t variableBytes = 64;
+    static const long long deadlineInterval = 16384;
+
+private:
+    RunLimits current;
+    long long nextCheck;       // 执行数到达这里时检查语句数和期限，不限时为最大值
+    std::size_t variableCap;   // 以下不限时为最大值，省去比较前判断是否为 0
+    std::size_t outputCap;
+    std::size_t memoryCap;
+    std::chrono::steady_clock::time_point deadline;
+
+    void checkpoint(long long executed, int line);
+    void exceeded(std::size_t totalOutput, std::size_t variables, int line) const;
+};
+
+#endif // RUNLIMITS_H
@@ -0,0 +1,312 @@
+#include "RunTrace.h"
+#include "InputProvider.h"
+#include "Program.h"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+const char traceMagic[4] = {'Q', 'B', 'T', 'R'};
+const std::uint64_t traceVersion = 1;
+// 每次 step 最多执行的语句数，两次 step 之间检查语句数限制
+const int sliceBudget = 4096;
+
+void putVarint(std::string &out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+void putString(std::string &out, const std::string &text) {
+    putVarint(out, text.size());
+    out += text;
+}
+
+std::uint64_t zigzag(long long value) {
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+class TraceReader {
+public:
+    explicit TraceReader(const std::string &data) : data(data), offset(0) {}
+
+    std::uint64_t varint() {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (offset >= data.size()) throw std::runtime_error("trace is truncated");
+            unsigned char byte = static_cast<unsigned char>(data[offset++]);
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        throw std::runtime_error("trace is corrupt");
+    }
+    std::string text() {
+        std::uint64_t size = varint();
+        if (size > data.size() - offset) throw std::runtime_error("trace is truncated");
+        std::string value = data.substr(offset, size);
+        offset += size;
+        return value;
+    }
+    void skip(std::size_t bytes) {
+        if (bytes > data.size() - offset) throw std::runtime_error("trace is truncated");
+        offset += bytes;
+    }
+    bool atEnd() const { return offset == data.size(); }
+
+private:
+    const std::string &data;
+    std::size_t offset;
+};
+
+long long unzigzag(std::uint64_t value) {
+    return static_cast<long long>(value >> 1) ^ -static_cast<long long>(value & 1);
+}
+
+// 按编码时的规则逐个还原转移
+class JumpDecoder {
+public:
+    struct Jump {
+        long long gap;
+        long long delta;
+    };
+
+    explicit JumpDecoder(const std::string &data) : reader(data), end(0), distance(0), remaining(0) {}
+
+    bool next(Jump &jump) {
+        if (remaining) {
+            jump = history[(end - distance) % RunTrace::historySize];
+            --remaining;
+        }
+        else {
+            if (reader.atEnd()) return false;
+            std::uint64_t head = reader.varint();
+            if (head == 0) {
+                jump.gap = static_cast<long long>(reader.varint());
+                jump.delta = unzigzag(reader.varint());
+            }
+            else {
+                remaining = reader.varint();
+                if (head > static_cast<std::uint64_t>(RunTrace::historySize) || head > end || remaining == 0) {
+                    throw std::runtime_error("trace is corrupt");
+                }
+                distance = head;
+                jump = history[(end - distance) % RunTrace::historySize];
+                --remaining;
+            }
+        }
+        history[end++ % RunTrace::historySize] = jump;
+        return true;
+    }
+
+private:
+    TraceReader reader;
+    Jump history[RunTrace::historySize];
+    std::uint64_t end;
+    std::uint64_t distance;
+    std::uint64_t remaining;
+};
+
+// 录制的输入由 run 逐个用 provideInput 交给解释器，与界面中交互式输入的路径相同；
+// 这里只在输入用完时让 INPUT 报“没有更多输入”，还有输入时要求暂停
+class TraceInput : public InputProvider {
+public:
+    TraceInput(const std::vector<std::string> &values, const std::size_t &position) : values(values), position(position) {}
+
+    Status next(int &value) override {
+        (void)value;
+        return position < values.size() ? Pending : Exhausted;
+    }
+
+private:
+    const std::vector<std::string> &values;
+    const std::size_t &position;
+};
+
+} // namespace
+
+RunTrace::RunTrace()
+    : jumpTotal(0), lastJump(0), historyEnd(0), copyDistance(0), copyLength(0), statementCount(0), limit(0) {
+    Jump none = {0, 0};
+    for (Jump &jump : history) jump = none;
+}
+
+RunTrace RunTrace::run(const std::string &programText, const std::vector<std::string> &inputs, long long maxStatements) {
+    RunTrace trace;
+    trace.text = programText;
+    trace.key = contentHashHex(programText);
+    try {
+        // 与界面相同，用 Program 边运行边录制（录制的运行不升层），录制和回放走同一个解释器
+        Program program;
+        program.setTierThreshold(0);
+        program.setTraceRecording(true);
+        std::size_t nextInput = 0;
+        TraceInput input(inputs, nextInput);
+        program.setInputProvider(&input);
+        program.LoadContent(programText);
+        program.preRun();
+        Program::StepResult step = Program::StepResult::BudgetExhausted;
+        while (step != Program::StepResult::Finished && step != Program::StepResult::Error) {
+            int budget = sliceBudget;
+            if (maxStatements) {
+                long long remaining = maxStatements - program.getExecutedStatements();
+                if (remaining <= 0) break;
+                budget = static_cast<int>(std::min<long long>(budget, remaining));
+            }
+            step = program.step(budget);
+            if (step == Program::StepResult::NeedsInput) program.provideInput(inputs[nextInput++]);
+        }
+        trace = program.getTrace();
+        // 停在语句数限制上的运行没有经过 finishRun，由这里记下结果
+        if (step != Program::StepResult::Finished && step != Program::StepResult::Error) {
+            trace.finish(program.getExecutedStatements(), program.getOutput(), program.getRunCounters(), program.getError());
+        }
+    }
+    catch (const std::exception &e) {
+        trace.finalError = e.what();
+    }
+    trace.limit = maxStatements;
+    trace.flushJumps();
+    return trace;
+}
+
+void RunTrace::save(const std::string &path) const {
+    std::string data(traceMagic, sizeof(traceMagic));
+    putVarint(data, traceVersion);
+    putString(data, key);
+    putString(data, text);
+    putVarint(data, values.size());
+    for (const std::string &value : values) putString(data, value);
+    putVarint(data, jumpTotal);
+    putString(data, jumps);
+    putVarint(data, statementCount);
+    putVarint(data, limit);
+    putString(data, finalOutput);
+    putString(data, finalCounters);
+    putString(data, finalError);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file || !file.write(data.data(), data.size())) throw std::runtime_error("cannot write " + path);
+}
+
+RunTrace RunTrace::load(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) throw std::runtime_error("cannot read " + path);
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.compare(0, sizeof(traceMagic), traceMagic, sizeof(traceMagic)) != 0) throw std::runtime_error(path + " is not a trace");
+
+    TraceReader in(data);
+    in.skip(sizeof(traceMagic));
+    if (in.varint() != traceVersion) throw std::runtime_error(path + ": unsupported trace version");
+    RunTrace trace;
+    trace.key = in.text();
+    trace.text = in.text();
+    std::uint64_t inputCount = in.varint();
+    for (std::uint64_t i = 0; i < inputCount; ++i) trace.values.push_back(in.text());
+    trace.jumpTotal = static_cast<long long>(in.varint());
+    trace.jumps = in.text();
+    trace.statementCount = static_cast<long long>(in.varint());
+    trace.limit = static_cast<long long>(in.varint());
+    trace.finalOutput = in.text();
+    trace.finalCounters = in.text();
+    trace.finalError = in.text();
+    if (!in.atEnd()) throw std::runtime_error(path + ": trace is corrupt");
+    return trace;
+}
+
+const std::string& RunTrace::programKey() const {
+    return key;
+}
+
+const std::string& RunTrace::programText() const {
+    return text;
+}
+
+const std::vector<std::string>& RunTrace::inputs() const {
+    return values;
+}
+
+long long RunTrace::jumpCount() const {
+    return jumpTotal;
+}
+
+long long RunTrace::statements() const {
+    return statementCount;
+}
+
+long long RunTrace::statementLimit() const {
+    return limit;
+}
+
+const std::string& RunTrace::output() const {
+    return finalOutput;
+}
+
+const std::string& RunTrace::counters() const {
+    return finalCounters;
+}
+
+const std::string& RunTrace::error() const {
+    return finalError;
+}
+
+std::size_t RunTrace::encodedJumpBytes() const {
+    return jumps.size();
+}
+
+void RunTrace::start(const std::string &programText) {
+    *this = RunTrace();
+    text = programText;
+    key = contentHashHex(programText);
+}
+
+void RunTrace::finish(long long statements, const std::string &output, const std::string &counters, const std::string &error) {
+    flushJumps();
+    statementCount = statements;
+    finalOutput = output;
+    finalCounters = counters;
+    finalError = error;
+}
+
+long long RunTrace::firstJumpDifference(const RunTrace &other) const {
+    if (jumpTotal == other.jumpTotal && jumps == other.jumps) return -1;
+    JumpDecoder left(jumps), right(other.jumps);
+    JumpDecoder::Jump a, b;
+    for (long long index = 0; ; ++index) {
+        bool moreLeft = left.next(a);
+        bool moreRight = right.next(b);
+        if (!moreLeft && !moreRight) return -1;
+        if (!moreLeft || !moreRight || a.gap != b.gap || a.delta != b.delta) return index;
+    }
+}
+
+void RunTrace::addInput(const std::string &value) {
+    values.push_back(value);
+}
+
+void RunTrace::addNewJump(const Jump &jump) {
+    flushJumps();
+    std::uint64_t available = std::min<std::uint64_t>(historyEnd, historySize);
+    for (std::uint64_t distance = 1; distance <= available; ++distance) {
+        const Jump &earlier = history[(historyEnd - distance) % historySize];
+        if (earlier.gap == jump.gap && earlier.delta == jump.delta) {
+            copyDistance = distance;
+            copyLength = 1;
+            return;
+        }
+    }
+    putVarint(jumps, 0);
+    putVarint(jumps, static_cast<std::uint64_t>(jump.gap));
+    putVarint(jumps, zigzag(jump.delta));
+}
+
+void RunTrace::flushJumps() {
+    if (!copyDistance) return;
+    putVarint(jumps, copyDistance);
+    putVarint(jumps, copyLength);
+    copyDistance = 0;
+    copyLength = 0;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#ifndef RUNTRACE_H
+#define RUNTRACE_H
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// RunTrace 是一次运行的录制：程序文本、按顺序读入的每个 INPUT 值、实际发生的转移序列
+// （IF 成立和 GOTO），以及运行结束时的输出、运行统计和错误。
+// 每次转移记为“距上一次转移的语句数、目标相对当前语句的下标差”两个差分值，再做短距离的
+// LZ 压缩：与前面 historySize 次之内某次转移相同的一串转移只记距离和长度，
+// 循环（包括几次转移交替出现的循环）在录制中通常只占几个字节。
+// 解释执行是确定的，回放是用录下的输入无界面地运行一遍（见 run），比较两份录制即可确认
+// 路径、输出和运行统计都与原来相同。界面中的解释器在执行线程上边运行边录制（见 start / finish），
+// run 用同一个解释器（Program）录制，两边的错误和统计不会因为执行引擎不同而不一致。
+class RunTrace {
+public:
+    RunTrace();
+
+    // 用录制模式的 Program 运行 programText，INPUT 依次取 inputs 中的文本（与界面中输入的文本相同），返回本次运行的录制；
+    // 输入用完时与批量运行相同，报“没有更多输入”。maxStatements > 0 时最多执行这么多条语句
+    static RunTrace run(const std::string &programText, const std::vector<std::string> &inputs, long long maxStatements = 0);
+
+    // 二进制文件，读写失败或格式不对时抛出 std::runtime_error
+    void save(const std::string &path) const;
+    static RunTrace load(const std::string &path);
+
+    const std::string& programKey() const;
+    const std::string& programText() const;
+    const std::vector<std::string>& inputs() const;
+    long long jumpCount() const;
+    long long statements() const;
+    // 录制时的语句数限制，0 表示不限
+    long long statementLimit() const;
+    const std::string& output() const;
+    const std::string& counters() const;
+    const std::string& error() const;
+    std::size_t encodedJumpBytes() const;
+
+    // 由调用方自己执行并录制：start 之后按顺序 addInput / addJump，运行结束时 finish 记下结果
+    void start(const std::string &programText);
+    void finish(long long statements, const std::string &output, const std::string &counters, const std::string &error);
+
+    // 与 other 的转移序列相同时返回 -1，否则返回第一个不同的转移的序号（从 0 开始）
+    long long firstJumpDifference(const RunTrace &other) const;
+
+    // 以下在录制时由 Program 调用
+    void addInput(const std::string &value);
+    // executed 为此前已执行完的语句数，from / to 为转移前后的语句下标
+    void addJump(long long executed, std::size_t from, std::size_t to) {
+        Jump jump = {executed - lastJump, static_cast<long long>(to) - static_cast<long long>(from)};
+        lastJump = executed;
+        ++jumpTotal;
+        // 常见情况：仍在重复 copyDistance 次之前的转移
+        const Jump &earlier = history[(historyEnd - copyDistance) % historySize];
+        if (copyDistance && jump.gap == earlier.gap && jump.delta == earlier.delta) ++copyLength;
+        else addNewJump(jump);
+        history[historyEnd++ % historySize] = jump;
+    }
+
+    static const int historySize = 8;
+
+private:
+    struct Jump {
+        long long gap;
+        long long delta;
+    };
+
+    std::string key;
+    std::string text;
+    std::vector<std::string> values;
+    // 编码后的转移，每项以一个变长整数开头：0 表示一次新的转移，后跟 gap 和 zigzag(delta)；
+    // 1..historySize 表示接下来若干次转移依次与这么多次之前的转移相同，后跟次数
+    std::string jumps;
+    long long jumpTotal;
+    long long lastJump;
+    Jump history[historySize];   // 最近的转移，historyEnd 之前的 historySize 个有效
+    std::uint64_t historyEnd;
+    std::uint64_t copyDistance;  // 正在累积的重复段的距离，0 表示没有
+    std::uint64_t copyLength;
+    long long statementCount;
+    long long limit;
+    std::string finalOutput;
+    std::string finalCounters;
+    std::string finalError;
+
+    void addNewJump(const Jump &jump);
+    void flushJumps();
+};
+
+#endif // RUNTRACE_H
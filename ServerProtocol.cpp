@@ -0,0 +1,28 @@
+#include "ServerProtocol.h"
+
+namespace ServerProtocol {
+
+void appendFrame(std::string &out, char type, const std::string &payload) {
+    std::size_t length = payload.size();
+    out += static_cast<char>((length >> 24) & 0xFF);
+    out += static_cast<char>((length >> 16) & 0xFF);
+    out += static_cast<char>((length >> 8) & 0xFF);
+    out += static_cast<char>(length & 0xFF);
+    out += type;
+    out += payload;
+}
+
+ParseResult takeFrame(const std::string &buffer, std::size_t &offset, char &type, std::string &payload) {
+    if (buffer.size() - offset < 5) return Incomplete;
+    const unsigned char *header = reinterpret_cast<const unsigned char*>(buffer.data() + offset);
+    std::size_t length = (static_cast<std::size_t>(header[0]) << 24) | (static_cast<std::size_t>(header[1]) << 16)
+                       | (static_cast<std::size_t>(header[2]) << 8) | header[3];
+    if (length > maxPayload) return Malformed;
+    if (buffer.size() - offset - 5 < length) return Incomplete;
+    type = static_cast<char>(header[4]);
+    payload.assign(buffer, offset + 5, length);
+    offset += 5 + length;
+    return Complete;
+}
+
+} // namespace ServerProtocol
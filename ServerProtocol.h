@@ -0,0 +1,40 @@
+#pragma once
+#ifndef SERVERPROTOCOL_H
+#define SERVERPROTOCOL_H
+#include <cstddef>
+#include <string>
+
+// 执行服务器与客户端之间的分帧协议。每帧为 4 字节大端长度、1 字节类型和负载，
+// 长度只计负载。一个请求由若干请求帧组成，以 Run 帧结束；同一连接上的请求按顺序执行，
+// 每个请求的响应以 Done 帧结束。
+namespace ServerProtocol {
+
+enum FrameType : char {
+    // 客户端 -> 服务器
+    ProgramText = 'P',  // 程序文本，按 LoadContent 的格式
+    InputValues = 'I',  // INPUT 的值，每行一个，可以分多帧发送
+    Timeout = 'T',      // 本请求的超时毫秒数（十进制文本），不发则用服务器的默认值
+    Run = 'R',          // 负载为空，开始执行前面的各帧组成的请求
+
+    // 服务器 -> 客户端
+    Output = 'O',       // 自上一帧以来新增的 PRINT 输出
+    SyntaxTree = 'S',   // 正常结束后的带运行统计的语法树
+    Error = 'E',        // JSON：{"type":..,"line":..,"message":..}
+    Done = 'D'          // JSON：{"status":..,"statements":..,"cached":..,"micros":..}
+};
+
+// 超过这个长度的帧视为协议错误
+const std::size_t maxPayload = 64u << 20;
+
+void appendFrame(std::string &out, char type, const std::string &payload);
+
+enum ParseResult {
+    Complete,    // 取出了一帧，offset 已移到下一帧
+    Incomplete,  // 数据还不够一帧
+    Malformed    // 长度超过 maxPayload
+};
+ParseResult takeFrame(const std::string &buffer, std::size_t &offset, char &type, std::string &payload);
+
+} // namespace ServerProtocol
+
+#endif // SERVERPROTOCOL_H
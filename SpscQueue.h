@@ -0,0 +1,56 @@
+#pragma once
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// 单生产者单消费者的无锁环形队列：一个线程只调用 push，另一个线程只调用 pop。
+// 容量向上取到 2 的幂，满时 push 返回 false，由调用方决定等待还是丢弃
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(std::size_t capacity) : head(0), tail(0) {
+        std::size_t size = 2;
+        while (size < capacity) size *= 2;
+        buffer.resize(size);
+        mask = size - 1;
+    }
+
+    bool push(T value) {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) > mask) return false;
+        buffer[t & mask] = std::move(value);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &value) {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        value = std::move(buffer[h & mask]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    // 只能在两端都不再访问时调用
+    void clear() {
+        T discarded;
+        while (pop(discarded)) {}
+    }
+
+private:
+    std::vector<T> buffer;
+    std::size_t mask;
+    // 生产者和消费者各自改写的下标隔开一个缓存行，避免伪共享
+    std::atomic<std::size_t> head;
+    char padding[64];
+    std::atomic<std::size_t> tail;
+};
+
+#endif // SPSCQUEUE_H
@@ -1,10 +1,23 @@
 #include "Statement.h"
 #include "Program.h"
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
 std::string trimLeadingWhitespace(const std::string& str) {
     size_t start = str.find_first_not_of(" \t\n\v\f\r");
     return (start == std::string::npos) ? "" : str.substr(start);
 }
 
+// 与 std::stoi 相同地读出整数（跳过前导空白，读不出或超出 int 时失败），但不抛出异常
+static bool readLineNumber(const char *text, int &value) {
+    char *end;
+    errno = 0;
+    long number = std::strtol(text, &end, 10);
+    if (end == text || errno == ERANGE || number < INT_MIN || number > INT_MAX) return false;
+    value = static_cast<int>(number);
+    return true;
+}
+
 // trim blank on both ends
 std::string trimBothEnds(const std::string& str) {
     size_t first = str.find_first_not_of(' ');
@@ -32,6 +45,10 @@ int Statement::getRunTime() const{
     return this->runTime;
 }
 
+int Statement::getLineNumber() const{
+    return this->lineNumber;
+}
+
 Statement::Statement(){}
 
 Statement::~Statement(){}
@@ -44,6 +61,18 @@ std::string Statement::syntaxTreeWithRunStatistics() const {
     return nullptr;
 }
 
+std::string Statement::runStatisticsLine() const {
+    return std::to_string(this->lineNumber) + " " + this->statement + "    " + runCounts() + "\n";
+}
+
+std::string Statement::runCounts() const {
+    return std::to_string(getRunTime());
+}
+
+bool Statement::jumpTarget(int &) const {
+    return false;
+}
+
 statementType Statement::getType() const{
     return this->type;
 }
@@ -52,7 +81,9 @@ std::string Statement::getRaw() const{
     return std::to_string(this->lineNumber) + " " + this->statement + "\n";
 }
 
-Arithstatement::Arithstatement(){}
+Arithstatement::Arithstatement(){
+    this->expressionEvaluator = nullptr;
+}
 
 Arithstatement::Arithstatement(int lineNumber, std::string statement): Statement(){
     // Trim leading whitespace
@@ -70,7 +101,7 @@ void Arithstatement::setRunStatistics(int n){
 }
 
 void Arithstatement::parse(Program &program) {
-    this->expressionEvaluator = new ExpressionEvaluator(statement, &program, lineNumber);
+    this->expressionEvaluator.reset(new ExpressionEvaluator(statement, &program, lineNumber));
 }
 
 void Arithstatement::exec(Program &program){}
@@ -79,6 +110,10 @@ int Arithstatement::getValue(){
     return this->expressionEvaluator->getValue();
 }
 
+const ExpressionEvaluator* Arithstatement::getExpressionEvaluator() const{
+    return this->expressionEvaluator.get();
+}
+
 std::string Arithstatement::syntaxTree() const{
     return this->expressionEvaluator->syntaxTree();
 }
@@ -165,14 +200,9 @@ void LETstatement::parse(Program &program){
         if (this->LHS.length()<= 0) throw ParseException(ParseErrorType::MissingOperandError, "Missing operand on the left side of =", lineNumber);
         this->LHS_sta = Arithstatement(this->lineNumber, this->LHS);
         this->LHS_sta.parse(program);
-
-        auto it = program.variables.find(this->LHS);
-        if (it == program.variables.end()) {
-            VariableInfo varInfo = {0, 0};
-
-            // add to variables
-            program.variables[this->LHS] = varInfo;
-        }
+        // 左边只能是单个变量（LET a+b = 1、LET 5 = 1 都不合法）；变量在第一次执行时才加入变量表
+        const VariableNode *target = dynamic_cast<const VariableNode*>(this->LHS_sta.getExpressionEvaluator()->getRoot());
+        if (!target || target->name != this->LHS) throw ParseException(ParseErrorType::InvalidExpressionError, "invalid expression", lineNumber);
 
         // extract the right hand side
         std::string right = trimBothEnds(save.substr(pos + 1));
@@ -186,19 +216,21 @@ void LETstatement::parse(Program &program){
 }
 
 void LETstatement::exec(Program &program){
+    // 先求右边的值：LET a = a + 1 中的 a 此前没有赋过值时报未定义
+    int value = this->RHS.getValue();
     auto it = program.variables.find(LHS);
     if (it != program.variables.end()){
-        it->second.value = this->RHS.getValue();
+        it->second.value = value;
         //std::cout << "LET: " << this->RHS.getValue() << std::endl;
 //        it->second.usageCount++;
-        this->runTime ++;
     }
     else {
-        VariableInfo varInfo = {this->RHS.getValue(), 0};
+        VariableInfo varInfo = {value, 0};
 
         // add to variables
         program.variables[this->LHS] = varInfo;
     }
+    this->runTime ++;
 }
 
 
@@ -221,6 +253,7 @@ IFstatement::IFstatement(int lineNumber, std::string statement): Statement(){
     this->type = statementType::IF;
     this->statement = statement;
     this->lineNumber = lineNumber;
+    this->toLine = INT_MIN;
     this->trueTime = 0;
     this->falseTime = 0;
 }
@@ -232,6 +265,10 @@ void IFstatement::setRunStatistics(int n){
     this->falseTime = n;
 }
 
+int IFstatement::getRunTime() const{
+    return this->trueTime + this->falseTime;
+}
+
 std::vector<std::string> IFstatement::splitByNewline(const std::string& str) const {
     std::vector<std::string> result;
     std::istringstream iss(str);
@@ -353,7 +390,7 @@ void IFstatement::parse(Program &program){
         if (target.length()<= 0) throw ParseException(ParseErrorType::MissingOperandError, "Missing line number after THEN", lineNumber);
         this->toLine = std::stoi(target);
         // if line number is invalid
-        if (program.statements.find(toLine) == program.statements.end()){
+        if (!program.hasLine(toLine)){
             throw ParseException(ParseErrorType::UndefinedLineError, "undefined line number", lineNumber);
         }
     } else {
@@ -409,6 +446,20 @@ std::string IFstatement::syntaxTreeWithRunStatistics() const{
     return syntaxTree;
 }
 
+std::string IFstatement::runCounts() const{
+    return std::to_string(this->trueTime) + " " + std::to_string(this->falseTime);
+}
+
+bool IFstatement::jumpTarget(int &lineNumber) const{
+    // 与 parse 相同地取出 THEN 之后的行号，在原文本上查找，不复制子串
+    if (statement.size() < 3 || statement.compare(0, 3, "IF ") != 0) return false;
+    std::size_t first = statement.find_first_not_of(' ', 3);
+    if (first == std::string::npos) return false;
+    std::size_t end = statement.find_last_not_of(' ') + 1;
+    std::size_t pos = statement.find(" THEN", first);
+    if (pos == std::string::npos || pos + 5 > end) return false;
+    return readLineNumber(statement.c_str() + pos + 5, lineNumber);
+}
 
 PRINTstatement::PRINTstatement(int lineNumber, std::string statement): Statement(){
     statement = trimLeadingWhitespace(statement);
@@ -480,12 +531,16 @@ void INPUTstatement::parse(Program &program){
 
 void INPUTstatement::exec(Program &program){
     int value;
-    try {
-        value = std::stoi(trimBothEnds(program.input));
+    if (program.inputIsValue) {
+        // 非交互式来源已经解析好了
+        value = program.inputValue;
+    }
+    else if (parseInteger(program.input.data(), program.input.size(), value)) {
         std::cout << "INPUT value: " << value << std::endl;
     }
-    catch (const std::invalid_argument& ia){
-        throw ParseException(ParseErrorType::TypeError, "not a integer", lineNumber);
+    else {
+        // 与非交互式来源和 ExecutionContext 相同，超出 int 范围的数也按不是整数报告
+        InputProvider::fail(InputProvider::Invalid, lineNumber);
     }
     auto it = program.variables.find(this->input);
     if (it != program.variables.end()){
@@ -511,6 +566,7 @@ GOTOstatement::GOTOstatement(int lineNumber, std::string statement): Statement()
     this->type = statementType::GOTO;
     this->statement = statement;
     this->lineNumber = lineNumber;
+    this->toLine = INT_MIN;
     this->runTime = 0;
 }
 
@@ -525,7 +581,7 @@ void GOTOstatement::parse(Program &program){
         this->toLine = std::stoi(trimLeadingWhitespace(statement.substr(5)));
         std::cout << "GOTO toline: " << toLine << std::endl;
         // if line number is invalid
-        if (program.statements.find(toLine) == program.statements.end()){
+        if (!program.hasLine(toLine)){
             throw ParseException(ParseErrorType::UndefinedLineError, "GOTO line number does't exist", lineNumber);
         }
     }
@@ -540,6 +596,11 @@ void GOTOstatement::exec(Program &program){
     return;
 }
 
+bool GOTOstatement::jumpTarget(int &lineNumber) const{
+    if (statement.size() < 5 || statement.compare(0, 5, "GOTO ") != 0) return false;
+    return readLineNumber(statement.c_str() + 5, lineNumber);
+}
+
 std::string GOTOstatement::syntaxTree() const {
     return std::to_string(lineNumber) + " GOTO\n" + retract + std::to_string(this->toLine) + "\n";
 }
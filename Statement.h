@@ -6,6 +6,7 @@
 #include "Program.h"
 #include "ExpressionEvaluator.h"
 #include <map>
+#include <memory>
 #include <stdexcept>
 #include <iostream>
 #include <string>
@@ -17,6 +18,11 @@ std::string printLevelOrder(const std::string &levelOrder, const std::string &re
 
 class Statement{
 //    friend class Program;
+    friend class TierManager;
+    friend class AotCompiler;
+    friend class ProgramImage;
+    friend class LoopAnalysis;
+    friend class LoopSummary;
 
 protected:
     std::string statement;
@@ -31,24 +37,35 @@ public:
     virtual void exec(Program &program)=0;
     virtual std::string syntaxTree() const;
     virtual std::string syntaxTreeWithRunStatistics() const;
+    // 一行源码加运行次数，不依赖语法树，运行中途也可以生成
+    std::string runStatisticsLine() const;
+    // 运行次数，IF 为成立和不成立的次数
+    virtual std::string runCounts() const;
+    // IF / GOTO 的目标行，只看语句文本、不解析表达式，与 parse 读出的 toLine 相同；
+    // 其它语句或读不出行号时返回 false
+    virtual bool jumpTarget(int &lineNumber) const;
     statementType getType() const;
     std::string getRaw()const;
-    int getRunTime() const;
+    int getLineNumber() const;
+    virtual int getRunTime() const;
 };
 
 
 class Arithstatement:public Statement{
 //    friend class Program;
 private:
-    ExpressionEvaluator* expressionEvaluator;
+    std::unique_ptr<ExpressionEvaluator> expressionEvaluator;  // 每次 parse 重新生成，旧的随之释放
 public:
     Arithstatement();
     Arithstatement(int lineNumber, std::string statement);
+    Arithstatement(Arithstatement&&) = default;
+    Arithstatement& operator=(Arithstatement&&) = default;
     virtual ~Arithstatement();
     virtual void setRunStatistics(int n) override;
     virtual void parse(Program &program) override;
     virtual void exec(Program &program) override;
     int getValue();
+    const ExpressionEvaluator* getExpressionEvaluator() const;
 //    Tree syntaxTree() override;
     virtual std::string syntaxTree() const override;
     std::string mergeTrees(const Arithstatement &B) const;
@@ -60,6 +77,7 @@ public:
 class REMstatement:public Statement{
 private:
     std::string remark;
+    friend class ProgramImage;
 public:
     REMstatement(int lineNumber, std::string statement);
     virtual ~REMstatement();
@@ -75,7 +93,11 @@ private:
     std::string LHS;
     Arithstatement LHS_sta;
     Arithstatement RHS;
-    int runTime;
+    friend class TierManager;
+    friend class AotCompiler;
+    friend class ProgramImage;
+    friend class LoopAnalysis;
+    friend class LoopSummary;
 public:
     LETstatement(int lineNumber, std::string statement);
     virtual ~LETstatement();
@@ -92,27 +114,39 @@ private:
     Arithstatement LHS;
     Arithstatement RHS;
     char ifOperator;
-    int toLine;
+    int toLine;         // 解析之前为 INT_MIN
     int trueTime;
     int falseTime;
     std::vector<std::string> splitByNewline(const std::string& str) const;
     std::string mergeTrees(const std::string& A, const std::string& B) const;
     std::string printLevelOrder(const std::string &levelOrder) const;
+    friend class TierManager;
+    friend class AotCompiler;
+    friend class ProgramImage;
+    friend class LoopAnalysis;
+    friend class LoopSummary;
 
 public:
     IFstatement(int lineNumber, std::string statement);
     virtual ~IFstatement();
     virtual void setRunStatistics(int n) override;
+    virtual int getRunTime() const override;
     virtual void parse(Program &program) override;
     virtual void exec(Program &program) override;
     virtual std::string syntaxTree() const override;
     virtual std::string syntaxTreeWithRunStatistics() const override;
+    virtual std::string runCounts() const override;
+    virtual bool jumpTarget(int &lineNumber) const override;
 };
 
 class PRINTstatement:public Statement{
 private:
     Arithstatement print;
-    int runTime;
+    friend class TierManager;
+    friend class AotCompiler;
+    friend class ProgramImage;
+    friend class LoopAnalysis;
+    friend class LoopSummary;
 public:
     PRINTstatement(int lineNumber, std::string statement);
     virtual ~PRINTstatement();
@@ -126,7 +160,11 @@ public:
 class INPUTstatement:public Statement{
 private:
     std::string input;
-    int runTime;
+    friend class TierManager;
+    friend class AotCompiler;
+    friend class ProgramImage;
+    friend class LoopAnalysis;
+    friend class LoopSummary;
 public:
     INPUTstatement(int lineNumber, std::string statement);
     virtual ~INPUTstatement();
@@ -140,8 +178,12 @@ public:
 
 class GOTOstatement:public Statement{
 private:
-    int toLine;
-    int runTime;
+    int toLine;         // 解析之前为 INT_MIN
+    friend class TierManager;
+    friend class AotCompiler;
+    friend class ProgramImage;
+    friend class LoopAnalysis;
+    friend class LoopSummary;
 public:
     GOTOstatement(int lineNumber, std::string statement);
     virtual ~GOTOstatement();
@@ -150,12 +192,11 @@ public:
     virtual void exec(Program &program) override;
     virtual std::string syntaxTree() const override;
     virtual std::string syntaxTreeWithRunStatistics() const override;
+    virtual bool jumpTarget(int &lineNumber) const override;
 };
 
 
 class ENDstatement:public Statement{
-private:
-    int runTime;
 public:
     ENDstatement(int lineNumber, std::string statement);
     virtual ~ENDstatement();
@@ -0,0 +1,164 @@
+#include "SyntaxTreeModel.h"
+#include "Program.h"
+#include "Typedef.h"
+#include <algorithm>
+#include <exception>
+
+namespace {
+
+// 顶层行的 internalId 为 0，子节点为父行的行号加 1
+const quintptr topLevel = 0;
+
+// 快照一行“行号 语句    次数”中语句与次数之间的分隔
+const char counterSeparator[] = "    ";
+
+} // namespace
+
+SyntaxTreeModel::SyntaxTreeModel(Program &program, QObject *parent)
+    : QAbstractItemModel(parent), program(program), live(true) {}
+
+QModelIndex SyntaxTreeModel::index(int row, int column, const QModelIndex &parent) const {
+    if (row < 0 || column < 0 || column >= columnCount(parent)) return QModelIndex();
+    if (!parent.isValid()) return createIndex(row, column, topLevel);
+    if (parent.internalId() != topLevel) return QModelIndex();
+    return createIndex(row, column, static_cast<quintptr>(parent.row()) + 1);
+}
+
+QModelIndex SyntaxTreeModel::parent(const QModelIndex &child) const {
+    if (!child.isValid() || child.internalId() == topLevel) return QModelIndex();
+    return createIndex(static_cast<int>(child.internalId() - 1), 0, topLevel);
+}
+
+int SyntaxTreeModel::rowCount(const QModelIndex &parent) const {
+    if (!parent.isValid()) return static_cast<int>(live ? rows.size() : counterStatements.size());
+    if (parent.internalId() != topLevel || parent.column() != 0 || !hasChildren(parent)) return 0;
+    return static_cast<int>(subtree(parent.row()).lines.size());
+}
+
+int SyntaxTreeModel::columnCount(const QModelIndex &) const {
+    return 2;
+}
+
+bool SyntaxTreeModel::hasChildren(const QModelIndex &parent) const {
+    if (!parent.isValid()) return rowCount(parent) > 0;
+    // 只凭语句类型判断，不渲染，折叠着的语句没有任何开销
+    return live && parent.internalId() == topLevel && parent.column() == 0
+        && parent.row() < static_cast<int>(rows.size()) && program.lineHasSubtree(rows[parent.row()]);
+}
+
+QVariant SyntaxTreeModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || role != Qt::DisplayRole) return QVariant();
+    if (index.internalId() != topLevel) {
+        if (index.column() != 0) return QVariant();
+        const Subtree &tree = subtree(static_cast<int>(index.internalId() - 1));
+        if (index.row() >= static_cast<int>(tree.lines.size())) return QVariant();
+        return QString::fromStdString(tree.lines[index.row()]);
+    }
+    if (live) {
+        if (index.row() >= static_cast<int>(rows.size())) return QVariant();
+        int lineNumber = rows[index.row()];
+        return QString::fromStdString(index.column() == 0 ? program.lineText(lineNumber) : program.lineRunCounts(lineNumber));
+    }
+    if (index.row() >= static_cast<int>(counterStatements.size())) return QVariant();
+    return QString::fromStdString(index.column() == 0 ? counterStatements[index.row()] : counterCounts[index.row()]);
+}
+
+QVariant SyntaxTreeModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) return QVariant();
+    return section == 0 ? tr("语句") : tr("运行次数");
+}
+
+void SyntaxTreeModel::refresh() {
+    beginResetModel();
+    live = true;
+    rows = program.lineNumbers();
+    subtrees.clear();
+    counterStatements.clear();
+    counterCounts.clear();
+    endResetModel();
+}
+
+void SyntaxTreeModel::showCounters(const std::string &text) {
+    std::vector<std::string> statements, counts;
+    const char *data = text.data();
+    const char *end = data + text.size();
+    for (const char *line = data; line < end; ) {
+        const char *eol = findByte(line, end, '\n');
+        std::string row(line, eol);
+        std::size_t separator = row.rfind(counterSeparator);
+        if (separator == std::string::npos) separator = row.size();
+        statements.push_back(row.substr(0, separator));
+        counts.push_back(row.substr(std::min(separator + sizeof(counterSeparator) - 1, row.size())));
+        line = eol < end ? eol + 1 : end;
+    }
+    if (!live && statements.size() == counterStatements.size()) {
+        // 行数不变时不重置模型，保留滚动位置，视图只重绘可见的行
+        counterStatements.swap(statements);
+        counterCounts.swap(counts);
+        if (!counterStatements.empty()) emit dataChanged(index(0, 0), index(static_cast<int>(counterStatements.size()) - 1, 1));
+        return;
+    }
+    // 从程序切换到快照（运行结束后 refresh 再重新读取程序），或者行数变了
+    beginResetModel();
+    live = false;
+    rows.clear();
+    subtrees.clear();
+    counterStatements.swap(statements);
+    counterCounts.swap(counts);
+    endResetModel();
+}
+
+void SyntaxTreeModel::updateCounters(const std::string &changes) {
+    if (live) return;
+    int first = -1, last = -1;
+    const char *data = changes.data();
+    const char *end = data + changes.size();
+    for (const char *line = data; line < end; ) {
+        const char *eol = findByte(line, end, '\n');
+        const char *space = findByte(line, eol, ' ');
+        int row;
+        if (space < eol && parseInteger(line, space - line, row) && row >= 0 && row < static_cast<int>(counterCounts.size())) {
+            counterCounts[row].assign(space + 1, eol);
+            if (first < 0 || row < first) first = row;
+            if (row > last) last = row;
+        }
+        line = eol < end ? eol + 1 : end;
+    }
+    if (first >= 0) emit dataChanged(index(first, 1), index(last, 1));
+}
+
+void SyntaxTreeModel::clear() {
+    beginResetModel();
+    live = true;
+    rows.clear();
+    subtrees.clear();
+    counterStatements.clear();
+    counterCounts.clear();
+    endResetModel();
+}
+
+const SyntaxTreeModel::Subtree& SyntaxTreeModel::subtree(int row) const {
+    int lineNumber = rows[row];
+    auto it = subtrees.find(lineNumber);
+    if (it != subtrees.end()) return it->second;
+    Subtree &tree = subtrees[lineNumber];
+    std::string text;
+    try {
+        text = program.lineSyntaxTree(lineNumber);
+    }
+    catch (const std::exception &e) {
+        // 解析错误（ParseException，或表达式里的数字不合法时的 std::invalid_argument）显示在这一行下面
+        tree.lines.push_back(e.what());
+        return tree;
+    }
+    // 第一行是标题（行号、语句类型和运行次数），顶层行已经显示了语句和次数
+    std::size_t begin = text.find('\n');
+    begin = begin == std::string::npos ? text.size() : begin + 1;
+    while (begin < text.size()) {
+        const char *eol = findByte(text.data() + begin, text.data() + text.size(), '\n');
+        std::size_t end = eol - text.data();
+        tree.lines.push_back(text.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return tree;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#ifndef SYNTAXTREEMODEL_H
+#define SYNTAXTREEMODEL_H
+#include <QAbstractItemModel>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Program;
+
+// 语法树区的数据模型，配合等高行的 QTreeView 使用：顶层每条语句一行，第二列是运行次数，
+// 展开一行时才向 Program 要这一行的语法树（重新解析并渲染），结果缓存到下次 refresh；
+// 没有展开的语句不解析也不渲染，运行次数在视图绘制时读取，总是当前的值。
+// 程序在执行线程上运行时不能访问 Program，这期间显示执行线程发来的运行统计快照
+class SyntaxTreeModel : public QAbstractItemModel {
+    Q_OBJECT
+public:
+    explicit SyntaxTreeModel(Program &program, QObject *parent = nullptr);
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    // 程序可以访问时调用（运行结束、执行一条命令之后）：重新读取行号，丢弃已渲染的语法树
+    void refresh();
+    // 运行开始时：显示 Program::getRunCounters 格式的快照，行数不变时只刷新可见行
+    void showCounters(const std::string &counters);
+    // 运行中：按 RunEvent::Counters 的“下标 次数”更新快照中的运行次数，只刷新变了的行
+    void updateCounters(const std::string &changes);
+    void clear();
+
+private:
+    // 一条语句渲染好的语法树，标题行之外每行一个子节点；出错时只有错误信息一行
+    struct Subtree {
+        std::vector<std::string> lines;
+    };
+
+    Program &program;
+    bool live;                     // true：行来自 program；false：行来自运行统计快照
+    std::vector<int> rows;         // live 时各行的行号，升序
+    std::vector<std::string> counterStatements;  // 快照各行的“行号 语句”
+    std::vector<std::string> counterCounts;      // 快照各行的运行次数
+    mutable std::unordered_map<int, Subtree> subtrees;  // 按顶层行号缓存已展开的语法树
+
+    const Subtree& subtree(int row) const;
+};
+
+#endif // SYNTAXTREEMODEL_H
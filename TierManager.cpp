@@ -0,0 +1,688 @@
+#include "TierManager.h"
+#include "Program.h"
+#include "Statement.h"
+#include "AllocationProfiler.h"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <set>
+
+const int TierManager::noLine = INT_MIN;
+const int TierManager::needsInput = INT_MIN + 1;
+
+namespace {
+
+// 常走一边的转移占比低于该值的 IF 不放进超级块，块在它之前结束
+const double likelyRatio = 0.6;
+const std::size_t maxSuperblockLength = 64;
+
+bool ifTaken(char ifOperator, int l, int r) {
+    return (ifOperator == '=' && l == r) || (ifOperator == '>' && l > r) || (ifOperator == '<' && l < r);
+}
+
+// 一条优化语句的执行次数（IF 为真假次数之和），与运行统计一样按 32 位回绕
+int executions(const OptimizedStatement *opt) {
+    if (opt->type == statementType::IF) return static_cast<int>(static_cast<std::uint32_t>(*opt->trueTime) + static_cast<std::uint32_t>(*opt->falseTime));
+    return *opt->runTime;
+}
+
+} // namespace
+
+TierManager::TierManager() : threshold(defaultThreshold), jitThreshold(defaultJitThreshold), profile(nullptr), recorder(nullptr), interrupt(nullptr), input(nullptr) {}
+
+void TierManager::setThreshold(int threshold) {
+    this->threshold = threshold;
+    if (threshold <= 0) invalidate();
+}
+
+int TierManager::getThreshold() const {
+    return this->threshold;
+}
+
+bool TierManager::isEnabled() const {
+    return this->threshold > 0;
+}
+
+void TierManager::setJitThreshold(int threshold) {
+    this->jitThreshold = threshold;
+    if (threshold <= 0) {
+        for (auto &entry : compiled) entry.second->jit = nullptr;
+        jitRegions.clear();
+    }
+}
+
+void TierManager::setProfile(const PgoProfile *profile) {
+    this->profile = (profile && !profile->empty()) ? profile : nullptr;
+}
+
+void TierManager::setRecorder(EdgeProfiler *recorder) {
+    this->recorder = recorder;
+}
+
+void TierManager::setInterrupt(const std::atomic<int> *interrupt) {
+    this->interrupt = interrupt;
+}
+
+void TierManager::setInputProvider(InputProvider *input) {
+    this->input = input;
+}
+
+bool TierManager::hasCompiledCode() const {
+    return !compiled.empty();
+}
+
+OptimizedStatement* TierManager::lookup(int lineNumber) const {
+    auto it = compiled.find(lineNumber);
+    if (it == compiled.end()) return nullptr;
+    return it->second.get();
+}
+
+int TierManager::compiledCount() const {
+    return static_cast<int>(compiled.size());
+}
+
+int TierManager::jitRegionCount() const {
+    return static_cast<int>(jitRegions.size());
+}
+
+int TierManager::fusedLoopCount() const {
+    int count = 0;
+    for (auto &entry : compiled) {
+        if (entry.second->fused) ++count;
+    }
+    return count;
+}
+
+int TierManager::superblockCount() const {
+    return static_cast<int>(superblocks.size());
+}
+
+int TierManager::summarizedLoopCount() const {
+    int count = 0;
+    for (auto &entry : compiled) {
+        if (entry.second->summary) ++count;
+    }
+    return count;
+}
+
+void TierManager::invalidate() {
+    flushEdges();
+    superblocks.clear();
+    jitRegions.clear();
+    compiled.clear();
+    slotIndex.clear();
+    slotTable.clear();
+}
+
+void TierManager::observe(Statement *stmt, Program &program) {
+    if (threshold <= 0) return;
+    int line = stmt->getLineNumber();
+    // 只在计数恰好达到阈值时尝试一次，编译失败的语句留在解释层；剖析中的热行第一次执行后就升层
+    int limit = (profile && profile->isHot(line, threshold)) ? 1 : threshold;
+    if (stmt->getRunTime() != limit) return;
+    int toLine = line;
+    if (stmt->type == statementType::IF) toLine = static_cast<IFstatement*>(stmt)->toLine;
+    else if (stmt->type == statementType::GOTO) toLine = static_cast<GOTOstatement*>(stmt)->toLine;
+
+    if (toLine < line) promoteRegion(toLine, line, program); // 回跳：整个循环区域一起升层
+    else promote(line, program);
+}
+
+void TierManager::promote(int lineNumber, Program &program) {
+    auto it = program.statements.find(lineNumber);
+    if (it == program.statements.end() || lookup(lineNumber)) return;
+    if (compileStatement(lineNumber, it->second, program)) relink(program);
+}
+
+void TierManager::promoteRegion(int fromLine, int toLine, Program &program) {
+    bool changed = false;
+    for (auto it = program.statements.lower_bound(fromLine); it != program.statements.end() && it->first <= toLine; ++it) {
+        if (lookup(it->first)) continue;
+        if (compileStatement(it->first, it->second, program)) changed = true;
+    }
+    if (changed) relink(program);
+}
+
+int TierManager::resolveSlot(const std::string &name, Program &program) {
+    auto found = slotIndex.find(name);
+    if (found != slotIndex.end()) return found->second;
+    auto var = program.variables.find(name);
+    if (var == program.variables.end()) return -1;
+    int slot = static_cast<int>(slotTable.size());
+    slotTable.push_back(&var->second);
+    slotIndex[name] = slot;
+    return slot;
+}
+
+bool TierManager::compileStatement(int lineNumber, Statement *stmt, Program &program) {
+    // 本次运行中还没执行过的语句没有经过 parse，没有可用的表达式树
+    if (!stmt || stmt->getRunTime() <= 0) return false;
+
+    CompiledExpression::SlotResolver resolve = [this, &program](const std::string &name) {
+        return resolveSlot(name, program);
+    };
+
+    std::unique_ptr<OptimizedStatement> opt(new OptimizedStatement());
+    opt->type = stmt->type;
+    opt->lineNumber = lineNumber;
+    opt->target = -1;
+    opt->ifOperator = 0;
+    opt->toLine = noLine;
+    opt->jumpLine = noLine;
+    opt->nextLine = noLine;
+    opt->runTime = &stmt->runTime;
+    opt->trueTime = nullptr;
+    opt->falseTime = nullptr;
+    opt->next = nullptr;
+    opt->jump = nullptr;
+    opt->jit = nullptr;
+    opt->jitEntry = -1;
+    opt->jitRetry = 0;
+    opt->superblock = nullptr;
+
+    switch (stmt->type) {
+    case statementType::REM:
+        break;
+    case statementType::LET: {
+        LETstatement *let = static_cast<LETstatement*>(stmt);
+        const ExpressionEvaluator *rhs = let->RHS.getExpressionEvaluator();
+        if (!rhs) return false;
+        opt->target = resolveSlot(let->LHS, program);
+        if (opt->target < 0 || !opt->lhs.compile(rhs->getRoot(), resolve, lineNumber)) return false;
+        break;
+    }
+    case statementType::PRINT: {
+        PRINTstatement *print = static_cast<PRINTstatement*>(stmt);
+        const ExpressionEvaluator *expr = print->print.getExpressionEvaluator();
+        if (!expr || !opt->lhs.compile(expr->getRoot(), resolve, lineNumber)) return false;
+        break;
+    }
+    case statementType::IF: {
+        IFstatement *ifStmt = static_cast<IFstatement*>(stmt);
+        const ExpressionEvaluator *lhs = ifStmt->LHS.getExpressionEvaluator();
+        const ExpressionEvaluator *rhs = ifStmt->RHS.getExpressionEvaluator();
+        if (!lhs || !rhs) return false;
+        if (!opt->lhs.compile(lhs->getRoot(), resolve, lineNumber) || !opt->rhs.compile(rhs->getRoot(), resolve, lineNumber)) return false;
+        opt->ifOperator = ifStmt->ifOperator;
+        opt->toLine = ifStmt->toLine;
+        opt->trueTime = &ifStmt->trueTime;
+        opt->falseTime = &ifStmt->falseTime;
+        break;
+    }
+    case statementType::GOTO:
+        opt->toLine = static_cast<GOTOstatement*>(stmt)->toLine;
+        break;
+    case statementType::INPUT:
+        // 交互式输入需要暂停运行，留给解释器
+        if (!input) return false;
+        opt->target = resolveSlot(static_cast<INPUTstatement*>(stmt)->input, program);
+        if (opt->target < 0) return false;
+        break;
+    default:
+        // END 需要结束循环，留给解释器
+        return false;
+    }
+    // 此前的执行由解释器逐次记录了转移
+    opt->countedRuns = *opt->runTime;
+    opt->countedTrue = opt->trueTime ? *opt->trueTime : 0;
+    opt->countedFalse = opt->falseTime ? *opt->falseTime : 0;
+    opt->allocCounted = executions(opt.get());
+    compiled[lineNumber] = std::move(opt);
+    return true;
+}
+
+void TierManager::flushEdges() {
+    if (!recorder) return;
+    for (auto &entry : compiled) {
+        OptimizedStatement *opt = entry.second.get();
+        if (opt->type == statementType::IF) {
+            countEdges(opt->lineNumber, opt->jumpLine, *opt->trueTime, opt->countedTrue);
+            countEdges(opt->lineNumber, opt->nextLine, *opt->falseTime, opt->countedFalse);
+        }
+        else if (opt->type == statementType::GOTO) countEdges(opt->lineNumber, opt->jumpLine, *opt->runTime, opt->countedRuns);
+        else countEdges(opt->lineNumber, opt->nextLine, *opt->runTime, opt->countedRuns);
+    }
+}
+
+void TierManager::beginAllocationCount() {
+    for (auto &entry : compiled) entry.second->allocCounted = executions(entry.second.get());
+}
+
+void TierManager::endAllocationCount() {
+    for (auto &entry : compiled) {
+        OptimizedStatement *opt = entry.second.get();
+        int runs = executions(opt);
+        std::uint32_t times = static_cast<std::uint32_t>(runs) - static_cast<std::uint32_t>(opt->allocCounted);
+        opt->allocCounted = runs;
+        AllocationProfiler::addExecutions(opt->lineNumber, times);
+    }
+}
+
+// 运行统计是会回绕的 int，增量按 32 位无符号数计算
+void TierManager::countEdges(int fromLine, int toLine, int runs, int &counted) {
+    std::uint32_t times = static_cast<std::uint32_t>(runs) - static_cast<std::uint32_t>(counted);
+    counted = runs;
+    if (toLine != noLine) recorder->add(fromLine, toLine, times);
+}
+
+void TierManager::relink(Program &program) {
+    for (auto &entry : compiled) {
+        OptimizedStatement *opt = entry.second.get();
+        auto after = program.statements.upper_bound(opt->lineNumber);
+        opt->nextLine = (after == program.statements.end()) ? noLine : after->first;
+        opt->next = (opt->nextLine == noLine) ? nullptr : lookup(opt->nextLine);
+        if (opt->toLine == noLine) continue;
+        // 与解释器一致：跳转到本行时迭代器不会更新，效果等同于顺序执行
+        opt->jumpLine = (opt->toLine == opt->lineNumber) ? opt->nextLine : opt->toLine;
+        opt->jump = (opt->jumpLine == noLine) ? nullptr : lookup(opt->jumpLine);
+    }
+    // 链接完成后再识别计数循环，循环的每一行都已升层时才融合
+    std::map<int, CountingLoop> loops = LoopAnalysis::findCountingLoops(program.statements);
+    for (auto &entry : compiled) {
+        entry.second->fused.reset();
+        entry.second->summary.reset();
+    }
+    for (auto &entry : loops) {
+        OptimizedStatement *increment = lookup(entry.first);
+        if (increment) fuseLoop(increment, entry.second);
+        summarizeLoop(entry.second, program);
+    }
+    formSuperblocks();
+}
+
+bool TierManager::fitsSuperblock(const OptimizedStatement *opt) const {
+    // 融合、折叠的循环有自己的快速路径；INPUT 可能暂停，END 结束运行，都留给逐条执行。
+    // 跳到本行的 IF 两边后继相同，没有可以落下去的一边
+    if (!opt || opt->fused || opt->summary) return false;
+    switch (opt->type) {
+    case statementType::LET:
+    case statementType::PRINT:
+    case statementType::GOTO:
+    case statementType::REM:
+        return true;
+    case statementType::IF:
+        return opt->jumpLine != opt->nextLine;
+    default:
+        return false;
+    }
+}
+
+void TierManager::formSuperblocks() {
+    superblocks.clear();
+    for (auto &entry : compiled) entry.second->superblock = nullptr;
+    if (!profile) return;
+
+    // 种子：已升层且在剖析中是热行的语句，按执行次数从高到低
+    std::vector<std::pair<std::uint64_t, int>> seeds;
+    for (auto &entry : compiled) {
+        if (profile->isHot(entry.first, threshold)) seeds.push_back(std::make_pair(profile->lineCount(entry.first), entry.first));
+    }
+    std::sort(seeds.begin(), seeds.end(), [](const std::pair<std::uint64_t, int> &a, const std::pair<std::uint64_t, int> &b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+
+    std::set<const OptimizedStatement*> placed;
+    for (const auto &seed : seeds) {
+        OptimizedStatement *head = lookup(seed.second);
+        if (placed.count(head) || !fitsSuperblock(head)) continue;
+        std::unique_ptr<Superblock> block(new Superblock());
+        block->loops = false;
+        block->exit = nullptr;
+        block->exitLine = noLine;
+        OptimizedStatement *cur = head;
+        for (;;) {
+            SuperInstr in;
+            in.ifOperator = cur->ifOperator;
+            in.expectTaken = false;
+            in.target = cur->target;
+            in.lhs = &cur->lhs;
+            in.rhs = &cur->rhs;
+            in.counter = cur->runTime;
+            in.sideCounter = nullptr;
+            in.sideExit = nullptr;
+            in.sideExitLine = noLine;
+            in.opt = cur;
+            OptimizedStatement *likely = cur->next;
+            int likelyLine = cur->nextLine;
+            switch (cur->type) {
+            case statementType::LET: in.kind = SuperInstr::Let; break;
+            case statementType::PRINT: in.kind = SuperInstr::Print; break;
+            case statementType::GOTO:
+                in.kind = SuperInstr::Goto;
+                likely = cur->jump;
+                likelyLine = cur->jumpLine;
+                break;
+            case statementType::IF: {
+                std::uint64_t taken = profile->count(cur->lineNumber, cur->jumpLine);
+                std::uint64_t fallThrough = profile->count(cur->lineNumber, cur->nextLine);
+                in.kind = SuperInstr::Guard;
+                in.expectTaken = taken > fallThrough;
+                in.counter = in.expectTaken ? cur->trueTime : cur->falseTime;
+                in.sideCounter = in.expectTaken ? cur->falseTime : cur->trueTime;
+                in.sideExit = in.expectTaken ? cur->next : cur->jump;
+                in.sideExitLine = in.expectTaken ? cur->nextLine : cur->jumpLine;
+                if (in.expectTaken) {
+                    likely = cur->jump;
+                    likelyLine = cur->jumpLine;
+                }
+                break;
+            }
+            default: in.kind = SuperInstr::Rem; break;
+            }
+            in.backEdge = likelyLine != noLine && likelyLine < cur->lineNumber;
+            // 难以预测的 IF 不进块，块在它之前结束
+            if (in.kind == SuperInstr::Guard) {
+                std::uint64_t total = profile->lineCount(cur->lineNumber);
+                std::uint64_t likelyCount = profile->count(cur->lineNumber, likelyLine);
+                if (total == 0 || likelyCount < likelyRatio * total) {
+                    if (cur == head) break;
+                    block->exit = cur;
+                    block->exitLine = cur->lineNumber;
+                    break;
+                }
+            }
+            block->code.push_back(in);
+            placed.insert(cur);
+            if (likely == head) {
+                block->loops = true;
+                break;
+            }
+            if (!likely || placed.count(likely) || !fitsSuperblock(likely) || !profile->isHot(likelyLine, threshold)
+                    || block->code.size() >= maxSuperblockLength) {
+                block->exit = likely;
+                block->exitLine = likelyLine;
+                break;
+            }
+            cur = likely;
+        }
+        // 只有一条且不循环的块没有可省的分派
+        if (block->code.empty() || (block->code.size() == 1 && !block->loops)) continue;
+        head->superblock = block.get();
+        superblocks.push_back(std::move(block));
+    }
+}
+
+void TierManager::summarizeLoop(const CountingLoop &loop, Program &program) {
+    // 循环的每一行都已升层才做折叠，入口处折叠失败时仍按融合指令逐次执行
+    int firstLine = loop.topTest ? loop.testLine : loop.headLine;
+    int lastLine = loop.topTest ? loop.gotoLine : loop.testLine;
+    for (auto it = program.statements.lower_bound(firstLine); it != program.statements.end() && it->first <= lastLine; ++it) {
+        if (!lookup(it->first)) return;
+    }
+    CompiledExpression::SlotResolver resolve = [this, &program](const std::string &name) {
+        return resolveSlot(name, program);
+    };
+    std::unique_ptr<LoopSummary> summary = LoopSummary::build(loop, program.statements, resolve);
+    if (summary) lookup(firstLine)->summary = std::move(summary);
+}
+
+void TierManager::fuseLoop(OptimizedStatement *increment, const CountingLoop &loop) {
+    OptimizedStatement *test = lookup(loop.testLine);
+    OptimizedStatement *gotoStmt = loop.topTest ? lookup(loop.gotoLine) : nullptr;
+    if (!test || (loop.topTest && !gotoStmt)) return;
+    if (loop.topTest ? (increment->next != gotoStmt || gotoStmt->jump != test) : increment->next != test) return;
+    const CompiledExpression &var = loop.variableOnLeft ? test->lhs : test->rhs;
+    if (!var.isSingleLoad() || var.instructions()[0].operand != increment->target) return;
+
+    std::unique_ptr<FusedLoop> fused(new FusedLoop());
+    fused->slot = increment->target;
+    fused->step = loop.step;
+    fused->variableOnLeft = loop.variableOnLeft;
+    fused->bound = loop.variableOnLeft ? &test->rhs : &test->lhs;
+    fused->boundIsConstant = fused->bound->isConstant();
+    fused->boundValue = fused->boundIsConstant ? fused->bound->constantValue() : 0;
+    fused->gotoStmt = gotoStmt;
+    fused->test = test;
+    increment->fused = std::move(fused);
+}
+
+// 回跳次数达到阈值后编译 branch 所闭合的循环区域；计数可能一开始就超过阈值
+// （阈值中途调低，或由融合、折叠的路径计过数），所以按 >= 判断。
+// 区域还不能编译（例如有的行尚未升层）时，回跳次数再翻一倍才重试
+void TierManager::considerJit(OptimizedStatement *branch, int count, Program &program) {
+    if (branch->jit || jitThreshold <= 0 || count < jitThreshold || count < branch->jitRetry) return;
+    compileJitRegion(branch->jumpLine, branch->lineNumber, program);
+    if (!branch->jit) branch->jitRetry = count > INT_MAX / 2 ? INT_MAX : count * 2;
+}
+
+void TierManager::compileJitRegion(int fromLine, int toLine, Program &program) {
+    // 区域内每一行都必须已经在优化层中
+    std::vector<OptimizedStatement*> region;
+    for (auto it = program.statements.lower_bound(fromLine); it != program.statements.end() && it->first <= toLine; ++it) {
+        OptimizedStatement *opt = lookup(it->first);
+        if (!opt || opt->jit) return;
+        region.push_back(opt);
+    }
+    JitRegion *jit = JitRegion::compile(region, slotTable, interrupt);
+    if (!jit) return;
+    jitRegions.push_back(std::unique_ptr<JitRegion>(jit));
+    for (OptimizedStatement *opt : region) {
+        opt->jit = jit;
+        opt->jitEntry = jit->entryOf(opt);
+    }
+}
+
+// 在优化层执行一条普通语句，返回后继（为空表示回到解释器），后继行号写入 succLine
+OptimizedStatement* TierManager::step(OptimizedStatement *cur, Program &program, int &succLine) {
+    VariableInfo* const* s = slotTable.data();
+    OptimizedStatement *succ = cur->next;
+    succLine = cur->nextLine;
+    QBASIC_ALLOC_LINE(cur->lineNumber);
+    switch (cur->type) {
+    case statementType::LET:
+        s[cur->target]->value = cur->lhs.evaluate(s, 1);
+        ++*cur->runTime;
+        break;
+    case statementType::PRINT: {
+        int value = cur->lhs.evaluate(s, 1);
+        ++*cur->runTime;
+        program.output += std::to_string(value) + '\n';
+        break;
+    }
+    case statementType::IF: {
+        // 解释器对 IF 两边各求值两次（一次用于日志输出），使用次数按 2 累加
+        int l = cur->lhs.evaluate(s, 2);
+        int r = cur->rhs.evaluate(s, 2);
+        if (ifTaken(cur->ifOperator, l, r)) {
+            ++*cur->trueTime;
+            succ = cur->jump;
+            succLine = cur->jumpLine;
+            if (succLine < cur->lineNumber) considerJit(cur, *cur->trueTime, program);
+        }
+        else ++*cur->falseTime;
+        break;
+    }
+    case statementType::INPUT: {
+        int value;
+        InputProvider::Status status = input->next(value);
+        if (status == InputProvider::Pending) {
+            // 暂时没有值：不执行本行，由 runSlice 在本行暂停
+            program.currentLine = cur->lineNumber;
+            succLine = needsInput;
+            return nullptr;
+        }
+        if (status != InputProvider::Value) InputProvider::fail(status, cur->lineNumber);
+        s[cur->target]->value = value;
+        ++*cur->runTime;
+        break;
+    }
+    case statementType::GOTO:
+        ++*cur->runTime;
+        succ = cur->jump;
+        succLine = cur->jumpLine;
+        if (succLine < cur->lineNumber) considerJit(cur, *cur->runTime, program);
+        break;
+    default:
+        ++*cur->runTime;
+        break;
+    }
+    return succ;
+}
+
+// 从块首开始按排好的顺序执行超级块，运算和运行统计与逐条 step 相同。返回离开时的后继
+// （为空表示回到解释器，行号写入 succLine）；时间片用完、回跳处有中断请求或新编译出的
+// 机器码时返回还没有执行的那一条
+OptimizedStatement* TierManager::runSuperblock(const Superblock &block, Program &program, long long &budget, int &succLine) {
+    VariableInfo* const* s = slotTable.data();
+    const SuperInstr *code = block.code.data();
+    const std::size_t size = block.code.size();
+    std::size_t i = 0;
+    for (;;) {
+        const SuperInstr &in = code[i];
+        if (budget <= 0) {
+            succLine = in.opt->lineNumber;
+            return in.opt;
+        }
+        QBASIC_ALLOC_LINE(in.opt->lineNumber);
+        switch (in.kind) {
+        case SuperInstr::Let:
+            s[in.target]->value = in.lhs->evaluate(s, 1);
+            break;
+        case SuperInstr::Print: {
+            int value = in.lhs->evaluate(s, 1);
+            program.output += std::to_string(value) + '\n';
+            break;
+        }
+        case SuperInstr::Guard: {
+            int l = in.lhs->evaluate(s, 2);
+            int r = in.rhs->evaluate(s, 2);
+            if (ifTaken(in.ifOperator, l, r) != in.expectTaken) {
+                // 侧出口：不常走的一边
+                ++*in.sideCounter;
+                --budget;
+                succLine = in.sideExitLine;
+                if (!in.expectTaken && succLine < in.opt->lineNumber) considerJit(in.opt, *in.sideCounter, program);
+                return in.sideExit;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        ++*in.counter;
+        --budget;
+        if (++i == size) {
+            if (!block.loops) {
+                succLine = block.exitLine;
+                return block.exit;
+            }
+            i = 0;
+        }
+        if (in.backEdge) {
+            considerJit(in.opt, *in.counter, program);
+            if (code[i].opt->jit || interrupted()) {
+                succLine = code[i].opt->lineNumber;
+                return code[i].opt;
+            }
+        }
+    }
+}
+
+int TierManager::run(OptimizedStatement *entry, Program &program, long long &budget) {
+    VariableInfo* const* s = slotTable.data();
+    OptimizedStatement *cur = entry;
+    bool leftJit = false;
+    for (;;) {
+        // 停止或快照请求：在这条语句之前回到解释器的安全点
+        if (!leftJit && interrupted()) {
+            program.currentLine = cur->lineNumber;
+            return cur->lineNumber;
+        }
+        // 时间片用完：同样在这条语句之前回到解释器
+        if (budget <= 0) {
+            program.currentLine = cur->lineNumber;
+            return cur->lineNumber;
+        }
+        // 在循环入口一次性算出整个循环的结果
+        std::uint64_t summarized;
+        if (cur->summary && cur->summary->run(s, summarized)) {
+            budget -= static_cast<long long>(std::min<std::uint64_t>(summarized, LLONG_MAX / 2));
+            int exitLine = cur->summary->exitLine();
+            OptimizedStatement *exit = (exitLine == noLine) ? nullptr : lookup(exitLine);
+            if (!exit) {
+                if (exitLine != noLine) program.currentLine = exitLine;
+                return exitLine;
+            }
+            cur = exit;
+            leftJit = false;
+            continue;
+        }
+        // 进入机器码；从机器码退出的那一行（PRINT、除零等）必须先在本层执行一次
+        if (cur->jit && !leftJit) {
+            long long executed;
+            JitExit exit = cur->jit->run(cur->jitEntry, budget, executed);
+            budget -= executed;
+            if (!exit.opt) {
+                if (exit.line != noLine) program.currentLine = exit.line;
+                return exit.line;
+            }
+            cur = exit.opt;
+            leftJit = true;
+            continue;
+        }
+        leftJit = false;
+        // 融合的一次迭代是自增、（GOTO、）IF 两到三条语句，剩余不够时逐条执行
+        if (cur->fused && budget >= (cur->fused->gotoStmt ? 3 : 2)) {
+            FusedLoop &loop = *cur->fused;
+            budget -= loop.gotoStmt ? 3 : 2;
+            OptimizedStatement *test = loop.test;
+            VariableInfo *var = s[loop.slot];
+            // LET i = i + c：右边读一次 i
+            var->value = exprAdd(var->value, loop.step);
+            ++var->usageCount;
+            ++*cur->runTime;
+            if (loop.gotoStmt) {
+                ++*loop.gotoStmt->runTime;
+                considerJit(loop.gotoStmt, *loop.gotoStmt->runTime, program);
+            }
+            // IF 两边按原顺序求值，各按 2 次计入使用次数
+            int l, r;
+            if (loop.variableOnLeft) {
+                var->usageCount += 2;
+                l = var->value;
+                r = loop.boundIsConstant ? loop.boundValue : loop.bound->evaluate(s, 2);
+            }
+            else {
+                l = loop.boundIsConstant ? loop.boundValue : loop.bound->evaluate(s, 2);
+                var->usageCount += 2;
+                r = var->value;
+            }
+            OptimizedStatement *succ;
+            int succLine;
+            if (ifTaken(test->ifOperator, l, r)) {
+                ++*test->trueTime;
+                succ = test->jump;
+                succLine = test->jumpLine;
+                if (succLine < test->lineNumber) considerJit(test, *test->trueTime, program);
+            }
+            else {
+                ++*test->falseTime;
+                succ = test->next;
+                succLine = test->nextLine;
+            }
+            if (!succ) {
+                if (succLine != noLine) program.currentLine = succLine;
+                return succLine;
+            }
+            cur = succ;
+            continue;
+        }
+        int succLine;
+        if (cur->superblock) {
+            OptimizedStatement *succ = runSuperblock(*cur->superblock, program, budget, succLine);
+            if (!succ) {
+                if (succLine != noLine) program.currentLine = succLine;
+                return succLine;
+            }
+            cur = succ;
+            continue;
+        }
+        OptimizedStatement *succ = step(cur, program, succLine);
+        if (succLine != needsInput) --budget;
+        if (!succ) {
+            if (succLine != noLine && succLine != needsInput) program.currentLine = succLine;
+            return succLine;
+        }
+        cur = succ;
+    }
+}
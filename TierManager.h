@@ -0,0 +1,195 @@
+#pragma once
+#ifndef TIERMANAGER_H
+#define TIERMANAGER_H
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Typedef.h"
+#include "CompiledExpression.h"
+#include "JitCompiler.h"
+#include "LoopAnalysis.h"
+#include "LoopSummary.h"
+#include "PgoProfile.h"
+#include "EdgeProfiler.h"
+#include "InputProvider.h"
+
+class Program;
+class Statement;
+struct OptimizedStatement;
+struct Superblock;
+
+// 计数循环的融合超级指令，挂在自增的 LET 上：
+// 自增、（顶部测试形式的 GOTO、）比较、分支一次完成，运行统计与逐条执行相同
+struct FusedLoop {
+    int slot;                       // 归纳变量的槽位
+    int step;
+    bool variableOnLeft;
+    bool boundIsConstant;           // 常量边界不必每次迭代重新求值
+    int boundValue;
+    const CompiledExpression *bound; // IF 中另一边的表达式
+    OptimizedStatement *gotoStmt;   // 顶部测试形式中的 GOTO，底部测试形式为空
+    OptimizedStatement *test;
+};
+
+// 优化层中的一条语句：表达式已编译，变量已解析成槽位，跳转目标已链接
+struct OptimizedStatement {
+    statementType type;
+    int lineNumber;
+    int target;               // LET 左值 / INPUT 变量的槽位
+    CompiledExpression lhs;   // LET 右值 / IF 左边 / PRINT 表达式
+    CompiledExpression rhs;   // IF 右边
+    char ifOperator;
+    int toLine;               // IF/GOTO 跳转目标
+    int jumpLine;             // 实际跳转到的行（跳转到本行时等同于顺序执行）
+    int nextLine;             // 顺序执行的下一行，没有则为 TierManager::noLine
+    int *runTime;             // 直接更新原语句的运行统计
+    int *trueTime;
+    int *falseTime;
+    OptimizedStatement *next; // 预链接的后继，为空表示回到解释器
+    OptimizedStatement *jump;
+    JitRegion *jit;           // 所在的 JIT 区域，为空表示只在优化层执行
+    int jitEntry;
+    int jitRetry;             // 闭合循环的分支上：编译失败后，回跳次数达到这里再重试
+    int countedRuns;          // 已经折算进转移剖析的运行统计（见 TierManager::flushEdges）
+    int countedTrue;
+    int countedFalse;
+    int allocCounted;         // 分配统计已经计入的执行次数（见 TierManager::endAllocationCount）
+    std::unique_ptr<FusedLoop> fused; // 计数循环的自增语句上才有
+    std::unique_ptr<LoopSummary> summary; // 可折叠成闭式计算的循环入口上才有
+    Superblock *superblock;   // 作为超级块块首时指向该超级块
+};
+
+// 超级块中的一条指令：语句按剖析中的最热路径连续排列，执行时不经过 next / jump 链接。
+// IF 变成只判断常走方向的守卫，常走的一边顺序落到下一条，另一边从侧出口离开；
+// 路径上的 GOTO 只剩计数
+struct SuperInstr {
+    enum Kind { Let, Print, Guard, Goto, Rem };
+    Kind kind;
+    char ifOperator;
+    bool expectTaken;               // 守卫：剖析中 IF 多数成立
+    bool backEdge;                  // 常走的一边向回转移，执行后检查 JIT 和中断
+    int target;
+    const CompiledExpression *lhs;
+    const CompiledExpression *rhs;
+    int *counter;                   // 顺序执行时加一的运行统计（守卫为常走一边的真 / 假次数）
+    int *sideCounter;               // 守卫从侧出口离开时加一的运行统计
+    OptimizedStatement *sideExit;   // 守卫的另一边，为空表示回到解释器（sideExitLine 为行号）
+    int sideExitLine;
+    OptimizedStatement *opt;        // 原语句，时间片用完时从它继续
+};
+
+// 从剖析中的一个热行出发，沿每行最可能的后继排成的一串指令。最后一条的常走后继是块首时
+// 回到第一条继续，否则执行完后转到 exit
+struct Superblock {
+    std::vector<SuperInstr> code;
+    bool loops;
+    OptimizedStatement *exit;
+    int exitLine;
+};
+
+// TierManager 在 Program::exec 之上做分层执行：
+// 冷代码由解释器执行，语句（或以回跳为边界的循环区域）执行次数达到阈值后
+// 被编译成 OptimizedStatement，并在下一个语句边界切换过去。
+// 任何编辑、CLEAR 或重新 RUN 都会丢弃优化代码，回到解释层。
+class TierManager {
+public:
+    static const int noLine;
+    static const int needsInput;
+    static const int defaultThreshold = 64;
+    static const int defaultJitThreshold = 1024;
+
+    TierManager();
+
+    void setThreshold(int threshold);   // <= 0 关闭分层
+    int getThreshold() const;
+    bool isEnabled() const;
+    // 回跳执行次数达到该值时把循环区域编译成机器码，<= 0 关闭 JIT
+    void setJitThreshold(int threshold);
+    // 使用上次运行的转移剖析：剖析中的热行第一次执行后就升层，并沿最热路径组成超级块
+    void setProfile(const PgoProfile *profile);
+    // 转移剖析：优化层的各条快速路径（融合、折叠、JIT）照常执行，不逐次记录转移。
+    // 升层后的语句后继固定，它的转移次数就是运行统计的增量，由 flushEdges 折算后记入 recorder
+    void setRecorder(EdgeProfiler *recorder);
+    // 把升层以来各行运行统计的增量记为转移；运行结束、出错、取报告和丢弃优化代码之前调用
+    void flushEdges();
+    // 标志非零时在下一条语句之前回到解释器（JIT 代码在回跳处检查），为空则不检查
+    void setInterrupt(const std::atomic<int> *interrupt);
+    // 非交互式的 INPUT 来源：设置后 INPUT 也可以升层，为空时 INPUT 留在解释器
+    void setInputProvider(InputProvider *input);
+
+    // 解释器每执行完一条语句调用一次，检查是否需要升层
+    void observe(Statement *stmt, Program &program);
+
+    bool hasCompiledCode() const;
+    OptimizedStatement* lookup(int lineNumber) const;
+
+    // 从 entry 开始在优化层执行，返回需要回到解释器继续执行的行号；
+    // 程序顺序执行到末尾时返回 noLine；INPUT 暂时没有值时返回 needsInput，
+    // program.currentLine 是这条 INPUT 的行号，取到值之前不会执行它。
+    // budget 为剩余的语句数，按实际执行的语句扣减（折叠的循环一次扣除整个循环，
+    // JIT 代码退出时按计数器扣除），用完时在下一条语句之前返回；只有折叠的循环可能扣成负数
+    int run(OptimizedStatement *entry, Program &program, long long &budget);
+
+    // 分配统计（QBASIC_ALLOC_PROFILE）：begin 记下各行当前的执行次数，end 把之后的增量
+    // 作为优化层执行的语句计入 AllocationProfiler 的总数和每行的执行次数
+    void beginAllocationCount();
+    void endAllocationCount();
+
+    // 丢弃所有优化代码（编辑、CLEAR、preRun 时调用）
+    void invalidate();
+
+    int compiledCount() const;
+    int jitRegionCount() const;
+    int fusedLoopCount() const;
+    int summarizedLoopCount() const;
+    int superblockCount() const;
+
+private:
+    int threshold;
+    int jitThreshold;
+    std::map<int, std::unique_ptr<OptimizedStatement>> compiled;
+    std::vector<std::unique_ptr<JitRegion>> jitRegions;
+    std::map<std::string, int> slotIndex;
+    std::vector<VariableInfo*> slotTable;
+    const PgoProfile *profile;
+    EdgeProfiler *recorder;
+    const std::atomic<int> *interrupt;
+    InputProvider *input;
+    std::vector<std::unique_ptr<Superblock>> superblocks;
+
+    void promote(int lineNumber, Program &program);
+    void promoteRegion(int fromLine, int toLine, Program &program);
+    bool compileStatement(int lineNumber, Statement *stmt, Program &program);
+    int resolveSlot(const std::string &name, Program &program);
+    void relink(Program &program);
+    void fuseLoop(OptimizedStatement *increment, const CountingLoop &loop);
+    void summarizeLoop(const CountingLoop &loop, Program &program);
+    void formSuperblocks();
+    bool fitsSuperblock(const OptimizedStatement *opt) const;
+    OptimizedStatement* runSuperblock(const Superblock &block, Program &program, long long &budget, int &succLine);
+    OptimizedStatement* step(OptimizedStatement *cur, Program &program, int &succLine);
+    void countEdges(int fromLine, int toLine, int runs, int &counted);
+    void considerJit(OptimizedStatement *branch, int count, Program &program);
+    void compileJitRegion(int fromLine, int toLine, Program &program);
+    bool interrupted() const {
+        return interrupt && interrupt->load(std::memory_order_relaxed) != 0;
+    }
+};
+
+#ifdef QBASIC_ALLOC_PROFILE
+// 作用域内优化层执行的语句计入分配统计，出错离开时也计入
+class TierAllocationCount {
+public:
+    explicit TierAllocationCount(TierManager &tier) : tier(tier) { tier.beginAllocationCount(); }
+    ~TierAllocationCount() { tier.endAllocationCount(); }
+    TierAllocationCount(const TierAllocationCount&) = delete;
+    TierAllocationCount& operator=(const TierAllocationCount&) = delete;
+
+private:
+    TierManager &tier;
+};
+#endif
+
+#endif // TIERMANAGER_H
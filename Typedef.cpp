@@ -1,4 +1,9 @@
 #include "Typedef.h"
+#include <cstdlib>
+#include <sys/stat.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 const std::string retract = "    ";
 
@@ -9,6 +14,8 @@ const std::string HELP =
     "\n"
     "    - LOAD: Loads a program from a file. A dialog will prompt you to select the file. Once loaded, the program's statements and commands are executed as if they were inputted directly.\n"
     "\n"
+    "    - STOP: Stops a running program before its next statement. The program runs on a worker thread, so the window stays responsive and output and run statistics update while it runs.\n"
+    "\n"
     "    - CLEAR: Clears the current program from memory, allowing you to start writing a new program.\n"
     "\n"
     "    - HELP: Displays this help message, providing information about the commands available in this BASIC interpreter.\n"
@@ -16,3 +23,86 @@ const std::string HELP =
     "    - QUIT: Exits the BASIC interpreter. Type QUIT to terminate the session.\n"
     "\n"
     "    Note: The LIST command has been deprecated. All entered code is displayed in real time, eliminating the need for a separate list command.\n";
+
+std::uint64_t contentHash(const std::string &content) {
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char ch : content) {
+        hash ^= ch;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+std::string contentHashHex(const std::string &content) {
+    static const char digits[] = "0123456789abcdef";
+    std::uint64_t hash = contentHash(content);
+    std::string hex(16, '0');
+    for (int i = 15; i >= 0; --i) {
+        hex[i] = digits[hash & 0xF];
+        hash >>= 4;
+    }
+    return hex;
+}
+
+std::string jsonString(const std::string &text) {
+    static const char digits[] = "0123456789abcdef";
+    std::string quoted = "\"";
+    for (char ch : text) {
+        unsigned char byte = static_cast<unsigned char>(ch);
+        if (ch == '"' || ch == '\\') quoted += std::string("\\") + ch;
+        else if (ch == '\n') quoted += "\\n";
+        else if (ch == '\t') quoted += "\\t";
+        else if (ch == '\r') quoted += "\\r";
+        else if (byte < 0x20) quoted += std::string("\\u00") + digits[byte >> 4] + digits[byte & 0xF];
+        else quoted += ch;
+    }
+    return quoted + "\"";
+}
+
+std::string cacheDirectory(const std::string &name) {
+    const char *xdg = std::getenv("XDG_CACHE_HOME");
+    if (xdg && *xdg) return std::string(xdg) + "/" + name;
+    const char *home = std::getenv("HOME");
+    if (home && *home) return std::string(home) + "/.cache/" + name;
+    return "/tmp/" + name;
+}
+
+void makeDirectories(const std::string &path) {
+    for (std::size_t pos = 1; pos <= path.size(); ++pos) {
+        if (pos == path.size() || path[pos] == '/') {
+            mkdir(path.substr(0, pos).c_str(), 0755);
+        }
+    }
+}
+
+bool parseInteger(const char *text, std::size_t length, int &value) {
+    const char *p = text;
+    const char *end = text + length;
+    while (p < end && (*p == ' ' || (*p >= '\t' && *p <= '\r'))) ++p;
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-')) negative = *p++ == '-';
+    if (p == end || *p < '0' || *p > '9') return false;
+    // 用 long long 累加绝对值，一超出 int 范围就返回
+    const long long limit = negative ? 2147483648LL : 2147483647LL;
+    long long magnitude = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+        magnitude = magnitude * 10 + (*p - '0');
+        if (magnitude > limit) return false;
+    }
+    value = static_cast<int>(negative ? -magnitude : magnitude);
+    return true;
+}
+
+const char* findByte(const char *begin, const char *end, char byte) {
+#if defined(__SSE2__)
+    const __m128i needle = _mm_set1_epi8(byte);
+    while (end - begin >= 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+        if (mask) return begin + __builtin_ctz(mask);
+        begin += 16;
+    }
+#endif
+    while (begin < end && *begin != byte) ++begin;
+    return begin;
+}
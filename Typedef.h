@@ -2,6 +2,8 @@
 #ifndef TYPEDEF_H
 #define TYPEDEF_H
 #include <iostream>
+#include <cstdint>
+#include <string>
 
 struct VariableInfo {
     int value;      // 变量的值
@@ -29,6 +31,25 @@ extern const std::string retract;
 
 extern const std::string HELP;
 
+// 程序文本的 64 位 FNV-1a 哈希，用作各类缓存的键
+std::uint64_t contentHash(const std::string &content);
+std::string contentHashHex(const std::string &content);
+
+// 加上引号并转义的 JSON 字符串
+std::string jsonString(const std::string &text);
+
+// 缓存目录：$XDG_CACHE_HOME/<name>，否则 ~/.cache/<name>，再否则 /tmp/<name>
+std::string cacheDirectory(const std::string &name);
+// 逐级创建目录，已存在时忽略
+void makeDirectories(const std::string &path);
+
+// 不抛异常的整数解析，接受规则与 std::stoi 相同：跳过前导空白，可选正负号，
+// 至少一位数字，其后的内容忽略。不是整数或超出 int 范围时返回 false
+bool parseInteger(const char *text, std::size_t length, int &value);
+
+// [begin, end) 中第一个等于 byte 的字符的位置，没有时返回 end；有 SSE2 时每次比较 16 字节
+const char* findByte(const char *begin, const char *end, char byte);
+
 
 
 #endif // TYPEDEF_H
@@ -0,0 +1,169 @@
+#include "ValidationWorker.h"
+#include "Exception.h"
+#include "Program.h"
+#include "Statement.h"
+#include <exception>
+
+ValidationWorker::ValidationWorker(const Program &program)
+    : program(program), stopping(false), revision(0), resetRevision(0), backlogNext(0) {
+    thread = std::thread(&ValidationWorker::run, this);
+}
+
+ValidationWorker::~ValidationWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    thread.join();
+}
+
+void ValidationWorker::lineInserted(int lineNumber) {
+    edited(lineNumber);
+    recheckSources(lineNumber);
+}
+
+void ValidationWorker::lineReplaced(int lineNumber) {
+    edited(lineNumber);
+}
+
+void ValidationWorker::lineRemoved(int lineNumber) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++revision;
+        lines.erase(lineNumber);
+        edits.erase(lineNumber);
+        latest[lineNumber] = revision; // 这一行此前的诊断全部作废
+    }
+    recheckSources(lineNumber);
+}
+
+void ValidationWorker::listingReset() {
+    // 在界面线程上复制整个程序，后台线程之后只用这份快照
+    std::vector<std::pair<int, std::string>> snapshot;
+    std::map<int, Statement*> table;
+    for (int lineNumber : program.lineNumbers()) {
+        snapshot.emplace_back(lineNumber, statementText(lineNumber));
+        table.emplace_hint(table.end(), lineNumber, nullptr);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++revision;
+        resetRevision = revision;
+        lines.swap(table);
+        edits.clear();
+        latest.clear();
+        backlog.swap(snapshot);
+        backlogNext = 0;
+        diagnostics.clear();
+    }
+    wake.notify_one();
+}
+
+bool ValidationWorker::pollDiagnostic(Diagnostic &diagnostic) {
+    std::lock_guard<std::mutex> lock(mutex);
+    while (!diagnostics.empty()) {
+        diagnostic = diagnostics.front();
+        diagnostics.pop_front();
+        if (current(diagnostic.lineNumber, diagnostic.revision)) return true;
+    }
+    return false;
+}
+
+bool ValidationWorker::isBusy() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return !edits.empty() || backlogNext < backlog.size();
+}
+
+std::string ValidationWorker::statementText(int lineNumber) const {
+    std::string text = program.lineText(lineNumber);
+    text.erase(0, text.find(' ') + 1); // lineText 为“行号 语句”
+    return text;
+}
+
+void ValidationWorker::edited(int lineNumber) {
+    std::string text = statementText(lineNumber);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++revision;
+        lines[lineNumber] = nullptr;
+        edits[lineNumber] = std::make_pair(revision, std::move(text));
+        latest[lineNumber] = revision;
+    }
+    wake.notify_one();
+}
+
+void ValidationWorker::recheckSources(int lineNumber) {
+    // 目标行出现或消失只影响转移到它的行，由 Program 的反向转移索引给出，与程序大小无关
+    for (int source : program.jumpSources(lineNumber)) {
+        if (source != lineNumber) edited(source);
+    }
+}
+
+bool ValidationWorker::current(int lineNumber, long long lineRevision) const {
+    if (lineRevision < resetRevision) return false;
+    auto it = latest.find(lineNumber);
+    return it == latest.end() || it->second == lineRevision;
+}
+
+void ValidationWorker::run() {
+    // 解析用的临时程序：语句在这里构造、解析后立即删除，目标行在 lines 中检查
+    Program scratch;
+    scratch.lineTable = &lines;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [this] { return stopping || !edits.empty() || backlogNext < backlog.size(); });
+        if (stopping) return;
+
+        int lineNumber;
+        long long lineRevision;
+        std::string text;
+        bool fromBacklog = edits.empty();
+        if (!fromBacklog) {
+            auto next = edits.begin();
+            lineNumber = next->first;
+            lineRevision = next->second.first;
+            text.swap(next->second.second);
+            edits.erase(next);
+        }
+        else {
+            lineNumber = backlog[backlogNext].first;
+            text.swap(backlog[backlogNext].second);
+            lineRevision = resetRevision;
+            if (++backlogNext == backlog.size()) {
+                backlog.clear();
+                backlogNext = 0;
+            }
+            // 重置之后又编辑过的行由那次编辑检查
+            if (!current(lineNumber, lineRevision)) continue;
+        }
+
+        // 解析时持有锁，行号表在解析期间不会变；一行只需几微秒，界面线程的通知最多等这么久
+        std::string message;
+        try {
+            scratch.saveLine(lineNumber, text);
+            auto it = scratch.statements.find(lineNumber);
+            if (it != scratch.statements.end()) it->second->parse(scratch);
+        }
+        catch (const ParseException &e) {
+            message = e.what();
+        }
+        catch (const std::exception &) {
+            // 表达式中的数字不合法时 std::stoi 抛出的异常，按解析错误报告
+            message = ParseException(ParseErrorType::InvalidExpressionError, "invalid number", lineNumber).what();
+        }
+        auto it = scratch.statements.find(lineNumber);
+        if (it != scratch.statements.end()) {
+            delete it->second;
+            scratch.statements.erase(it);
+        }
+        scratch.variables.clear();
+
+        // 重置时所有诊断都已清除，整个程序检查时只需要报告有错的行
+        if (fromBacklog && message.empty()) continue;
+        if (current(lineNumber, lineRevision)) {
+            Diagnostic diagnostic = {lineNumber, lineRevision, message};
+            diagnostics.push_back(diagnostic);
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+#ifndef VALIDATIONWORKER_H
+#define VALIDATIONWORKER_H
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ListingObserver.h"
+
+class Program;
+class Statement;
+
+// ValidationWorker 在后台线程上解析编辑过的行，检查语法和 IF / GOTO 的目标行，
+// 界面线程定时用 pollDiagnostic 取回每行的诊断，输入时不必等待解析。
+// 作为 Program 的 ListingObserver 接收编辑：通知在界面线程上发出，这时读出该行的文本，
+// 连同行号表的变化一起交给后台线程；后台线程只用这份快照，从不访问 Program。
+// 新增或删除一行时，转移到这一行的 IF / GOTO 也重新检查，悬空的转移随即报告。
+// LOAD 之后整个程序都在后台检查一遍（只报告有错的行），单独编辑的行优先处理。
+// 同一行在检查之前又被编辑时只检查最新的内容，已经过时的诊断不会交给界面线程
+class ValidationWorker : public ListingObserver {
+public:
+    struct Diagnostic {
+        int lineNumber;
+        long long revision;   // 产生这条诊断的编辑的序号
+        std::string message;  // 为空表示这一行没有错误
+    };
+
+    explicit ValidationWorker(const Program &program);
+    ~ValidationWorker();
+
+    void lineInserted(int lineNumber) override;
+    void lineReplaced(int lineNumber) override;
+    void lineRemoved(int lineNumber) override;
+    void listingReset() override;
+
+    // 界面线程：取出一条仍然有效的诊断，没有时返回 false
+    bool pollDiagnostic(Diagnostic &diagnostic);
+    // 还有没检查完的行
+    bool isBusy() const;
+
+private:
+    const Program &program;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping;
+    std::thread thread;
+
+    // 以下由 mutex 保护
+    long long revision;                         // 每次编辑或重置加一
+    long long resetRevision;                    // 最近一次重置的序号，更早的诊断全部作废
+    std::map<int, Statement*> lines;            // 当前的行号表，供解析时检查目标行；值不使用，都为空
+    std::map<int, std::pair<long long, std::string>> edits;  // 等待检查的编辑：行号 -> (序号, 文本)
+    std::unordered_map<int, long long> latest;  // 重置之后编辑过的行的最新序号
+    std::vector<std::pair<int, std::string>> backlog;        // 重置时整个程序的快照，逐行检查
+    std::size_t backlogNext;
+    std::deque<Diagnostic> diagnostics;
+
+    // 界面线程：lineNumber 这一行的语句文本（不含行号）
+    std::string statementText(int lineNumber) const;
+    void edited(int lineNumber);
+    // 界面线程：lineNumber 这一行新增或删除之后，重新检查转移到它的行
+    void recheckSources(int lineNumber);
+    bool current(int lineNumber, long long lineRevision) const;
+    void run();
+};
+
+#endif // VALIDATIONWORKER_H
@@ -0,0 +1,80 @@
+#include "WorkStealingPool.h"
+
+WorkStealingPool::WorkStealingPool(int threads) : nextQueue(0), queued(0), pending(0), stopping(false) {
+    if (threads <= 0) threads = static_cast<int>(std::thread::hardware_concurrency());
+    if (threads <= 0) threads = 1;
+    for (int i = 0; i < threads; ++i) queues.emplace_back(new Queue());
+    for (int i = 0; i < threads; ++i) workers.emplace_back(&WorkStealingPool::work, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers) worker.join();
+}
+
+int WorkStealingPool::size() const {
+    return static_cast<int>(workers.size());
+}
+
+void WorkStealingPool::submit(Task task) {
+    pending.fetch_add(1);
+    Queue &queue = *queues[nextQueue.fetch_add(1) % queues.size()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        // 在 mutex 下增加计数，等待中的线程不会错过唤醒
+        std::lock_guard<std::mutex> lock(mutex);
+        queued.fetch_add(1);
+    }
+    wake.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return pending.load() == 0; });
+}
+
+bool WorkStealingPool::take(int worker, Task &task) {
+    std::size_t count = queues.size();
+    for (std::size_t i = 0; i < count; ++i) {
+        Queue &queue = *queues[(worker + i) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) continue;
+        // 自己的队列从尾部取（刚放进去的任务），别人的从头部偷
+        if (i == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        queued.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::work(int worker) {
+    Task task;
+    for (;;) {
+        if (take(worker, task)) {
+            task(worker);
+            task = nullptr;
+            if (pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(mutex);
+                idle.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) return;
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// WorkStealingPool 是固定大小的线程池，每个线程有自己的任务队列：
+// 线程从自己队列的尾部取任务，自己的队列空了再从其它线程队列的头部偷任务，
+// 耗时差别很大的任务（例如长短不一的 BASIC 程序）也能让所有线程一直有活干。
+class WorkStealingPool {
+public:
+    // 任务的参数是执行它的线程编号（0 .. size()-1），可用于按线程分配的资源
+    typedef std::function<void(int worker)> Task;
+
+    // threads <= 0 时使用 std::thread::hardware_concurrency()
+    explicit WorkStealingPool(int threads = 0);
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    int size() const;
+    // 依次放进各线程的队列
+    void submit(Task task);
+    // 等待已提交的任务全部完成
+    void wait();
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<std::size_t> nextQueue;
+    std::atomic<long> queued;     // 还在队列中的任务
+    std::atomic<long> pending;    // 已提交但还没执行完的任务
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    bool stopping;
+
+    bool take(int worker, Task &task);
+    void work(int worker);
+};
+
+#endif // WORKSTEALINGPOOL_H
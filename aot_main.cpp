@@ -0,0 +1,74 @@
+#include "AotCompiler.h"
+#include "Program.h"
+#include "Exception.h"
+#include <QCoreApplication>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+
+// qbasic-aot [--emit] [--run] [--cache-dir DIR] [--cxx COMPILER] program.txt
+//   --emit       只输出生成的 C++ 源码
+//   --run        构建后直接执行（标准输入、输出透传给生成的程序）
+static int usage() {
+    std::cerr << "usage: qbasic-aot [--emit] [--run] [--cache-dir DIR] [--cxx COMPILER] program.txt" << std::endl;
+    return 2;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    bool emitOnly = false;
+    bool runAfterBuild = false;
+    std::string cacheDir = AotCompiler::defaultCacheDir();
+    std::string cxx = AotCompiler::defaultCompiler();
+    std::string path;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--emit") == 0) emitOnly = true;
+        else if (std::strcmp(argv[i], "--run") == 0) runAfterBuild = true;
+        else if (std::strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc) cacheDir = argv[++i];
+        else if (std::strcmp(argv[i], "--cxx") == 0 && i + 1 < argc) cxx = argv[++i];
+        else if (argv[i][0] == '-') return usage();
+        else path = argv[i];
+    }
+    if (path.empty()) return usage();
+
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Could not open the file: " << path << std::endl;
+        return 1;
+    }
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // 解释器的调试日志写在 std::cout 上，这里把它们转到标准错误，标准输出只留结果
+    std::ostream result(std::cout.rdbuf());
+    std::cout.rdbuf(std::cerr.rdbuf());
+
+    try {
+        Program program;
+        program.LoadContent(content);
+        AotCompiler aot(program);
+        if (emitOnly) {
+            result << aot.translate();
+            return 0;
+        }
+        std::string binary = aot.build(cacheDir, cxx);
+        if (runAfterBuild) {
+            result.flush();
+            execl(binary.c_str(), binary.c_str(), static_cast<char*>(nullptr));
+            std::cerr << "cannot execute " << binary << std::endl;
+            return 1;
+        }
+        result << binary << std::endl;
+    }
+    catch (ParseException &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include "BatchRunner.h"
+#include <QCoreApplication>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <streambuf>
+#include <sys/stat.h>
+
+// qbasic-batch [--threads N] [--memory-limit BYTES] [--max-statements N] [--repeat N]
+//              [--no-timing] [--output FILE] [--checkpoint-dir DIR] [--checkpoint-every N] [--image-cache DIR] DIR|MANIFEST...
+//   DIR          目录中的每个 *.txt 是一个程序，同名 .in 文件是它的输入
+//   MANIFEST     每行“程序路径[<TAB>输入路径]”
+//   --repeat N   每个作业重复 N 次，用于压力测试
+//   --no-timing  结果文件不含 wallMs，相同输入得到逐字节相同的结果
+//   --checkpoint-dir DIR    每 N 条语句（默认一千万）保存一次检查点，中断后再次运行时从检查点继续
+//   --image-cache DIR       解析好的程序存为映像文件，再次运行同样的程序时直接映射，不再解析
+static int usage() {
+    std::cerr << "usage: qbasic-batch [--threads N] [--memory-limit BYTES] [--max-statements N] [--repeat N] "
+                 "[--no-timing] [--output FILE] [--checkpoint-dir DIR] [--checkpoint-every N] [--image-cache DIR] DIR|MANIFEST..." << std::endl;
+    return 2;
+}
+
+// 丢弃写入的内容；解释器的调试日志不需要，也避免多个线程争用终端
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int ch) override { return ch == traits_type::eof() ? 0 : ch; }
+    std::streamsize xsputn(const char *, std::streamsize count) override { return count; }
+};
+
+static bool isDirectory(const std::string &path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    BatchRunner::Options options;
+    int repeat = 1;
+    std::string outputPath;
+    std::vector<std::string> sources;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) options.threads = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--memory-limit") == 0 && i + 1 < argc) options.memoryLimit = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--max-statements") == 0 && i + 1 < argc) options.maxStatements = std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) repeat = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--no-timing") == 0) options.timing = false;
+        else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) outputPath = argv[++i];
+        else if (std::strcmp(argv[i], "--checkpoint-dir") == 0 && i + 1 < argc) options.checkpointDirectory = argv[++i];
+        else if (std::strcmp(argv[i], "--checkpoint-every") == 0 && i + 1 < argc) options.checkpointEvery = std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "--image-cache") == 0 && i + 1 < argc) options.imageCacheDirectory = argv[++i];
+        else if (argv[i][0] == '-') return usage();
+        else sources.push_back(argv[i]);
+    }
+    if (sources.empty() || repeat < 1) return usage();
+
+    // 结果写到原来的标准输出，std::cout 上的调试日志丢弃
+    NullBuffer discard;
+    std::streambuf *standardOutput = std::cout.rdbuf(&discard);
+
+    std::vector<BatchJob> jobs;
+    try {
+        for (const std::string &source : sources) {
+            std::vector<BatchJob> found = isDirectory(source) ? BatchRunner::scanDirectory(source) : BatchRunner::readManifest(source);
+            jobs.insert(jobs.end(), found.begin(), found.end());
+            for (BatchJob &job : found) job.copy = true;
+            for (int r = 1; r < repeat; ++r) jobs.insert(jobs.end(), found.begin(), found.end());
+        }
+    }
+    catch (const std::exception &e) {
+        std::cout.rdbuf(standardOutput);
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    BatchRunner runner(options);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<BatchResult> results = runner.run(jobs);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::ofstream file;
+    if (!outputPath.empty()) {
+        file.open(outputPath);
+        if (!file) {
+            std::cout.rdbuf(standardOutput);
+            std::cerr << "cannot write " << outputPath << std::endl;
+            return 1;
+        }
+    }
+    std::ostream out(outputPath.empty() ? standardOutput : file.rdbuf());
+    runner.writeResults(out, results);
+    out.flush();
+    std::cout.rdbuf(standardOutput);
+
+    long long statements = 0;
+    std::size_t failed = 0;
+    for (const BatchResult &result : results) {
+        statements += result.statements;
+        if (!result.ok) ++failed;
+    }
+    std::cerr << results.size() << " programs, " << results.size() - failed << " ok, " << failed << " errors, "
+              << statements << " statements in " << seconds << " s ("
+              << (seconds > 0 ? results.size() / seconds : 0) << " programs/s)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,208 @@
+#include "ServerProtocol.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// qbasic-client [--socket PATH] [--input FILE] [--timeout MS] program.txt
+//   发送一个请求，按帧打印输出、语法树、错误和结束信息
+// qbasic-client --bench [--connections N] [--requests N] [--socket PATH] [--input FILE] program.txt
+//   N 个连接各自串行发送请求，报告每秒请求数和延迟分位数
+static int usage() {
+    std::cerr << "usage: qbasic-client [--bench] [--connections N] [--requests N] [--socket PATH] [--input FILE] [--timeout MS] program.txt" << std::endl;
+    return 2;
+}
+
+static bool readFile(const std::string &path, std::string &content) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+static int connectTo(const std::string &path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) return -1;
+    std::strcpy(address.sun_path, path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool sendAll(int fd, const std::string &data) {
+    std::size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t wrote = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (wrote < 0 && errno == EINTR) continue;
+        if (wrote <= 0) return false;
+        sent += wrote;
+    }
+    return true;
+}
+
+// 一个连接上的阻塞式帧读取
+class FrameReader {
+public:
+    explicit FrameReader(int fd) : fd(fd), offset(0) {}
+
+    bool next(char &type, std::string &payload) {
+        for (;;) {
+            ServerProtocol::ParseResult result = ServerProtocol::takeFrame(buffer, offset, type, payload);
+            if (result == ServerProtocol::Complete) return true;
+            if (result == ServerProtocol::Malformed) return false;
+            buffer.erase(0, offset);
+            offset = 0;
+            char chunk[65536];
+            ssize_t got = recv(fd, chunk, sizeof(chunk), 0);
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) return false;
+            buffer.append(chunk, got);
+        }
+    }
+
+private:
+    int fd;
+    std::string buffer;
+    std::size_t offset;
+};
+
+// 一个请求的全部帧（以 Run 结束）
+static std::string buildRequest(const std::string &program, const std::string &input, int timeoutMs) {
+    std::string frames;
+    ServerProtocol::appendFrame(frames, ServerProtocol::ProgramText, program);
+    if (!input.empty()) ServerProtocol::appendFrame(frames, ServerProtocol::InputValues, input);
+    if (timeoutMs >= 0) ServerProtocol::appendFrame(frames, ServerProtocol::Timeout, std::to_string(timeoutMs));
+    ServerProtocol::appendFrame(frames, ServerProtocol::Run, "");
+    return frames;
+}
+
+static int runOnce(const std::string &socketPath, const std::string &request) {
+    int fd = connectTo(socketPath);
+    if (fd < 0) {
+        std::cerr << socketPath << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    int status = 1;
+    if (sendAll(fd, request)) {
+        FrameReader reader(fd);
+        char type;
+        std::string payload;
+        while (reader.next(type, payload)) {
+            if (type == ServerProtocol::Output) std::cout << payload;
+            else if (type == ServerProtocol::SyntaxTree) std::cout << "TREE\n" << payload;
+            else if (type == ServerProtocol::Error) std::cout << "ERROR " << payload << "\n";
+            else if (type == ServerProtocol::Done) {
+                std::cout << "DONE " << payload << "\n";
+                status = payload.find("\"status\":\"ok\"") != std::string::npos ? 0 : 1;
+                break;
+            }
+        }
+    }
+    close(fd);
+    return status;
+}
+
+static int bench(const std::string &socketPath, const std::string &request, int connections, int requests) {
+    std::vector<std::vector<double>> latencies(connections);
+    std::atomic<long> failures(0);
+    std::vector<std::thread> clients;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int c = 0; c < connections; ++c) {
+        clients.emplace_back([&, c] {
+            int fd = connectTo(socketPath);
+            if (fd < 0) {
+                failures.fetch_add(requests);
+                return;
+            }
+            FrameReader reader(fd);
+            std::vector<double> &samples = latencies[c];
+            samples.reserve(requests);
+            for (int r = 0; r < requests; ++r) {
+                std::chrono::steady_clock::time_point sent = std::chrono::steady_clock::now();
+                if (!sendAll(fd, request)) {
+                    failures.fetch_add(requests - r);
+                    break;
+                }
+                char type;
+                std::string payload;
+                bool done = false;
+                while (reader.next(type, payload)) {
+                    if (type == ServerProtocol::Done) {
+                        done = true;
+                        if (payload.find("\"status\":\"ok\"") == std::string::npos) failures.fetch_add(1);
+                        break;
+                    }
+                }
+                if (!done) {
+                    failures.fetch_add(requests - r);
+                    break;
+                }
+                samples.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - sent).count());
+            }
+            close(fd);
+        });
+    }
+    for (std::thread &client : clients) client.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> all;
+    for (const std::vector<double> &samples : latencies) all.insert(all.end(), samples.begin(), samples.end());
+    if (all.empty()) {
+        std::cerr << "no request completed" << std::endl;
+        return 1;
+    }
+    std::sort(all.begin(), all.end());
+    auto percentile = [&all](double p) { return all[std::min(all.size() - 1, static_cast<std::size_t>(p * all.size()))]; };
+    std::cout << all.size() << " requests over " << connections << " connections in " << seconds << " s, "
+              << failures.load() << " not ok\n";
+    std::cout << "throughput: " << all.size() / seconds << " req/s\n";
+    std::cout << "latency (us): p50 " << percentile(0.50) << ", p90 " << percentile(0.90) << ", p99 " << percentile(0.99)
+              << ", p99.9 " << percentile(0.999) << ", max " << all.back() << std::endl;
+    return failures.load() ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string socketPath = "/tmp/qbasic.sock";
+    std::string inputPath;
+    std::string path;
+    bool benchmark = false;
+    int connections = 4;
+    int requests = 1000;
+    int timeoutMs = -1;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc) socketPath = argv[++i];
+        else if (std::strcmp(argv[i], "--input") == 0 && i + 1 < argc) inputPath = argv[++i];
+        else if (std::strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) timeoutMs = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--connections") == 0 && i + 1 < argc) connections = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--requests") == 0 && i + 1 < argc) requests = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--bench") == 0) benchmark = true;
+        else if (argv[i][0] == '-') return usage();
+        else path = argv[i];
+    }
+    if (path.empty() || connections < 1 || requests < 1) return usage();
+
+    std::string program, input;
+    if (!readFile(path, program) || (!inputPath.empty() && !readFile(inputPath, input))) {
+        std::cerr << "cannot read " << (program.empty() ? path : inputPath) << std::endl;
+        return 1;
+    }
+    std::string request = buildRequest(program, input, timeoutMs);
+    return benchmark ? bench(socketPath, request, connections, requests) : runOnce(socketPath, request);
+}
@@ -0,0 +1,148 @@
+#include "GreenScheduler.h"
+#include "Program.h"
+#include <QCoreApplication>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <streambuf>
+#include <unistd.h>
+
+// qbasic-green [--tasks N] [--threads N] [--slice N] [--input FILE] [--show] program.txt
+//   同一程序启动 N 个任务，在少量线程上分时运行。任务全部停在 INPUT 时统计挂起任务的内存，
+//   然后一轮一轮地给所有等待的任务各一个输入（第 k 轮用输入文件的第 k 行），直到全部结束。
+//   --show       输出第一个任务的输出
+static int usage() {
+    std::cerr << "usage: qbasic-green [--tasks N] [--threads N] [--slice N] [--input FILE] [--show] program.txt" << std::endl;
+    return 2;
+}
+
+// 丢弃写入的内容；解释器的调试日志不需要，也避免多个线程争用终端
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int ch) override { return ch == traits_type::eof() ? 0 : ch; }
+    std::streamsize xsputn(const char *, std::streamsize count) override { return count; }
+};
+
+static long residentBytes() {
+    long pages = 0, resident = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> pages >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    int taskCount = 1000;
+    int threads = 0;
+    int slice = 1000;
+    bool show = false;
+    std::string inputPath;
+    std::string path;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--tasks") == 0 && i + 1 < argc) taskCount = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--slice") == 0 && i + 1 < argc) slice = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--input") == 0 && i + 1 < argc) inputPath = argv[++i];
+        else if (std::strcmp(argv[i], "--show") == 0) show = true;
+        else if (argv[i][0] == '-') return usage();
+        else path = argv[i];
+    }
+    if (path.empty() || taskCount < 1) return usage();
+
+    std::vector<std::string> inputs;
+    if (!inputPath.empty()) {
+        std::ifstream file(inputPath);
+        if (!file) {
+            std::cerr << "cannot read " << inputPath << std::endl;
+            return 1;
+        }
+        std::string line;
+        while (std::getline(file, line)) inputs.push_back(line);
+    }
+
+    NullBuffer discard;
+    std::streambuf *standardOutput = std::cout.rdbuf(&discard);
+
+    std::shared_ptr<const ProgramImage> image;
+    try {
+        Program program;
+        program.Load(path);
+        // 解析与调度使用同样多的线程
+        image = ProgramImage::build(program, threads);
+    }
+    catch (const std::exception &e) {
+        std::cout.rdbuf(standardOutput);
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    std::mutex mutex;
+    std::vector<GreenScheduler::TaskId> waiting;
+    std::string firstOutput;
+    long long outputBytes = 0;
+    std::size_t finished = 0, failed = 0;
+    std::string firstError;
+    GreenScheduler::TaskId first = 0;
+    GreenScheduler::Listener listener = [&](const GreenScheduler::Event &event) {
+        std::lock_guard<std::mutex> lock(mutex);
+        switch (event.kind) {
+        case GreenScheduler::Event::Output:
+            outputBytes += event.text.size();
+            if (event.task == first) firstOutput += event.text;
+            break;
+        case GreenScheduler::Event::NeedsInput:
+            waiting.push_back(event.task);
+            break;
+        case GreenScheduler::Event::Finished:
+            ++finished;
+            break;
+        case GreenScheduler::Event::Error:
+            if (!failed++) firstError = event.text;
+            break;
+        }
+    };
+
+    long before = residentBytes();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    GreenScheduler scheduler(threads, slice, listener);
+    {
+        // 第一个任务的输出可能在 spawn 返回前就到达
+        std::lock_guard<std::mutex> lock(mutex);
+        first = scheduler.spawn(image);
+    }
+    for (int i = 1; i < taskCount; ++i) scheduler.spawn(image);
+
+    std::size_t rounds = 0;
+    for (;;) {
+        scheduler.waitIdle();
+        std::vector<GreenScheduler::TaskId> parked;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            parked.swap(waiting);
+        }
+        if (parked.empty()) break;
+        if (rounds == 0) {
+            long perTask = (residentBytes() - before) / static_cast<long>(parked.size());
+            std::cerr << parked.size() << " tasks parked on INPUT, about " << perTask << " bytes resident each" << std::endl;
+        }
+        if (rounds >= inputs.size()) {
+            for (GreenScheduler::TaskId id : parked) scheduler.cancel(id);
+            std::cerr << parked.size() << " tasks still waiting after " << rounds << " inputs, cancelled" << std::endl;
+            break;
+        }
+        for (GreenScheduler::TaskId id : parked) scheduler.provideInput(id, inputs[rounds]);
+        ++rounds;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout.rdbuf(standardOutput);
+    if (show) std::cout << firstOutput << std::flush;
+    std::cerr << taskCount << " tasks on " << scheduler.threadCount() << " threads, " << finished << " finished, " << failed << " errors, "
+              << rounds << " input rounds, " << outputBytes << " output bytes in " << seconds << " s" << std::endl;
+    if (failed) std::cerr << "first error: " << firstError << std::endl;
+    return failed ? 1 : 0;
+}
@@ -1,11 +1,35 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "AllocationProfiler.h"
+#include "MappedFile.h"
+#include "RunTrace.h"
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
+    , worker(program)
+    , validator(program)
+    , waitingForInput(false)
     , ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
+    progressTimer = new QTimer(this);
+    progressTimer->setInterval(50);
+    connect(progressTimer, &QTimer::timeout, this, &MainWindow::pollWorker);
+    listing = new ListingModel(program, this);
+    program.addListingObserver(listing);
+    ui->CodeDisplay->setModel(listing);
+    syntaxTree = new SyntaxTreeModel(program, this);
+    ui->treeDisplay->setModel(syntaxTree);
+    // 编辑和 LOAD 之后在后台解析，错误出现在代码区对应的行上，不阻塞输入
+    program.addListingObserver(&validator);
+    validationTimer = new QTimer(this);
+    validationTimer->setInterval(100);
+    connect(validationTimer, &QTimer::timeout, this, &MainWindow::pollValidation);
+    validationTimer->start();
     connect(ui->btnLoadCode, &QPushButton::clicked, this, &MainWindow::Load);
     connect(ui->btnRunCode, &QPushButton::clicked, this, &MainWindow::Run);
     connect(ui->btnClearCode, &QPushButton::clicked, this, &MainWindow::Clear);
@@ -14,52 +38,149 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->cmdLineEdit, &QLineEdit::returnPressed, this, &MainWindow::onLineEditReturnPressed);
 
     connect(&this->program, &Program::requestInput, this, &MainWindow::requestInput);
+#ifdef QBASIC_PGO
+    program.setProfileGuided(true);
+#endif
+#ifdef QBASIC_EDGE_PROFILE
+    program.setEdgeProfiling(true);
+#endif
+#ifdef QBASIC_RECORD
+    program.setTraceRecording(true);
+#endif
 }
 
 MainWindow::~MainWindow()
 {
+    program.removeListingObserver(&validator);
+    program.removeListingObserver(listing);
     delete ui;
 }
 
 void MainWindow::Run(){
-    try {
-        program.isRunning = true;
+    if (worker.isRunning()) {
+        QMessageBox::warning(this, tr("Error"), tr("program is running."));
+        return;
+    }
+    program.isRunning = true;
     std::cout << "Run" << std::endl;
-    program.preRun();
-    program.exec();
+    if (AllocationProfiler::isCompiledIn()) AllocationProfiler::reset();
+    ui->textBrowser->clear();
+    // 运行期间界面线程不能访问 program，语法树区先换成运行统计的快照
+    syntaxTree->showCounters(program.getRunCounters());
+    // 程序在执行线程上运行，界面线程定时取回输出和运行统计，保持响应
+    worker.start();
+    progressTimer->start();
+}
+
+void MainWindow::Stop(){
+    if (worker.isRunning()) worker.stop();
+}
+
+void MainWindow::pollWorker(){
+    RunEvent event;
+    while (worker.pollEvent(event)) handleRunEvent(event);
+    if (worker.isFinished()) {
+        while (worker.pollEvent(event)) handleRunEvent(event);
+        finishRun();
+        return;
+    }
+    worker.requestSnapshot();
+}
+
+void MainWindow::pollValidation(){
+    ValidationWorker::Diagnostic diagnostic;
+    while (validator.pollDiagnostic(diagnostic)) listing->setDiagnostic(diagnostic.lineNumber, diagnostic.message);
+}
+
+void MainWindow::handleRunEvent(const RunEvent &event){
+    switch (event.kind) {
+    case RunEvent::Output:
+        ui->textBrowser->moveCursor(QTextCursor::End);
+        ui->textBrowser->insertPlainText(QString::fromStdString(event.text));
+        break;
+    case RunEvent::Counters:
+        syntaxTree->updateCounters(event.text);
+        break;
+    case RunEvent::NeedsInput:
+        requestInput();
+        break;
+    default:
+        break;
+    }
+}
+
+// 执行线程已经结束：等待线程退出后才能再访问 program
+void MainWindow::finishRun(){
+    progressTimer->stop();
+    worker.wait();
+    restoreCommandInput();
+    const RunEvent &result = worker.result();
+    // 执行线程已经退出，语法树区改为直接读取程序，展开的行才解析和渲染
+    syntaxTree->refresh();
+#ifdef QBASIC_RECORD
+    if (result.kind != RunEvent::Stopped) saveTrace();
+#endif
+    try {
+    if (result.kind == RunEvent::Error) {
+        ui->textBrowser->setPlainText(QString::fromStdString(result.text));
+    }
+    else if (result.kind == RunEvent::Stopped) {
+        std::string message = program.getOutput() + "Stopped at line " + std::to_string(result.line) + "\n";
+        ui->textBrowser->setPlainText(QString::fromStdString(message));
+    }
+    else {
     std::cout << program.getOutput() << std::endl;
-    ui->textBrowser->setPlainText(QString::fromStdString(program.getOutput()));
-    ui->treeDisplay->setPlainText(QString::fromStdString(program.getSyntaxTreeWithRunStatistics()));
-//    ui->treeDisplay->setPlainText(QString::fromStdString(program.getSyntaxTree()));
-    program.isRunning = false;
+    // 没有执行到的行不会在运行中报错，运行结束后把它们的解析错误接在输出后面，并标在代码区
+    std::string message = program.getOutput();
+    for (const auto &error : program.getUnreachedErrors()) {
+        message += error.second + "\n";
+        listing->setDiagnostic(error.first, error.second);
+    }
+    ui->textBrowser->setPlainText(QString::fromStdString(message));
+    if (AllocationProfiler::isCompiledIn()) std::cout << AllocationProfiler::report();
+#ifdef QBASIC_EDGE_PROFILE
+    std::cout << program.getEdgeProfileReport();
+#endif
+    }
     }
     catch(ParseException &e) {
         ui->textBrowser->setPlainText(e.what());
-    } catch (const std::invalid_argument& ia) {
-        // 如果输入的不是整数，将会捕获到invalid_argument异常
-        std::cerr << "Error: Invalid input, not an integer." << std::endl;
-        ui->textBrowser->setPlainText("Error: Invalid input, not an integer.");
-    } catch (const std::out_of_range& oor) {
-        // 如果整数超出了int的范围，将会捕获到out_of_range异常
-        std::cerr << "Error: Integer out of range." << std::endl;
-        ui->textBrowser->setPlainText(oor.what());
+    }
+    program.isRunning = false;
 }
+
+// 录制已由执行线程上的解释器完成，这里只写文件；qbasic-replay 用同一个解释器回放校验
+void MainWindow::saveTrace(){
+    try {
+        const RunTrace &trace = program.getTrace();
+        std::string directory = cacheDirectory("qbasic-traces");
+        makeDirectories(directory);
+        long long stamp = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        std::string path = directory + "/" + trace.programKey() + "-" + std::to_string(stamp) + ".trace";
+        trace.save(path);
+        std::cout << "trace saved to " << path << std::endl;
+    }
+    catch (const std::exception &e) {
+        std::cout << "cannot save trace: " << e.what() << std::endl;
+    }
 }
 
 void MainWindow::Clear(){
     std::cout << "Clear" << std::endl;
-    ui->CodeDisplay->clear();
-    ui->treeDisplay->clear();
+    if (worker.isRunning()) {
+        worker.stop();
+        worker.wait();
+        progressTimer->stop();
+        restoreCommandInput();
+    }
+    syntaxTree->clear();
     ui->textBrowser->clear();
-    program.reset();
+    program.reset(); // 代码区随之清空
 }
 
 // 添加一个新的槽函数用来处理returnPressed信号
 void MainWindow::onLineEditReturnPressed() {
     try {
-        if (program.isRunning) {
-            QMessageBox::warning(this, tr("Error"), tr("program is running."));
-        }
     QString text = ui->cmdLineEdit->text(); // 获取QLineEdit的文本
     std::string stdText = text.toStdString(); // Convert QString to std::string
     std::cout << "Input: " << stdText << std::endl;
@@ -72,6 +193,16 @@ void MainWindow::onLineEditReturnPressed() {
     std::istringstream iss(stdText);
     std::string firstWord;
     iss >> firstWord;
+    if (firstWord == "STOP"){
+        this->Stop();
+        ui->cmdLineEdit->clear();
+        return;
+    }
+    // 运行期间只接受 STOP、CLEAR、HELP 和 QUIT
+    if (worker.isRunning() && firstWord != "CLEAR" && firstWord != "HELP" && firstWord != "QUIT") {
+        QMessageBox::warning(this, tr("Error"), tr("program is running."));
+        return;
+    }
     if (firstWord == "RUN"){
         this->Run();
         ui->cmdLineEdit->clear();
@@ -100,15 +231,17 @@ void MainWindow::onLineEditReturnPressed() {
 //    program.cmd(stdText);
         if (std::isdigit(stdText[0])) {
             // 首个字符是数字，找到第一个空格并提取前面的数字
+            // 代码区由 listing 收到编辑通知后只更新这一行
             program.edit(stdText);
-            ui->CodeDisplay->setPlainText(QString::fromStdString(program.display()));
+            QModelIndex edited = listing->indexOfLine(std::atoi(stdText.c_str()));
+            if (edited.isValid()) ui->CodeDisplay->scrollTo(edited);
         } else if (std::isalpha(stdText[0])) {
             // 首个字符是字母，找到第一个空格并提取前面的字符串
 //            program.preRun();
 //            program.exec();
             program.execLine(stdText);
             ui->textBrowser->setPlainText(QString::fromStdString(program.getOutput()));
-            ui->treeDisplay->setPlainText(QString::fromStdString(program.getSyntaxTreeWithRunStatistics()));
+            syntaxTree->refresh();
         } else {
             // 首个字符既不是数字也不是字母
             throw ParseException(ParseErrorType::InvalidExpressionError, "invalid command", -1);
@@ -134,6 +267,10 @@ void MainWindow::on_cmdLineEdit_editingFinished(){
 
 void MainWindow::Load()
 {
+    if (worker.isRunning()) {
+        QMessageBox::warning(this, tr("Error"), tr("program is running."));
+        return;
+    }
     try {
     std::cout << "Load" << std::endl;
     // Open file selection dialog and get the selected file path
@@ -145,22 +282,22 @@ void MainWindow::Load()
         // Convert the QString filePath to std::string
         std::string path = filePath.toStdString();
 
-        // Create an input file stream
-        std::ifstream file(path);
+        // Map the file; the program reads its lines straight from the mapping
+        std::unique_ptr<MappedFile> file;
+        try {
+            file.reset(new MappedFile(path));
+        }
+        catch (const std::runtime_error&) {}
 
         // Check if the file is successfully opened
         if (file)
         {
-            // Read the file content and pass it to program
-            std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-
             program.reset();
-            program.LoadContent(content); // Assuming program.Load() can take file content as a string
+            // The listing model is reset when loading finishes and fills the CodeDisplay
+            program.LoadContent(file->data(), file->size());
 
-            // Set the content in the UI's CodeDisplay
-            ui->CodeDisplay->setPlainText(QString::fromStdString(program.display()));
             ui->textBrowser->clear();
-            ui->treeDisplay->clear();
+            syntaxTree->clear();
         }
         else{
             QMessageBox::warning(this, tr("Error"), tr("Could not open the file."));
@@ -189,19 +326,34 @@ void MainWindow::requestInput(){
     ui->cmdLineEdit->setText("?");
     ui->cmdLineEdit->setFocus();
 
+    waitingForInput = true;
     disconnect(ui->cmdLineEdit, &QLineEdit::returnPressed, this, &MainWindow::onLineEditReturnPressed);
     connect(ui->cmdLineEdit, &QLineEdit::returnPressed, this, &MainWindow::onInputReceived);
 }
 
+void MainWindow::restoreCommandInput(){
+    if (!waitingForInput) return;
+    waitingForInput = false;
+    disconnect(ui->cmdLineEdit, &QLineEdit::returnPressed, this, &MainWindow::onInputReceived);
+    connect(ui->cmdLineEdit, &QLineEdit::returnPressed, this, &MainWindow::onLineEditReturnPressed);
+    ui->cmdLineEdit->clear();
+}
+
 void MainWindow::onInputReceived(){
     std::cout << "mainwindow oninputReceived" << ui->cmdLineEdit->text().toStdString().substr(1) << std::endl;
 
-    disconnect(ui->cmdLineEdit, &QLineEdit::returnPressed, this, &MainWindow::onInputReceived);
-    connect(ui->cmdLineEdit, &QLineEdit::returnPressed, this, &MainWindow::onLineEditReturnPressed);
+    std::string value = ui->cmdLineEdit->text().toStdString().substr(1);
+    bool stopCommand = ui->cmdLineEdit->text().mid(1).trimmed() == "STOP";
+    restoreCommandInput();
 
-    program.setInput(ui->cmdLineEdit->text().toStdString().substr(1));
+    if (worker.isRunning()) {
+        // 等待输入时同样可以用 STOP 结束程序
+        if (stopCommand) worker.stop();
+        else worker.provideInput(value);
+        return;
+    }
+    program.setInput(value);
 //    program.isInputFinished = true;
-    ui->cmdLineEdit->clear();
     emit program.inputFinished(); // 发出输入完成的信号
 }
 
@@ -8,8 +8,13 @@
 #include <QTextStream>
 #include <QDebug>
 #include "Program.h"
+#include "ExecutionWorker.h"
+#include "ListingModel.h"
+#include "SyntaxTreeModel.h"
+#include "ValidationWorker.h"
 #include "Exception.h"
 #include <QMessageBox>
+#include <QTimer>
 #include "Typedef.h"
 
 QT_BEGIN_NAMESPACE
@@ -28,13 +33,27 @@ public slots:
     void onInputReceived();
 private slots:
     void on_cmdLineEdit_editingFinished();
+    void pollWorker();
+    void pollValidation();
 private:
     Program program;
+    ExecutionWorker worker;     // 必须在 program 之后声明，先于它析构
+    QTimer *progressTimer;      // 运行期间定时取回输出和运行统计
+    ListingModel *listing;      // 代码区的模型，随 program 的编辑逐行更新
+    SyntaxTreeModel *syntaxTree; // 语法树区的模型，展开一行时才渲染这一行
+    ValidationWorker validator; // 在后台检查编辑过的行，必须在 program 之后声明
+    QTimer *validationTimer;    // 定时取回后台检查的结果
+    bool waitingForInput;
     void Load();
     void Run();
+    void Stop();
     void Clear();
     void Help();
     void onLineEditReturnPressed();
+    void handleRunEvent(const RunEvent &event);
+    void finishRun();
+    void saveTrace();
+    void restoreCommandInput();
 private:
     Ui::MainWindow *ui;
 };
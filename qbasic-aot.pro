@@ -0,0 +1,50 @@
+# Ahead-of-time compiler: translates a BASIC program to C++ and builds it with the system compiler.
+QT       = core
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = qbasic-aot
+
+SOURCES += \
+    AllocationProfiler.cpp \
+    AotCompiler.cpp \
+    CompiledExpression.cpp \
+    EdgeProfiler.cpp \
+    Exception.cpp \
+    ExpressionEvaluator.cpp \
+    InputProvider.cpp \
+    JitCompiler.cpp \
+    LoopAnalysis.cpp \
+    LoopSummary.cpp \
+    MappedFile.cpp \
+    PgoProfile.cpp \
+    Program.cpp \
+    RunControl.cpp \
+    RunLimits.cpp \
+    Statement.cpp \
+    TierManager.cpp \
+    Typedef.cpp \
+    aot_main.cpp
+
+HEADERS += \
+    AllocationProfiler.h \
+    AotCompiler.h \
+    CompiledExpression.h \
+    EdgeProfiler.h \
+    Exception.h \
+    ExpressionEvaluator.h \
+    InputProvider.h \
+    JitCompiler.h \
+    ListingObserver.h \
+    LoopAnalysis.h \
+    LoopSummary.h \
+    MappedFile.h \
+    PgoProfile.h \
+    Program.h \
+    RunControl.h \
+    RunLimits.h \
+    SpscQueue.h \
+    Statement.h \
+    TierManager.h \
+    Typedef.h
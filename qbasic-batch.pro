@@ -0,0 +1,60 @@
+# Batch runner: loads and runs directories or manifests of BASIC programs on a work-stealing thread pool.
+QT       = core
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = qbasic-batch
+
+SOURCES += \
+    AllocationProfiler.cpp \
+    BatchRunner.cpp \
+    CompiledExpression.cpp \
+    EdgeProfiler.cpp \
+    Exception.cpp \
+    ExecutionContext.cpp \
+    ExpressionEvaluator.cpp \
+    ImageCache.cpp \
+    InputProvider.cpp \
+    JitCompiler.cpp \
+    LoopAnalysis.cpp \
+    LoopSummary.cpp \
+    MappedFile.cpp \
+    PgoProfile.cpp \
+    Program.cpp \
+    ProgramImage.cpp \
+    RunControl.cpp \
+    RunLimits.cpp \
+    RunTrace.cpp \
+    Statement.cpp \
+    TierManager.cpp \
+    Typedef.cpp \
+    WorkStealingPool.cpp \
+    batch_main.cpp
+
+HEADERS += \
+    AllocationProfiler.h \
+    BatchRunner.h \
+    CompiledExpression.h \
+    EdgeProfiler.h \
+    Exception.h \
+    ExecutionContext.h \
+    ExpressionEvaluator.h \
+    ImageCache.h \
+    InputProvider.h \
+    JitCompiler.h \
+    ListingObserver.h \
+    LoopAnalysis.h \
+    LoopSummary.h \
+    MappedFile.h \
+    PgoProfile.h \
+    Program.h \
+    ProgramImage.h \
+    RunControl.h \
+    RunLimits.h \
+    RunTrace.h \
+    SpscQueue.h \
+    Statement.h \
+    TierManager.h \
+    Typedef.h \
+    WorkStealingPool.h
@@ -0,0 +1,14 @@
+# Client for qbasic-server: sends one program and prints the response frames, or benchmarks throughput and latency with --bench.
+QT       -= core gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle qt
+
+TARGET = qbasic-client
+
+SOURCES += \
+    ServerProtocol.cpp \
+    client_main.cpp
+
+HEADERS += \
+    ServerProtocol.h
@@ -0,0 +1,56 @@
+# Green-thread load tool: time-slices thousands of BASIC runs on a few threads, parking the ones waiting for INPUT.
+QT       = core
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = qbasic-green
+
+SOURCES += \
+    AllocationProfiler.cpp \
+    CompiledExpression.cpp \
+    EdgeProfiler.cpp \
+    Exception.cpp \
+    ExecutionContext.cpp \
+    ExpressionEvaluator.cpp \
+    GreenScheduler.cpp \
+    InputProvider.cpp \
+    JitCompiler.cpp \
+    LoopAnalysis.cpp \
+    LoopSummary.cpp \
+    MappedFile.cpp \
+    PgoProfile.cpp \
+    Program.cpp \
+    ProgramImage.cpp \
+    RunControl.cpp \
+    RunLimits.cpp \
+    RunTrace.cpp \
+    Statement.cpp \
+    TierManager.cpp \
+    Typedef.cpp \
+    green_main.cpp
+
+HEADERS += \
+    AllocationProfiler.h \
+    CompiledExpression.h \
+    EdgeProfiler.h \
+    Exception.h \
+    ExecutionContext.h \
+    ExpressionEvaluator.h \
+    GreenScheduler.h \
+    InputProvider.h \
+    JitCompiler.h \
+    ListingObserver.h \
+    LoopAnalysis.h \
+    LoopSummary.h \
+    MappedFile.h \
+    PgoProfile.h \
+    Program.h \
+    ProgramImage.h \
+    RunControl.h \
+    RunLimits.h \
+    RunTrace.h \
+    SpscQueue.h \
+    Statement.h \
+    TierManager.h \
+    Typedef.h
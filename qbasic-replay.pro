@@ -0,0 +1,54 @@
+# Record and replay: records a headless run (inputs, taken jumps, output, counters) to a trace and re-runs or verifies it offline.
+QT       = core
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = qbasic-replay
+
+SOURCES += \
+    AllocationProfiler.cpp \
+    CompiledExpression.cpp \
+    EdgeProfiler.cpp \
+    Exception.cpp \
+    ExecutionContext.cpp \
+    ExpressionEvaluator.cpp \
+    InputProvider.cpp \
+    JitCompiler.cpp \
+    LoopAnalysis.cpp \
+    LoopSummary.cpp \
+    MappedFile.cpp \
+    PgoProfile.cpp \
+    Program.cpp \
+    ProgramImage.cpp \
+    RunControl.cpp \
+    RunLimits.cpp \
+    RunTrace.cpp \
+    Statement.cpp \
+    TierManager.cpp \
+    Typedef.cpp \
+    replay_main.cpp
+
+HEADERS += \
+    AllocationProfiler.h \
+    CompiledExpression.h \
+    EdgeProfiler.h \
+    Exception.h \
+    ExecutionContext.h \
+    ExpressionEvaluator.h \
+    InputProvider.h \
+    JitCompiler.h \
+    ListingObserver.h \
+    LoopAnalysis.h \
+    LoopSummary.h \
+    MappedFile.h \
+    PgoProfile.h \
+    Program.h \
+    ProgramImage.h \
+    RunControl.h \
+    RunLimits.h \
+    RunTrace.h \
+    SpscQueue.h \
+    Statement.h \
+    TierManager.h \
+    Typedef.h
@@ -0,0 +1,64 @@
+# Execution server: runs BASIC programs sent over a Unix domain socket, caching parsed programs by content hash.
+QT       = core
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = qbasic-server
+
+SOURCES += \
+    AllocationProfiler.cpp \
+    CompiledExpression.cpp \
+    EdgeProfiler.cpp \
+    Exception.cpp \
+    ExecutionContext.cpp \
+    ExecutionServer.cpp \
+    ExpressionEvaluator.cpp \
+    ImageCache.cpp \
+    InputProvider.cpp \
+    JitCompiler.cpp \
+    LoopAnalysis.cpp \
+    LoopSummary.cpp \
+    MappedFile.cpp \
+    PgoProfile.cpp \
+    Program.cpp \
+    ProgramCache.cpp \
+    ProgramImage.cpp \
+    RunControl.cpp \
+    RunLimits.cpp \
+    RunTrace.cpp \
+    ServerProtocol.cpp \
+    Statement.cpp \
+    TierManager.cpp \
+    Typedef.cpp \
+    WorkStealingPool.cpp \
+    server_main.cpp
+
+HEADERS += \
+    AllocationProfiler.h \
+    CompiledExpression.h \
+    EdgeProfiler.h \
+    Exception.h \
+    ExecutionContext.h \
+    ExecutionServer.h \
+    ExpressionEvaluator.h \
+    ImageCache.h \
+    InputProvider.h \
+    JitCompiler.h \
+    ListingObserver.h \
+    LoopAnalysis.h \
+    LoopSummary.h \
+    MappedFile.h \
+    PgoProfile.h \
+    Program.h \
+    ProgramCache.h \
+    ProgramImage.h \
+    RunControl.h \
+    RunLimits.h \
+    RunTrace.h \
+    ServerProtocol.h \
+    SpscQueue.h \
+    Statement.h \
+    TierManager.h \
+    Typedef.h \
+    WorkStealingPool.h
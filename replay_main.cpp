@@ -0,0 +1,142 @@
+#include "RunTrace.h"
+#include "Typedef.h"
+#include <QCoreApplication>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <streambuf>
+
+// qbasic-replay --record TRACE [--input FILE] [--max-statements N] program.txt
+//   无界面运行程序（INPUT 每行一个值），把输入、转移序列和结果录制到 TRACE
+// qbasic-replay [--verify] [--repeat N] [--quiet] TRACE
+//   按录制的输入重新运行，输出程序的输出和耗时；--repeat 重复运行便于用外部工具剖析，
+//   --verify 检查转移序列、输出、运行统计和错误是否与录制时相同，不同时返回 1
+static int usage() {
+    std::cerr << "usage: qbasic-replay --record TRACE [--input FILE] [--max-statements N] program.txt\n"
+                 "       qbasic-replay [--verify] [--repeat N] [--quiet] TRACE" << std::endl;
+    return 2;
+}
+
+// 丢弃写入的内容；解释器的调试日志不需要
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int ch) override { return ch == traits_type::eof() ? 0 : ch; }
+    std::streamsize xsputn(const char *, std::streamsize count) override { return count; }
+};
+
+static bool readFile(const std::string &path, std::string &content) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+static bool compare(const char *what, const std::string &recorded, const std::string &replayed) {
+    if (recorded == replayed) return true;
+    std::size_t at = 0;
+    while (at < recorded.size() && at < replayed.size() && recorded[at] == replayed[at]) ++at;
+    std::cerr << what << " differs at byte " << at << ": recorded " << jsonString(recorded.substr(at, 40))
+              << ", replayed " << jsonString(replayed.substr(at, 40)) << std::endl;
+    return false;
+}
+
+static int record(const std::string &tracePath, const std::string &inputPath, long long maxStatements, const std::string &path) {
+    std::string source, inputText;
+    if (!readFile(path, source) || (!inputPath.empty() && !readFile(inputPath, inputText))) {
+        std::cerr << "cannot read " << (source.empty() ? path : inputPath) << std::endl;
+        return 1;
+    }
+    std::vector<std::string> inputs;
+    std::size_t begin = 0;
+    while (begin < inputText.size()) {
+        std::size_t end = inputText.find('\n', begin);
+        if (end == std::string::npos) end = inputText.size();
+        std::string line = inputText.substr(begin, end - begin);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        // 与 FileInput 相同，空白行跳过
+        if (line.find_first_not_of(" \t") != std::string::npos) inputs.push_back(line);
+        begin = end + 1;
+    }
+
+    RunTrace trace = RunTrace::run(source, inputs, maxStatements);
+    trace.save(tracePath);
+    std::cerr << trace.statements() << " statements, " << trace.inputs().size() << " inputs, " << trace.jumpCount()
+              << " jumps in " << trace.encodedJumpBytes() << " bytes";
+    if (!trace.error().empty()) std::cerr << ", error: " << trace.error();
+    std::cerr << std::endl;
+    return 0;
+}
+
+static int replay(const std::string &tracePath, bool verify, int repeat, bool quiet, std::streambuf *standardOutput) {
+    RunTrace recorded = RunTrace::load(tracePath);
+    RunTrace replayed;
+    double fastest = 0;
+    for (int i = 0; i < repeat; ++i) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        // 沿用录制时的限制；没有限制时最多比录制多执行一条（出错的那条不计数），路径不同时不会一直运行下去
+        long long limit = recorded.statementLimit() ? recorded.statementLimit() : recorded.statements() + 1;
+        replayed = RunTrace::run(recorded.programText(), recorded.inputs(), limit);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (i == 0 || seconds < fastest) fastest = seconds;
+    }
+    if (!quiet) {
+        std::ostream out(standardOutput);
+        out << replayed.output() << std::flush;
+    }
+    std::cerr << replayed.statements() << " statements, " << replayed.jumpCount() << " jumps, fastest of " << repeat
+              << " runs " << fastest * 1000 << " ms (" << (fastest > 0 ? replayed.statements() / fastest / 1e6 : 0) << "M statements/s)" << std::endl;
+    if (!verify) return 0;
+
+    bool same = true;
+    long long divergence = recorded.firstJumpDifference(replayed);
+    if (divergence >= 0) {
+        std::cerr << "jump sequence differs at jump " << divergence << " of " << recorded.jumpCount() << std::endl;
+        same = false;
+    }
+    if (recorded.inputs().size() != replayed.inputs().size()) {
+        std::cerr << "recorded " << recorded.inputs().size() << " inputs, replay read " << replayed.inputs().size() << std::endl;
+        same = false;
+    }
+    same = compare("output", recorded.output(), replayed.output()) && same;
+    same = compare("counters", recorded.counters(), replayed.counters()) && same;
+    same = compare("error", recorded.error(), replayed.error()) && same;
+    std::cerr << (same ? "replay matches the recording" : "replay does not match the recording") << std::endl;
+    return same ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    std::string recordPath, inputPath, path;
+    long long maxStatements = 0;
+    bool verify = false, quiet = false;
+    int repeat = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) recordPath = argv[++i];
+        else if (std::strcmp(argv[i], "--input") == 0 && i + 1 < argc) inputPath = argv[++i];
+        else if (std::strcmp(argv[i], "--max-statements") == 0 && i + 1 < argc) maxStatements = std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) repeat = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--verify") == 0) verify = true;
+        else if (std::strcmp(argv[i], "--quiet") == 0) quiet = true;
+        else if (argv[i][0] == '-') return usage();
+        else path = argv[i];
+    }
+    if (path.empty() || repeat < 1) return usage();
+
+    NullBuffer discard;
+    std::streambuf *standardOutput = std::cout.rdbuf(&discard);
+    int status;
+    try {
+        status = recordPath.empty() ? replay(path, verify, repeat, quiet, standardOutput)
+                                    : record(recordPath, inputPath, maxStatements, path);
+    }
+    catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        status = 1;
+    }
+    std::cout.rdbuf(standardOutput);
+    return status;
+}
@@ -0,0 +1,80 @@
+#include "ExecutionServer.h"
+#include <QCoreApplication>
+#include <csignal>
+#include <pthread.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <streambuf>
+#include <thread>
+
+// qbasic-server [--socket PATH] [--threads N] [--timeout MS] [--cache N] [--image-cache DIR]
+//               [--max-statements N] [--max-variables N] [--max-memory BYTES] [--max-output BYTES]
+//   在 Unix 域套接字上提供 BASIC 程序执行服务，协议见 ServerProtocol.h；SIGINT / SIGTERM 退出。
+//   --image-cache 把解析好的程序存为 DIR 下的映像文件，重启后同样的程序直接映射，不再解析。
+//   --max-* 限制每个请求的资源，超出时请求以 ResourceLimitError 结束
+static int usage() {
+    std::cerr << "usage: qbasic-server [--socket PATH] [--threads N] [--timeout MS] [--cache N] [--image-cache DIR]\n"
+                 "                     [--max-statements N] [--max-variables N] [--max-memory BYTES] [--max-output BYTES]" << std::endl;
+    return 2;
+}
+
+// 丢弃写入的内容；解释器的调试日志不需要，也避免多个线程争用终端
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int ch) override { return ch == traits_type::eof() ? 0 : ch; }
+    std::streamsize xsputn(const char *, std::streamsize count) override { return count; }
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    ExecutionServer::Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc) options.socketPath = argv[++i];
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) options.threads = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) options.timeoutMs = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--cache") == 0 && i + 1 < argc) options.cacheCapacity = std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--image-cache") == 0 && i + 1 < argc) options.imageCacheDirectory = argv[++i];
+        else if (std::strcmp(argv[i], "--max-statements") == 0 && i + 1 < argc) options.limits.maxStatements = std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "--max-variables") == 0 && i + 1 < argc) options.limits.maxVariables = std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--max-memory") == 0 && i + 1 < argc) options.limits.maxMemory = std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--max-output") == 0 && i + 1 < argc) options.limits.maxOutput = std::strtoul(argv[++i], nullptr, 10);
+        else return usage();
+    }
+
+    // 信号由单独的线程同步等待，再从普通线程上调用 stop()
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+
+    NullBuffer discard;
+    std::streambuf *standardOutput = std::cout.rdbuf(&discard);
+    int status = 0;
+    {
+        ExecutionServer server(options);
+        std::string error;
+        if (!server.listen(error)) {
+            std::cerr << error << std::endl;
+            status = 1;
+        }
+        else {
+            std::thread waiter([&server, &stopSignals] {
+                int signal;
+                sigwait(&stopSignals, &signal);
+                server.stop();
+            });
+            std::cerr << "listening on " << options.socketPath << std::endl;
+            server.run();
+            std::cerr << "cache: " << server.cache().size() << " programs, " << server.cache().hits() << " hits, "
+                      << server.cache().misses() << " misses" << std::endl;
+            // 不是因为信号退出时让等待线程结束
+            pthread_kill(waiter.native_handle(), SIGTERM);
+            waiter.join();
+        }
+    }
+    std::cout.rdbuf(standardOutput);
+    return status;
+}
@@ -0,0 +1,425 @@
+#include "AotCompiler.h"
+#include "ExecutionContext.h"
+#include "InputProvider.h"
+#include "Program.h"
+#include "ProgramImage.h"
+#include "RunTrace.h"
+#include <QCoreApplication>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <streambuf>
+#include <unistd.h>
+#include <vector>
+
+// qbasic-difftest [DIR...]
+//   差分测试：目录中的每个 *.txt 分别用解释器（不升层）、优化层、优化层加 JIT、内存中的
+//   ProgramImage、存盘再读回的 ProgramImage 和读入剖析后的超级块运行，输出、运行统计和错误必须与解释器完全相同；
+//   并像界面那样录制一次运行，回放校验必须与录制一致。系统有 C++ 编译器（$CXX 或 c++）时
+//   还用 AotCompiler 构建每个没有解析错误的程序，生成的程序的输出和错误也必须与解释器相同。
+//   INPUT 依次取 inputValues 中的值，取完后报“没有更多输入”。另外检查升层的 INPUT
+//   在队列取空时让 step 返回 NeedsInput，补充输入后结果与解释器相同，以及升层和 JIT 的循环
+//   也只执行 step 给的语句数。
+//   不给目录时检查仓库中的 test 和 error test，与当前目录无关。有差别时返回 1
+namespace {
+
+// 每次 step 的语句数取得很小，让时间片的边界落在循环和融合区域的中间
+const int sliceBudget = 97;
+// 同一程序最多运行的时间片数，防止某个执行层不结束
+const long long maxSlices = 2000000;
+const int inputValues[] = {7, -3, 12, 0, 5};
+
+// 丢弃写入的内容；解释器的调试日志不需要
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int ch) override { return ch == traits_type::eof() ? 0 : ch; }
+    std::streamsize xsputn(const char *, std::streamsize count) override { return count; }
+};
+
+struct Outcome {
+    std::string output;
+    std::string counters;
+    std::string error;
+};
+
+bool readFile(const std::string &path, std::string &content) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+std::vector<std::string> programsIn(const std::string &directory) {
+    std::vector<std::string> paths;
+    DIR *dir = opendir(directory.c_str());
+    if (!dir) return paths;
+    while (dirent *entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".txt") == 0) paths.push_back(directory + "/" + name);
+    }
+    closedir(dir);
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+GeneratorInput::Generator fixedInputs() {
+    std::size_t next = 0;
+    return [next](int &value) mutable {
+        if (next == sizeof(inputValues) / sizeof(inputValues[0])) return false;
+        value = inputValues[next++];
+        return true;
+    };
+}
+
+// 按时间片运行到结束；step 只能返回 Finished 或 Error 结束，其它结果继续。
+// texts 不为空时 INPUT 是交互式的，每次 NeedsInput 用 provideInput 给出下一段文本
+template <typename Runner>
+bool runToEnd(Runner &runner, std::string &error, const std::vector<std::string> &texts = std::vector<std::string>()) {
+    std::size_t nextText = 0;
+    for (long long slice = 0; slice < maxSlices; ++slice) {
+        Program::StepResult result = runner.step(sliceBudget);
+        if (result == Program::StepResult::Finished) return true;
+        if (result == Program::StepResult::Error) {
+            error = runner.getError();
+            return true;
+        }
+        if (result == Program::StepResult::NeedsInput && nextText < texts.size()) {
+            runner.provideInput(texts[nextText++]);
+            continue;
+        }
+        if (result == Program::StepResult::NeedsInput) {
+            error = "unexpected NeedsInput";
+            return false;
+        }
+    }
+    error = "did not finish";
+    return false;
+}
+
+// threshold <= 0 时只用解释器；profileDirectory 不为空时使用剖析引导模式
+Outcome runProgram(const std::string &source, int threshold, int jitThreshold, const std::vector<std::string> &texts,
+                   const std::string &profileDirectory = "") {
+    Outcome outcome;
+    Program program;
+    program.setTierThreshold(threshold);
+    program.setJitThreshold(jitThreshold);
+    if (!profileDirectory.empty()) program.setProfileGuided(true, profileDirectory);
+    GeneratorInput input(fixedInputs());
+    if (texts.empty()) program.setInputProvider(&input);
+    program.LoadContent(source);
+    program.preRun();
+    runToEnd(program, outcome.error, texts);
+    outcome.output = program.getOutput();
+    outcome.counters = program.getRunCounters();
+    return outcome;
+}
+
+Outcome runImage(std::shared_ptr<const ProgramImage> image, const std::vector<std::string> &texts) {
+    Outcome outcome;
+    ExecutionContext context(image);
+    GeneratorInput input(fixedInputs());
+    if (texts.empty()) context.setInputProvider(&input);
+    runToEnd(context, outcome.error, texts);
+    outcome.output = context.getOutput();
+    outcome.counters = context.getRunCounters();
+    return outcome;
+}
+
+// 仓库根目录：qmake 构建时由 .pro 定义 QBASIC_SOURCE_DIR，否则取本文件所在目录的上一级
+std::string repositoryRoot() {
+#ifdef QBASIC_SOURCE_DIR
+    return QBASIC_SOURCE_DIR;
+#else
+    std::string file = __FILE__;
+    std::size_t slash = file.find_last_of('/');
+    return (slash == std::string::npos ? std::string(".") : file.substr(0, slash)) + "/..";
+#endif
+}
+
+bool same(const std::string &name, const std::string &variant, const Outcome &expected, const Outcome &actual) {
+    const char *what = expected.output != actual.output ? "output"
+                     : expected.counters != actual.counters ? "counters"
+                     : expected.error != actual.error ? "error" : nullptr;
+    if (!what) return true;
+    std::cerr << "FAIL " << name << ": " << variant << " differs from the interpreter in " << what << std::endl;
+    return false;
+}
+
+// 像界面那样录制（Program 边运行边录，输入是交互式的文本），存盘读回后用 qbasic-replay 的
+// RunTrace::run 回放，转移序列、输入、输出、运行统计和错误都必须与录制相同
+bool checkReplay(const std::string &name, const std::string &source, const std::vector<std::string> &texts) {
+    std::vector<std::string> inputs = texts;
+    if (inputs.empty()) {
+        for (int value : inputValues) inputs.push_back(std::to_string(value));
+    }
+    Program program;
+    program.setTraceRecording(true);
+    program.LoadContent(source);
+    program.preRun();
+    std::string error;
+    runToEnd(program, error, inputs);
+    std::string tracePath = "/tmp/qbasic-difftest." + std::to_string(getpid()) + ".trace";
+    program.getTrace().save(tracePath);
+    RunTrace recorded = RunTrace::load(tracePath);
+    std::remove(tracePath.c_str());
+
+    RunTrace replayed = RunTrace::run(recorded.programText(), recorded.inputs(), recorded.statements() + 1);
+    const char *what = recorded.firstJumpDifference(replayed) >= 0 ? "jumps"
+                     : recorded.inputs() != replayed.inputs() ? "inputs"
+                     : recorded.statements() != replayed.statements() ? "statements"
+                     : recorded.output() != replayed.output() ? "output"
+                     : recorded.counters() != replayed.counters() ? "counters"
+                     : recorded.error() != replayed.error() ? "error" : nullptr;
+    if (!what) return true;
+    std::cerr << "FAIL " << name << ": the replay differs from the recording in " << what << std::endl;
+    return false;
+}
+
+// AOT 的缓存目录（本进程专用，结束时删除），没有可用的编译器时为空
+std::string aotDirectory;
+
+std::string shellQuote(const std::string &text) {
+    std::string quoted = "'";
+    for (char ch : text) {
+        if (ch == '\'') quoted += "'\\''";
+        else quoted += ch;
+    }
+    return quoted + "'";
+}
+
+// 生成的程序没有运行统计，只比较输出和错误（标准错误上的一行）；输入每行一个
+bool checkAot(const std::string &name, const std::string &source, const std::vector<std::string> &texts, const Outcome &expected) {
+    std::vector<std::string> inputs = texts;
+    if (inputs.empty()) {
+        for (int value : inputValues) inputs.push_back(std::to_string(value));
+    }
+    std::string base = aotDirectory + "/run";
+    {
+        std::ofstream file(base + ".in");
+        for (const std::string &input : inputs) file << input << '\n';
+    }
+    Outcome actual;
+    actual.counters = expected.counters;
+    try {
+        Program program;
+        program.LoadContent(source);
+        AotCompiler aot(program);
+        std::string binary = aot.build(aotDirectory, AotCompiler::defaultCompiler());
+        std::string command = shellQuote(binary) + " < " + shellQuote(base + ".in") + " > " + shellQuote(base + ".out") + " 2> " + shellQuote(base + ".err");
+        std::system(command.c_str());
+        readFile(base + ".out", actual.output);
+        readFile(base + ".err", actual.error);
+        if (!actual.error.empty() && actual.error.back() == '\n') actual.error.pop_back();
+    }
+    catch (const std::exception &e) {
+        actual.error = std::string("AOT build failed: ") + e.what();
+    }
+    return same(name, "AOT", expected, actual);
+}
+
+bool checkSource(const std::string &path, const std::string &source, const std::vector<std::string> &texts) {
+    Outcome expected;
+    try {
+        expected = runProgram(source, 0, 0, texts);
+    }
+    catch (const std::exception &e) {
+        // LoadContent 就拒绝的程序没有可比较的运行
+        std::cerr << "ok   " << path << " (load error: " << e.what() << ")" << std::endl;
+        return true;
+    }
+    bool ok = same(path, "tier", expected, runProgram(source, 2, 0, texts));
+    ok = checkReplay(path, source, texts) && ok;
+    ok = same(path, "tier+jit", expected, runProgram(source, 2, 3, texts)) && ok;
+    // 第一次运行记录剖析，第二次读入它，沿最热路径执行超级块
+    std::string profileDirectory = "/tmp/qbasic-difftest-pgo." + std::to_string(getpid());
+    makeDirectories(profileDirectory);
+    runProgram(source, 2, 0, texts, profileDirectory);
+    ok = same(path, "profile-guided", expected, runProgram(source, 2, 0, texts, profileDirectory)) && ok;
+    std::system(("rm -rf " + shellQuote(profileDirectory)).c_str());
+
+    Program parsed;
+    parsed.LoadContent(source);
+    std::shared_ptr<const ProgramImage> image = ProgramImage::build(parsed);
+    ok = same(path, "image", expected, runImage(image, texts)) && ok;
+    // 有解析失败的行的映像不能保存，AotCompiler 也在翻译时就报错
+    if (image->hasErrors()) {
+        if (ok) std::cerr << "ok   " << path << " (not saved: parse errors)" << std::endl;
+        return ok;
+    }
+    std::string imagePath = "/tmp/qbasic-difftest." + std::to_string(getpid()) + ".image";
+    image->save(imagePath, source);
+    ok = same(path, "saved image", expected, runImage(ProgramImage::load(imagePath, source), texts)) && ok;
+    std::remove(imagePath.c_str());
+    if (!aotDirectory.empty()) ok = checkAot(path, source, texts, expected) && ok;
+
+    if (ok) std::cerr << "ok   " << path << std::endl;
+    return ok;
+}
+
+bool checkProgram(const std::string &path) {
+    std::string source;
+    if (!readFile(path, source)) {
+        std::cerr << "FAIL " << path << ": cannot read" << std::endl;
+        return false;
+    }
+    return checkSource(path, source, std::vector<std::string>());
+}
+
+// 各执行层曾经不一致的语句语义：赋值前先求值、LET 的左边、交互式输入的文本、溢出回绕
+struct InlineCase {
+    const char *name;
+    const char *source;
+    std::vector<std::string> texts;
+};
+
+const InlineCase inlineCases[] = {
+    {"LET of the variable being defined", "10 LET a = a + 1\n20 PRINT a\n30 END\n", {}},
+    {"LET to an expression", "10 LET a = 1\n20 LET a+b = 2\n30 PRINT a\n40 END\n", {}},
+    {"LET to a number", "10 LET 5 = 1\n20 END\n", {}},
+    {"INPUT out of range", "10 INPUT a\n20 PRINT a * 2\n30 END\n", {"99999999999"}},
+    {"INPUT not a number", "10 INPUT a\n20 PRINT a * 2\n30 END\n", {"x1"}},
+    {"INPUT text", "10 INPUT a\n20 INPUT b\n30 PRINT a - b\n40 END\n", {"  -2147483648", "+12 apples"}},
+    {"overflow wraps", "10 LET a = 2147483647\n20 LET a = a + 1\n30 PRINT a\n40 PRINT a * a - 1\n50 END\n", {}},
+};
+
+// 升层的 INPUT：队列取空时必须停下来要输入，而不是在同一行反复进出优化层直到时间片用完
+bool checkInputInTier() {
+    const std::string source = "10 LET s = 0\n20 INPUT x\n30 LET s = s + x\n40 IF x < 8 THEN 20\n50 PRINT s\n60 END\n";
+    const char *name = "INPUT in the optimized tier";
+
+    Program interpreter;
+    interpreter.setTierThreshold(0);
+    GeneratorInput all([](int &value) {
+        static int next = 0;
+        value = ++next;
+        return true;
+    });
+    interpreter.setInputProvider(&all);
+    interpreter.LoadContent(source);
+    interpreter.preRun();
+    Outcome expected;
+    runToEnd(interpreter, expected.error);
+    expected.output = interpreter.getOutput();
+    expected.counters = interpreter.getRunCounters();
+
+    Program program;
+    program.setTierThreshold(2);
+    program.setJitThreshold(3);
+    QueueInput queue;
+    for (int value = 1; value <= 5; ++value) queue.push(value);
+    program.setInputProvider(&queue);
+    program.LoadContent(source);
+    program.preRun();
+    // 第一次取空时补充队列，第二次用 provideInput 直接给值
+    int waits = 0;
+    Outcome actual;
+    for (long long slice = 0; ; ++slice) {
+        if (slice == 1000) {
+            std::cerr << "FAIL " << name << ": the run never asked for input" << std::endl;
+            return false;
+        }
+        Program::StepResult result = program.step(sliceBudget);
+        if (result == Program::StepResult::NeedsInput) {
+            if (++waits == 1) {
+                queue.push(6);
+                queue.push(7);
+            }
+            else program.provideInput("8");
+            continue;
+        }
+        if (result == Program::StepResult::Error) actual.error = program.getError();
+        if (result == Program::StepResult::Finished || result == Program::StepResult::Error) break;
+    }
+    actual.output = program.getOutput();
+    actual.counters = program.getRunCounters();
+    if (waits != 2) {
+        std::cerr << "FAIL " << name << ": asked for input " << waits << " times, expected 2" << std::endl;
+        return false;
+    }
+    if (!same(name, "tier", expected, actual)) return false;
+    std::cerr << "ok   " << name << std::endl;
+    return true;
+}
+
+// 不结束的循环升层（以及编译成机器码）之后，每次 step 仍只执行 budget 条语句：
+// 各行运行次数之和必须正好是 step 次数乘以 budget
+bool checkBudgetInTier() {
+    const std::string source = "10 LET i = 0\n20 LET i = i + 1\n30 GOTO 20\n40 END\n";
+    const int steps = 1000;
+    const int thresholds[][2] = {{TierManager::defaultThreshold, TierManager::defaultJitThreshold}, {2, 0}, {2, 3}};
+    bool ok = true;
+    for (const auto &threshold : thresholds) {
+        Program program;
+        program.setTierThreshold(threshold[0]);
+        program.setJitThreshold(threshold[1]);
+        program.LoadContent(source);
+        program.preRun();
+        for (int i = 0; i < steps; ++i) {
+            if (program.step(sliceBudget) != Program::StepResult::BudgetExhausted) break;
+        }
+        // 每行“行号 语句    次数”，取最后一个数
+        long long total = 0;
+        std::istringstream counters(program.getRunCounters());
+        std::string line;
+        while (std::getline(counters, line)) {
+            std::size_t space = line.find_last_of(' ');
+            if (space != std::string::npos) total += std::atoll(line.c_str() + space + 1);
+        }
+        if (total != static_cast<long long>(steps) * sliceBudget) {
+            std::cerr << "FAIL statement budget: tier " << threshold[0] << ", JIT " << threshold[1] << " ran " << total
+                      << " statements in " << steps << " steps of " << sliceBudget << std::endl;
+            ok = false;
+        }
+    }
+    if (ok) std::cerr << "ok   statement budget in the optimized tier" << std::endl;
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    std::vector<std::string> directories(argv + 1, argv + argc);
+    if (directories.empty()) directories = {repositoryRoot() + "/test", repositoryRoot() + "/error test"};
+
+    std::string compiler = AotCompiler::defaultCompiler();
+    if (std::system((compiler + " --version > /dev/null 2>&1").c_str()) == 0) {
+        aotDirectory = "/tmp/qbasic-difftest-aot." + std::to_string(getpid());
+        makeDirectories(aotDirectory);
+    }
+    else std::cerr << "no C++ compiler (" << compiler << "), skipping the AOT checks" << std::endl;
+
+    NullBuffer discard;
+    std::streambuf *standardOutput = std::cout.rdbuf(&discard);
+
+    int programs = 0, failures = 0;
+    for (const std::string &directory : directories) {
+        std::vector<std::string> paths = programsIn(directory);
+        if (paths.empty()) {
+            std::cerr << "FAIL " << directory << ": no programs found" << std::endl;
+            ++failures;
+        }
+        for (const std::string &path : paths) {
+            ++programs;
+            if (!checkProgram(path)) ++failures;
+        }
+    }
+    for (const InlineCase &test : inlineCases) {
+        ++programs;
+        if (!checkSource(test.name, test.source, test.texts)) ++failures;
+    }
+    if (!checkInputInTier()) ++failures;
+    if (!checkBudgetInTier()) ++failures;
+
+    std::cout.rdbuf(standardOutput);
+    if (!aotDirectory.empty()) std::system(("rm -rf " + shellQuote(aotDirectory)).c_str());
+    std::cerr << programs << " programs, " << failures << " failures" << std::endl;
+    return failures ? 1 : 0;
+}
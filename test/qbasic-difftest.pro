@@ -0,0 +1,60 @@
+# Differential test: runs every program in test/ and error test/ through the interpreter, the optimized tier, the JIT, program images, trace replay and (when a C++ compiler is available) the AOT compiler, and checks that they all agree.
+QT       = core
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = qbasic-difftest
+
+INCLUDEPATH += ..
+# Without arguments the test looks for test/ and error test/ here, whatever the working directory.
+DEFINES += QBASIC_SOURCE_DIR=\\\"$$clean_path($$PWD/..)\\\"
+
+SOURCES += \
+    ../AllocationProfiler.cpp \
+    ../AotCompiler.cpp \
+    ../CompiledExpression.cpp \
+    ../EdgeProfiler.cpp \
+    ../Exception.cpp \
+    ../ExecutionContext.cpp \
+    ../ExpressionEvaluator.cpp \
+    ../InputProvider.cpp \
+    ../JitCompiler.cpp \
+    ../LoopAnalysis.cpp \
+    ../LoopSummary.cpp \
+    ../MappedFile.cpp \
+    ../PgoProfile.cpp \
+    ../Program.cpp \
+    ../ProgramImage.cpp \
+    ../RunControl.cpp \
+    ../RunLimits.cpp \
+    ../RunTrace.cpp \
+    ../Statement.cpp \
+    ../TierManager.cpp \
+    ../Typedef.cpp \
+    difftest_main.cpp
+
+HEADERS += \
+    ../AllocationProfiler.h \
+    ../AotCompiler.h \
+    ../CompiledExpression.h \
+    ../EdgeProfiler.h \
+    ../Exception.h \
+    ../ExecutionContext.h \
+    ../ExpressionEvaluator.h \
+    ../InputProvider.h \
+    ../JitCompiler.h \
+    ../ListingObserver.h \
+    ../LoopAnalysis.h \
+    ../LoopSummary.h \
+    ../MappedFile.h \
+    ../PgoProfile.h \
+    ../Program.h \
+    ../ProgramImage.h \
+    ../RunControl.h \
+    ../RunLimits.h \
+    ../RunTrace.h \
+    ../SpscQueue.h \
+    ../Statement.h \
+    ../TierManager.h \
+    ../Typedef.h